@@ -0,0 +1,1246 @@
+/**
+ *  Project Ignis: Multirole
+ *  Licensed under AGPL
+ *  Refer to the COPYING file included.
+ */
+#include <algorithm> // std::clamp, std::count_if, std::max, std::max_element, std::min, std::mismatch, std::nth_element, std::sort
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <codecvt>
+#include <cstdlib> // Exit flags, std::malloc, std::free
+#include <cstring> // std::memcpy
+#include <filesystem>
+#include <fstream>
+#include <iterator> // std::istreambuf_iterator
+#include <locale>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/json/object.hpp>
+#include <boost/json/src.hpp>
+#include <fmt/format.h>
+#include <sqlite3.h>
+
+#include "../Multirole/I18N.hpp"
+#include "../Multirole/ReplaySimulator.hpp"
+#include "../Multirole/Core/DLWrapper.hpp"
+#include "../Multirole/Core/HornetWrapper.hpp"
+#include "../Multirole/Core/IScriptSupplier.hpp"
+#include "../Multirole/Lobby/ConnectionTable.hpp"
+#include "../Multirole/RNG/SplitMix64.hpp"
+#include "../Multirole/Room/MsgPipeline.hpp"
+#include "../Multirole/Service/LogHandler.hpp"
+#include "../Multirole/YGOPro/Banlist.hpp"
+#include "../Multirole/YGOPro/CardDatabase.hpp"
+#include "../Multirole/YGOPro/Constants.hpp"
+#include "../Multirole/YGOPro/CoreUtils.hpp"
+#include "../Multirole/YGOPro/DeckValidator.hpp"
+#include "../Multirole/YGOPro/MsgCommon.hpp"
+#include "../Multirole/YGOPro/QueryCache.hpp"
+#include "../Multirole/YGOPro/Replay.hpp"
+#include "../Multirole/YGOPro/ReplayReader.hpp"
+#include "../Multirole/YGOPro/StringUtils.hpp"
+
+// Allocation counting, every allocation done by the benchmark (excluding
+// the ones done inside the core itself) goes through these.
+static std::atomic<uint64_t> allocCount{0U};
+static std::atomic<uint64_t> allocBytes{0U};
+
+void* operator new(std::size_t size)
+{
+	allocCount.fetch_add(1U, std::memory_order_relaxed);
+	allocBytes.fetch_add(size, std::memory_order_relaxed);
+	if(void* p = std::malloc(size == 0U ? 1U : size); p != nullptr)
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t /*unused*/) noexcept
+{
+	std::free(p);
+}
+
+namespace
+{
+
+using namespace Ignis::Multirole;
+
+using Clock = std::chrono::steady_clock;
+
+class ScriptDirectory final : public Core::IScriptSupplier
+{
+public:
+	ScriptDirectory(const std::filesystem::path& dir)
+	{
+		for(const auto& entry : std::filesystem::recursive_directory_iterator(dir))
+		{
+			if(!entry.is_regular_file() || entry.path().extension() != ".lua")
+				continue;
+			std::ifstream file(entry.path(), std::ifstream::binary);
+			std::stringstream buffer;
+			buffer << file.rdbuf();
+			scripts.insert_or_assign(entry.path().filename().string(),
+				std::make_shared<const std::string>(buffer.str()));
+		}
+	}
+
+	std::size_t Count() const noexcept
+	{
+		return scripts.size();
+	}
+
+	ScriptType ScriptFromFilePath(std::string_view fp) const noexcept override
+	{
+		if(auto search = scripts.find(std::string(fp)); search != scripts.end())
+			return search->second;
+		return nullptr;
+	}
+private:
+	std::unordered_map<std::string, ScriptType> scripts;
+};
+
+class Probe final : public ISimulationProbe
+{
+public:
+	struct Entry
+	{
+		uint64_t count;
+		Clock::duration elapsed;
+		uint64_t allocs;
+	};
+
+	Entry process{};
+	std::array<Entry, 256U> msgs{};
+
+	void OnProcessBegin() noexcept override
+	{
+		Begin();
+	}
+
+	void OnProcessEnd() noexcept override
+	{
+		End(process);
+	}
+
+	void OnMsgBegin(uint8_t /*msgType*/) noexcept override
+	{
+		Begin();
+	}
+
+	void OnMsgEnd(uint8_t msgType) noexcept override
+	{
+		End(msgs[msgType]);
+	}
+
+	void OnMsgSent(uint8_t /*audience*/, const YGOPro::STOCMsg& /*msg*/) noexcept override
+	{}
+private:
+	Clock::time_point start;
+	uint64_t startAllocs{};
+
+	void Begin() noexcept
+	{
+		startAllocs = allocCount.load(std::memory_order_relaxed);
+		start = Clock::now();
+	}
+
+	void End(Entry& e) noexcept
+	{
+		e.elapsed += Clock::now() - start;
+		e.allocs += allocCount.load(std::memory_order_relaxed) - startAllocs;
+		e.count++;
+	}
+};
+
+// Follows what the duelist of each team and a spectator have for each
+// location, according to the messages they receive, keeping a digest of
+// every location after each core message is handled. Refreshes replace what
+// clients have for a location, and any other message is assumed to possibly
+// change the cards of every location, except for the ones spelled out below.
+class ClientModel final : public ISimulationProbe
+{
+public:
+	// One digest per audience after each core message.
+	std::vector<std::array<uint64_t, 3U>> digests;
+	std::size_t refreshes{};
+
+	void OnProcessBegin() noexcept override
+	{}
+
+	void OnProcessEnd() noexcept override
+	{}
+
+	void OnMsgBegin(uint8_t /*msgType*/) noexcept override
+	{}
+
+	void OnMsgEnd(uint8_t /*msgType*/) noexcept override
+	{
+		auto& d = digests.emplace_back();
+		for(std::size_t i = 0U; i < d.size(); i++)
+		{
+			d[i] = FNV_OFFSET;
+			for(const auto& [key, digest] : locations[i])
+				d[i] = Hash(d[i], &digest, sizeof(digest));
+		}
+	}
+
+	void OnMsgSent(uint8_t audience, const YGOPro::STOCMsg& stocMsg) noexcept override
+	{
+		using namespace YGOPro;
+		if(stocMsg.Type() != STOCMsg::MsgType::GAME_MSG)
+			return;
+		const auto* msg = stocMsg.Data() + sizeof(STOCMsg::LengthType) + 1U;
+		const std::size_t size = stocMsg.Length() - sizeof(STOCMsg::LengthType) - 1U;
+		auto& l = locations[audience];
+		auto Touch = [&](uint64_t& digest)
+		{
+			digest = Hash(digest, msg, size);
+		};
+		switch(msg[0U])
+		{
+		case MSG_UPDATE_DATA:
+		{
+			refreshes++;
+			l[{msg[1U], msg[2U]}] = Hash(FNV_OFFSET, msg + 3U, size - 3U);
+			return;
+		}
+		case MSG_UPDATE_CARD:
+		{
+			Touch(l[{msg[1U], msg[2U]}]);
+			return;
+		}
+		case MSG_HINT:
+		case MSG_NEW_PHASE:
+		{
+			return;
+		}
+		case MSG_SUMMONING:
+		case MSG_SPSUMMONING:
+		case MSG_FLIPSUMMONING:
+		case MSG_CHAINING:
+		{
+			// NOTE: Only the card on the message, whose location follows
+			// its code.
+			const uint8_t con = msg[5U];
+			const uint8_t loc = msg[6U];
+			if((loc & LOCATION_OVERLAY) == 0U)
+			{
+				Touch(l[{con, loc}]);
+				return;
+			}
+			break;
+		}
+		default:
+		{
+			if(YGOPro::CoreUtils::DoesMessageRequireAnswer(msg[0U]))
+				return;
+			break;
+		}
+		}
+		for(auto& [key, digest] : l)
+			Touch(digest);
+	}
+private:
+	static constexpr uint64_t FNV_OFFSET = 0xCBF29CE484222325U;
+
+	// Digest of what each audience has for each controller and location.
+	std::array<std::map<std::pair<uint8_t, uint8_t>, uint64_t>, 3U> locations;
+
+	static uint64_t Hash(uint64_t h, const void* data, std::size_t size) noexcept
+	{
+		const auto* p = static_cast<const uint8_t*>(data);
+		for(std::size_t i = 0U; i < size; i++)
+			h = (h ^ p[i]) * 0x100000001B3U;
+		return h;
+	}
+};
+
+inline std::vector<uint8_t> ReadFile(const std::filesystem::path& path)
+{
+	std::ifstream file(path, std::ifstream::binary);
+	return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+// Calls f with every item, going through all of them as many times as given.
+// Returns the nanoseconds taken and the allocations done on average per call.
+template<typename Items, typename F>
+std::pair<double, double> Measure(const Items& items, std::size_t passes, F&& f)
+{
+	using Duration = std::chrono::duration<double, std::nano>;
+	// NOTE: Keeps the work from being optimized away.
+	volatile std::size_t sink = 0U;
+	const uint64_t startAllocs = allocCount.load();
+	const auto start = Clock::now();
+	for(std::size_t i = 0U; i < passes; i++)
+	{
+		for(const auto& item : items)
+		{
+			if constexpr(std::is_void_v<decltype(f(item))>)
+				f(item);
+			else
+				sink = sink + static_cast<std::size_t>(f(item));
+		}
+	}
+	const auto elapsed = Duration(Clock::now() - start).count();
+	const auto allocs = static_cast<double>(allocCount.load() - startAllocs);
+	const auto total = static_cast<double>(std::max<std::size_t>(items.size() * passes, 1U));
+	return {elapsed / total, allocs / total};
+}
+
+// Compares producing the owner and stripped query buffers by deserializing
+// them against rewriting them in a single pass, using the query buffers
+// recorded on the replays, which are the same ones the core returned.
+// Returns the amount of buffers for which both ways gave different results.
+std::size_t BenchQueryRewriting(const std::vector<std::pair<std::string, YGOPro::ReplayReader>>& replays)
+{
+	using namespace YGOPro::CoreUtils;
+	static constexpr std::size_t PASSES = 10U;
+	// Buffers that are rewritten by rooms, paired with whether or not they
+	// hold a whole location.
+	std::vector<std::pair<Buffer, bool>> buffers;
+	for(const auto& [name, replay] : replays)
+	{
+		for(const auto& msg : replay.Messages())
+		{
+			if(msg[0U] == MSG_UPDATE_CARD)
+				buffers.emplace_back(Buffer(msg.cbegin() + 4U, msg.cend()), false);
+			else if(msg[0U] == MSG_UPDATE_DATA && msg[2U] != LOCATION_DECK && msg[2U] != LOCATION_EXTRA)
+				buffers.emplace_back(Buffer(msg.cbegin() + 3U, msg.cend()), true);
+		}
+	}
+	if(buffers.empty())
+		return 0U;
+	std::size_t mismatches = 0U;
+	for(const auto& [qb, isLocation] : buffers)
+	{
+		const auto qbp = isLocation ? RewriteLocationQueryBuffer(qb) : RewriteSingleQueryBuffer(qb);
+		if(isLocation)
+		{
+			const auto q = DeserializeLocationQueryBuffer(qb);
+			if(qbp.owner != SerializeLocationQuery(q, false) || qbp.stripped != SerializeLocationQuery(q, true))
+				mismatches++;
+		}
+		else
+		{
+			const auto q = DeserializeSingleQueryBuffer(qb);
+			if(qbp.owner != SerializeSingleQuery(q, false) || qbp.stripped != SerializeSingleQuery(q, true))
+				mismatches++;
+		}
+	}
+	const auto deserialized = Measure(buffers, PASSES, [](const auto& b) -> std::size_t
+	{
+		const auto& [qb, isLocation] = b;
+		if(isLocation)
+		{
+			const auto q = DeserializeLocationQueryBuffer(qb);
+			return SerializeLocationQuery(q, false).size() + SerializeLocationQuery(q, true).size();
+		}
+		const auto q = DeserializeSingleQueryBuffer(qb);
+		return SerializeSingleQuery(q, false).size() + SerializeSingleQuery(q, true).size();
+	});
+	const auto rewritten = Measure(buffers, PASSES, [](const auto& b) -> std::size_t
+	{
+		const auto& [qb, isLocation] = b;
+		const auto qbp = isLocation ? RewriteLocationQueryBuffer(qb) : RewriteSingleQueryBuffer(qb);
+		return qbp.owner.size() + qbp.stripped.size();
+	});
+	fmt::print(I18N::BENCH_QUERY_REWRITE, buffers.size(), deserialized.first,
+		deserialized.second, rewritten.first, rewritten.second, mismatches);
+	return mismatches;
+}
+
+// Stand-in for a core whose cards never change, only answering location
+// queries, each with as many empty cards as needed to tell them apart.
+class StillCore final : public Core::IWrapper
+{
+public:
+	std::pair<int, int> Version() override { return {0, 0}; }
+	Duel CreateDuel(const DuelOptions& /*unused*/) override { return nullptr; }
+	void DestroyDuel(Duel /*unused*/) override {}
+	void AddCard(Duel /*unused*/, const NewCardInfo& /*unused*/) override {}
+	void Start(Duel /*unused*/) override {}
+	DuelStatus Process(Duel /*unused*/) override { return DuelStatus::DUEL_STATUS_END; }
+	Buffer GetMessages(Duel /*unused*/) override { return {}; }
+	void SetResponse(Duel /*unused*/, const Buffer& /*unused*/) override {}
+	int LoadScript(Duel /*unused*/, std::string_view /*unused*/, std::string_view /*unused*/) override { return 0; }
+	std::size_t QueryCount(Duel /*unused*/, uint8_t /*unused*/, uint32_t /*unused*/) override { return 0U; }
+	Buffer Query(Duel /*unused*/, const QueryInfo& /*unused*/) override { return Buffer(sizeof(uint16_t)); }
+	Buffer QueryField(Duel /*unused*/) override { return {}; }
+
+	Buffer QueryLocation(Duel /*unused*/, const QueryInfo& info) override
+	{
+		const uint32_t size = (info.con * 16U + info.loc) * sizeof(uint16_t);
+		Buffer qb(sizeof(size) + size, uint8_t{0U});
+		std::memcpy(qb.data(), &size, sizeof(size));
+		return qb;
+	}
+};
+
+// Keeps the type of every game message sent to a duelist of each team and
+// to a spectator, along with the location for location refreshes.
+class AudienceLog final : public Room::IMsgOutput
+{
+public:
+	using Entry = std::tuple<uint8_t, uint8_t, uint8_t>;
+
+	std::array<std::vector<Entry>, 3U> received; // Teams, then spectators.
+
+	void SendToDuelist(uint8_t team, const YGOPro::STOCMsg& msg) noexcept override
+	{
+		Add(team, msg);
+	}
+
+	void SendToTeam(uint8_t team, const YGOPro::STOCMsg& msg) noexcept override
+	{
+		Add(team, msg);
+	}
+
+	void SendToSpectators(YGOPro::STOCMsg&& msg) noexcept override
+	{
+		Add(2U, msg);
+	}
+
+	void SendToAllExceptDuelist(uint8_t team, YGOPro::STOCMsg&& msg) noexcept override
+	{
+		Add(1U - team, msg);
+		Add(2U, msg);
+	}
+
+	void SendToAll(YGOPro::STOCMsg&& msg) noexcept override
+	{
+		for(uint8_t i = 0U; i < received.size(); i++)
+			Add(i, msg);
+	}
+private:
+	void Add(uint8_t audience, const YGOPro::STOCMsg& msg) noexcept
+	{
+		const auto* p = msg.Data() + sizeof(YGOPro::STOCMsg::LengthType) + 1U;
+		if(p[0U] == MSG_UPDATE_DATA)
+			received[audience].emplace_back(p[0U], p[1U], p[2U]);
+		else
+			received[audience].emplace_back(p[0U], 0U, 0U);
+	}
+};
+
+// Feeds a single batch of messages through the pipeline rooms use, checking
+// that a location refreshed again before any message could have changed
+// what clients have is only sent once, and that everything that is sent
+// arrives in the same order it would without skipping anything. Returns how
+// many messages were not received where expected.
+std::size_t CheckRefreshCollapsing()
+{
+	using namespace YGOPro;
+	using namespace YGOPro::CoreUtils;
+	using Entry = AudienceLog::Entry;
+	StillCore core;
+	std::pmr::monotonic_buffer_resource scratch;
+	Replay replay(0U, {}, HostInfo{}, {});
+	QueryCache queryCache(std::pmr::get_default_resource());
+	AudienceLog log;
+	Room::MsgPipeline pipeline(core, nullptr, replay, &queryCache, log, scratch);
+	pipeline.NewBatch();
+	const std::vector<Msg> batch =
+	{
+		Msg{MSG_NEW_PHASE, 0x01U, 0x00U}, // Refreshes both fields and hands.
+		Msg{MSG_NEW_PHASE, 0x02U, 0x00U}, // Same refreshes again.
+		Msg{MSG_SELECT_IDLECMD, 0U}, // And again, before the request.
+		// Summons a card onto the first monster zone of team 0.
+		Msg{MSG_SUMMONING, 0U, 0U, 0U, 0U, 0U, LOCATION_MZONE, 0U, 0U, 0U, 0U, POS_FACEUP_ATTACK, 0U, 0U, 0U},
+		Msg{MSG_NEW_PHASE, 0x04U, 0x00U}, // Only that monster zone changed.
+		Msg{MSG_NEW_TURN, 1U}, // Refreshes both fields before changing them.
+		Msg{MSG_NEW_PHASE, 0x01U, 0x00U}, // Everything changed.
+	};
+	std::size_t requested = 0U;
+	for(const auto& msg : batch)
+	{
+		for(const auto& reqs : {GetPreDistQueryRequests(msg), GetPostDistQueryRequests(msg)})
+			requested += reqs.size();
+		pipeline.Handle(msg);
+	}
+	const std::vector<Entry> all =
+	{
+		{MSG_UPDATE_DATA, 0U, LOCATION_MZONE}, {MSG_UPDATE_DATA, 1U, LOCATION_MZONE},
+		{MSG_UPDATE_DATA, 0U, LOCATION_SZONE}, {MSG_UPDATE_DATA, 1U, LOCATION_SZONE},
+		{MSG_UPDATE_DATA, 0U, LOCATION_HAND}, {MSG_UPDATE_DATA, 1U, LOCATION_HAND},
+	};
+	std::array<std::vector<Entry>, 3U> expected;
+	for(uint8_t audience = 0U; audience < expected.size(); audience++)
+	{
+		auto& e = expected[audience];
+		e.emplace_back(MSG_NEW_PHASE, 0U, 0U);
+		e.insert(e.end(), all.cbegin(), all.cend());
+		e.emplace_back(MSG_NEW_PHASE, 0U, 0U);
+		if(audience == 0U)
+			e.emplace_back(MSG_SELECT_IDLECMD, 0U, 0U);
+		e.emplace_back(MSG_SUMMONING, 0U, 0U);
+		e.emplace_back(MSG_NEW_PHASE, 0U, 0U);
+		e.emplace_back(MSG_UPDATE_DATA, 0U, LOCATION_MZONE);
+		e.emplace_back(MSG_NEW_TURN, 0U, 0U);
+		e.emplace_back(MSG_NEW_PHASE, 0U, 0U);
+		e.insert(e.end(), all.cbegin(), all.cend());
+	}
+	std::size_t misplaced = 0U;
+	for(std::size_t i = 0U; i < expected.size(); i++)
+	{
+		const auto& got = log.received[i];
+		const auto& want = expected[i];
+		for(std::size_t j = 0U; j < std::max(got.size(), want.size()); j++)
+			misplaced += (j >= got.size() || j >= want.size() || got[j] != want[j]);
+	}
+	const auto& spectated = log.received[2U];
+	const auto sent = std::count_if(spectated.cbegin(), spectated.cend(), [](const Entry& e)
+	{
+		return std::get<0U>(e) == MSG_UPDATE_DATA;
+	});
+	fmt::print(I18N::BENCH_REFRESH_COLLAPSING, batch.size(), requested, sent, misplaced);
+	return misplaced;
+}
+
+// Simulates every replay twice, once skipping the refreshes clients already
+// have as rooms do and once sending all of them, comparing what clients have
+// after each message according to ClientModel. Returns in how many replays
+// skipping refreshes left clients with different cards at some point.
+std::size_t CheckRefreshDivergence(
+	Core::IWrapper& core,
+	Core::IDataSupplier& dataSupplier,
+	Core::IScriptSupplier& scriptSupplier,
+	const std::vector<std::pair<std::string, YGOPro::ReplayReader>>& replays)
+{
+	ReplaySimulator skipping(core, dataSupplier, scriptSupplier);
+	ReplaySimulator sending(core, dataSupplier, scriptSupplier, true);
+	std::size_t diverged = 0U;
+	std::size_t skipped = 0U;
+	std::size_t total = 0U;
+	for(const auto& [name, replay] : replays)
+	{
+		ClientModel withCache;
+		ClientModel withoutCache;
+		skipping.Run(replay, &withCache);
+		sending.Run(replay, &withoutCache);
+		total += withoutCache.refreshes;
+		skipped += withoutCache.refreshes - std::min(withCache.refreshes, withoutCache.refreshes);
+		const auto& a = withCache.digests;
+		const auto& b = withoutCache.digests;
+		const auto it = std::mismatch(a.cbegin(), a.cend(), b.cbegin(), b.cend()).first;
+		if(it == a.cend() && a.size() == b.size())
+			continue;
+		fmt::print(I18N::BENCH_REFRESH_DIVERGED, name, it - a.cbegin());
+		diverged++;
+	}
+	fmt::print(I18N::BENCH_REFRESH_DIVERGENCE, replays.size(), skipped, total, diverged);
+	return diverged;
+}
+
+// Configuration for a Service::LogHandler whose every sink is of "null" type,
+// meaning that no record is written anywhere.
+boost::json::object MakeNullLogConfig()
+{
+	const boost::json::object nullSink{{"type", "null"}, {"properties", boost::json::object{}}};
+	boost::json::object serviceSinks;
+	for(const auto* name : {"gitRepo", "multirole", "banlistProvider", "coreProvider",
+		"dataProvider", "logHandler", "replayManager", "scriptProvider"})
+		serviceSinks[name] = nullSink;
+	boost::json::object ecSinks;
+	for(const auto* name : {"core", "official", "speed", "rush", "other"})
+		ecSinks[name] = nullSink;
+	return
+	{
+		{"serviceSinks", std::move(serviceSinks)},
+		{"ecSinks", std::move(ecSinks)},
+		{"roomLogging", boost::json::object{{"enabled", false}}}
+	};
+}
+
+// Logs one record for each recorded message through a Service::LogHandler
+// whose sinks are all "null", the way rooms log core and script errors while
+// dueling: formatting each record before handing it over, passing the
+// arguments to the helper overloads, and using the logging macros, which
+// check the minimum level and the sink before evaluating any argument.
+void BenchDisabledLogging(const std::vector<std::pair<std::string, YGOPro::ReplayReader>>& replays)
+{
+	boost::asio::io_context ioCtx;
+	const Service::LogHandler lh(ioCtx, MakeNullLogConfig());
+	// The name of the replay and the size of each message, as they are logged.
+	std::vector<std::pair<const std::string*, uint32_t>> records;
+	for(const auto& [name, replay] : replays)
+		for(const auto& msg : replay.Messages())
+			records.emplace_back(&name, static_cast<uint32_t>(msg.size()));
+	const auto formatted = Measure(records, 1U, [&](const auto& r)
+	{
+		lh.Log(ErrorCategory::CORE, r.second, 0U,
+			fmt::format(I18N::ROOM_DUELING_CORE_EXCEPT_PROCESSING, *r.first));
+	});
+	const auto helper = Measure(records, 1U, [&](const auto& r)
+	{
+		lh.Log(ErrorCategory::CORE, r.second, 0U, I18N::ROOM_DUELING_CORE_EXCEPT_PROCESSING, *r.first);
+	});
+	const auto macro = Measure(records, 1U, [&](const auto& r)
+	{
+		MULTIROLE_LOG_EC(lh, ErrorCategory::CORE, r.second, 0U, I18N::ROOM_DUELING_CORE_EXCEPT_PROCESSING, *r.first);
+	});
+	const auto info = Measure(records, 1U, [&](const auto& r)
+	{
+		MULTIROLE_LOG_SVC(lh, ServiceType::MULTIROLE, Level::INFO, I18N::CORE_PROVIDER_ERROR_WHILE_TESTING, *r.first, r.second);
+	});
+	fmt::print(I18N::BENCH_DISABLED_LOGGING, records.size(), static_cast<int>(MIN_LOG_LEVEL),
+		formatted.first, formatted.second, helper.first, helper.second,
+		macro.first, macro.second, info.first, info.second);
+}
+
+// Loads the decks of every duelist recorded on the replays the same way rooms
+// do and checks them repeatedly against a whitelist holding every card of
+// the databases, which makes every card go through the banlist check too.
+void BenchDeckValidation(const YGOPro::CardDatabase& db, const std::vector<std::pair<std::string, YGOPro::ReplayReader>>& replays)
+{
+	static constexpr std::size_t CHECKS = 1000000U;
+	const auto cards = std::make_shared<const YGOPro::DeckValidator::CardTable>(db.Summaries());
+	YGOPro::Banlist::DictType dict;
+	for(const auto& card : *cards)
+		dict.emplace(card.code, 3);
+	const YGOPro::Banlist whitelist(true, std::move(dict));
+	const YGOPro::DeckValidator validator(cards, &whitelist);
+	std::vector<YGOPro::Deck> decks;
+	for(const auto& [name, replay] : replays)
+	{
+		for(const auto& team : replay.Duelists())
+		{
+			for(const auto& [pos, duelist] : team)
+			{
+				auto main = duelist.main;
+				main.insert(main.end(), duelist.extra.cbegin(), duelist.extra.cend());
+				decks.emplace_back(validator.Load(main, {}, replay.DuelFlags()));
+			}
+		}
+	}
+	if(decks.empty())
+		return;
+	YGOPro::HostInfo hostInfo{};
+	hostInfo.allowed = YGOPro::ALLOWED_CARDS_ANY;
+	hostInfo.limits = {{0U, 0xFFFFU}, {0U, 0xFFFFU}, {0U, 0xFFFFU}};
+	std::size_t rejected = 0U;
+	for(const auto& deck : decks)
+		rejected += validator.Check(deck, hostInfo).problem != YGOPro::DeckValidator::Problem::NONE;
+	const std::size_t passes = std::max<std::size_t>(CHECKS / decks.size(), 1U);
+	const auto checked = Measure(decks, passes, [&](const YGOPro::Deck& deck)
+	{
+		return validator.Check(deck, hostInfo).problem;
+	});
+	const auto cached = Measure(decks, passes, [&](const YGOPro::Deck& deck)
+	{
+		return validator.CachedCheck(deck, hostInfo).problem;
+	});
+	fmt::print(I18N::BENCH_DECK_VALIDATION, decks.size(), rejected,
+		checked.first, 1e9 / checked.first, checked.second,
+		cached.first, 1e9 / cached.first);
+}
+
+// Transcodes the names of every duelist recorded on the replays to UTF-16 and
+// back repeatedly, the way they are written onto messages and read from
+// clients, comparing the transcoders against the std::wstring_convert based
+// ones they replaced. Returns how many names transcoded differently.
+std::size_t BenchTranscoding(const std::vector<std::pair<std::string, YGOPro::ReplayReader>>& replays)
+{
+	using Wsc = std::wstring_convert<std::codecvt_utf8_utf16<char16_t>, char16_t>;
+	static constexpr std::size_t ROUNDS = 1000000U;
+	std::vector<std::string> names;
+	for(const auto& [name, replay] : replays)
+		for(const auto& team : replay.Duelists())
+			for(const auto& [pos, duelist] : team)
+				names.push_back(duelist.name);
+	if(names.empty())
+		return 0U;
+	std::size_t mismatches = 0U;
+	for(const auto& name : names)
+	{
+		const auto str16 = Wsc{"Invalid String"}.from_bytes(name.data(), name.data() + name.size());
+		if(YGOPro::UTF8ToUTF16(name) != str16 || YGOPro::UTF16ToUTF8(str16) != name)
+			mismatches++;
+	}
+	const std::size_t passes = std::max<std::size_t>(ROUNDS / names.size(), 1U);
+	const auto converted = Measure(names, passes, [&](const std::string& name)
+	{
+		const auto str16 = Wsc{"Invalid String"}.from_bytes(name.data(), name.data() + name.size());
+		return Wsc{"Invalid String"}.to_bytes(str16.data(), str16.data() + str16.size()).size();
+	});
+	const auto transcoded = Measure(names, passes, [&](const std::string& name)
+	{
+		return YGOPro::UTF16ToUTF8(YGOPro::UTF8ToUTF16(name)).size();
+	});
+	std::array<char16_t, 512U> buffer16;
+	std::array<char, buffer16.size() * 3U> buffer8;
+	const auto buffered = Measure(names, passes, [&](const std::string& name)
+	{
+		const auto count16 = YGOPro::UTF8ToUTF16(name, buffer16.data(), buffer16.size());
+		return YGOPro::UTF16ToUTF8({buffer16.data(), count16}, buffer8.data(), buffer8.size());
+	});
+	fmt::print(I18N::BENCH_TRANSCODING, names.size(), mismatches,
+		converted.first, converted.second, transcoded.first, transcoded.second,
+		buffered.first, buffered.second);
+	return mismatches;
+}
+
+// Tells how many code units the code point starting at `c` takes, or 0 if
+// no code point starts there.
+std::size_t UnitsOf(char16_t c) noexcept
+{
+	if((c & 0xFC00U) == 0xDC00U)
+		return 0U;
+	return (c & 0xFC00U) == 0xD800U ? 2U : 1U;
+}
+
+std::size_t UnitsOf(char c) noexcept
+{
+	const auto b = static_cast<uint8_t>(c);
+	if(b < 0x80U)
+		return 1U;
+	if(b < 0xC0U)
+		return 0U;
+	return b < 0xE0U ? 2U : (b < 0xF0U ? 3U : 4U);
+}
+
+// Tells if the vectorized and scalar transcoders write the same onto buffers
+// able to hold all of `str` and onto a few smaller ones, and if that is what
+// is expected: the whole result, or as many code points of it as fit. An
+// empty `expected` means `str` is malformed.
+template<typename In, typename Out, typename F, typename G>
+bool TranscodesAlike(
+	In str,
+	std::size_t capacity,
+	const std::optional<std::basic_string<Out>>& expected,
+	F&& vectorized,
+	G&& scalar,
+	RNG::SplitMix64& rng)
+{
+	std::array<std::size_t, 4U> capacities{capacity};
+	for(std::size_t i = 1U; i < capacities.size(); i++)
+		capacities[i] = static_cast<std::size_t>(rng() % (capacity + 1U));
+	std::vector<Out> a(capacity);
+	std::vector<Out> b(capacity);
+	for(const auto c : capacities)
+	{
+		const auto n = vectorized(str, a.data(), c);
+		if(n != scalar(str, b.data(), c))
+			return false;
+		if(n == YGOPro::TRANSCODE_ERROR)
+		{
+			// NOTE: Cutting a malformed string short may leave out the
+			// malformed part, but never the other way around.
+			if(expected)
+				return false;
+			continue;
+		}
+		if(!std::equal(a.data(), a.data() + n, b.data()))
+			return false;
+		if(!expected)
+		{
+			if(c == capacity)
+				return false;
+			continue;
+		}
+		const auto& e = *expected;
+		if(n > e.size() || !std::equal(a.data(), a.data() + n, e.data()))
+			return false;
+		if(n < e.size() && (UnitsOf(e[n]) == 0U || n + UnitsOf(e[n]) <= c))
+			return false;
+	}
+	return true;
+}
+
+// Differential fuzzing of the transcoders used for names and chat messages.
+// Made up strings mixing ASCII runs long enough for the vectorized paths,
+// code points of every length and, on half of them, malformed sequences
+// (lone, swapped and UTF-8 encoded surrogates, overlong sequences, code
+// points past U+10FFFF, stray and truncated sequences) are transcoded in
+// both directions by the vectorized and the scalar transcoders and compared
+// against std::wstring_convert. Returns how many strings transcoded
+// differently.
+std::size_t CheckTranscoders()
+{
+	using Wsc = std::wstring_convert<std::codecvt_utf8_utf16<char16_t>, char16_t>;
+	static constexpr std::size_t STRINGS = 100000U;
+	static constexpr std::size_t MAX_REPORTED = 5U;
+	RNG::SplitMix64 rng(STRINGS);
+	auto Below = [&](uint32_t n) -> uint32_t
+	{
+		return static_cast<uint32_t>(rng() % n);
+	};
+	auto AnyCodePoint = [&]() -> uint32_t
+	{
+		switch(Below(4U))
+		{
+		case 0U:
+			return Below(0x80U);
+		case 1U:
+			return 0x80U + Below(0x780U);
+		case 2U:
+		{
+			// NOTE: Skips the surrogate range.
+			const uint32_t cp = 0x800U + Below(0xF000U);
+			return cp < 0xD800U ? cp : cp + 0x800U;
+		}
+		default:
+			return 0x10000U + Below(0x100000U);
+		}
+	};
+	auto Append8 = [](std::string& s, uint32_t cp)
+	{
+		if(cp < 0x80U)
+		{
+			s += static_cast<char>(cp);
+		}
+		else if(cp < 0x800U)
+		{
+			s += static_cast<char>(0xC0U | (cp >> 6U));
+			s += static_cast<char>(0x80U | (cp & 0x3FU));
+		}
+		else if(cp < 0x10000U)
+		{
+			s += static_cast<char>(0xE0U | (cp >> 12U));
+			s += static_cast<char>(0x80U | ((cp >> 6U) & 0x3FU));
+			s += static_cast<char>(0x80U | (cp & 0x3FU));
+		}
+		else
+		{
+			s += static_cast<char>(0xF0U | (cp >> 18U));
+			s += static_cast<char>(0x80U | ((cp >> 12U) & 0x3FU));
+			s += static_cast<char>(0x80U | ((cp >> 6U) & 0x3FU));
+			s += static_cast<char>(0x80U | (cp & 0x3FU));
+		}
+	};
+	auto Append16 = [](std::u16string& s, uint32_t cp)
+	{
+		if(cp < 0x10000U)
+		{
+			s += static_cast<char16_t>(cp);
+			return;
+		}
+		cp -= 0x10000U;
+		s += static_cast<char16_t>(0xD800U | (cp >> 10U));
+		s += static_cast<char16_t>(0xDC00U | (cp & 0x3FFU));
+	};
+	auto Malformed8 = [&](std::string& s)
+	{
+		auto Continuation = [&](uint32_t first, uint32_t count)
+		{
+			return static_cast<char>(first + Below(count));
+		};
+		switch(Below(8U))
+		{
+		case 0U: // Stray continuation byte.
+			s += Continuation(0x80U, 0x40U);
+			break;
+		case 1U: // Overlong 2 byte sequence.
+			s += static_cast<char>(0xC0U + Below(2U));
+			s += Continuation(0x80U, 0x40U);
+			break;
+		case 2U: // Overlong 3 byte sequence.
+			s += '\xE0';
+			s += Continuation(0x80U, 0x20U);
+			s += Continuation(0x80U, 0x40U);
+			break;
+		case 3U: // Overlong 4 byte sequence.
+			s += '\xF0';
+			s += Continuation(0x80U, 0x10U);
+			s += Continuation(0x80U, 0x40U);
+			s += Continuation(0x80U, 0x40U);
+			break;
+		case 4U: // Surrogate.
+			s += '\xED';
+			s += Continuation(0xA0U, 0x20U);
+			s += Continuation(0x80U, 0x40U);
+			break;
+		case 5U: // Past U+10FFFF.
+			s += '\xF4';
+			s += Continuation(0x90U, 0x30U);
+			s += Continuation(0x80U, 0x40U);
+			s += Continuation(0x80U, 0x40U);
+			break;
+		case 6U: // Never valid.
+			s += static_cast<char>(0xF5U + Below(0x0BU));
+			break;
+		default: // Sequence cut short by what follows it.
+		{
+			std::string seq;
+			Append8(seq, 0x80U + Below(0x10FF80U - 0x800U));
+			s.append(seq, 0U, 1U + Below(static_cast<uint32_t>(seq.size() - 1U)));
+			break;
+		}
+		}
+	};
+	auto Malformed16 = [&](std::u16string& s)
+	{
+		switch(Below(3U))
+		{
+		case 0U: // Lone leading surrogate.
+			s += static_cast<char16_t>(0xD800U + Below(0x400U));
+			break;
+		case 1U: // Lone trailing surrogate.
+			s += static_cast<char16_t>(0xDC00U + Below(0x400U));
+			break;
+		default: // Swapped surrogates.
+			s += static_cast<char16_t>(0xDC00U + Below(0x400U));
+			s += static_cast<char16_t>(0xD800U + Below(0x400U));
+			break;
+		}
+	};
+	// Builds a string out of pieces, each being an ASCII run, a code point
+	// or, if allowed, something malformed. Then the end is cut off at times,
+	// which may leave a sequence incomplete.
+	auto MakeString = [&](auto& s, bool malformed, auto&& append, auto&& makeMalformed)
+	{
+		for(uint32_t pieces = 1U + Below(8U); pieces != 0U; pieces--)
+		{
+			const uint32_t kind = Below(16U);
+			if(kind < 6U)
+			{
+				for(uint32_t i = Below(40U); i != 0U; i--)
+					append(s, 0x20U + Below(0x5FU));
+			}
+			else if(kind >= 13U && malformed)
+			{
+				makeMalformed(s);
+			}
+			else
+			{
+				append(s, AnyCodePoint());
+			}
+		}
+		if(!s.empty() && Below(4U) == 0U)
+			s.resize(s.size() - 1U - Below(static_cast<uint32_t>(std::min<std::size_t>(s.size(), 3U))));
+	};
+	auto Expected16 = [](std::string_view str) -> std::optional<std::u16string>
+	{
+		// NOTE: std::wstring_convert takes surrogates encoded as UTF-8, which
+		// are not well-formed, as if they were proper code points. Like any
+		// other sequence, one left incomplete by the end is dropped instead.
+		auto IsContinuation = [&](std::size_t i)
+		{
+			return (static_cast<uint8_t>(str[i]) & 0xC0U) == 0x80U;
+		};
+		for(std::size_t i = 0U; i + 2U < str.size(); i++)
+			if(str[i] == '\xED' && static_cast<uint8_t>(str[i + 1U]) >= 0xA0U && IsContinuation(i + 1U) && IsContinuation(i + 2U))
+				return std::nullopt;
+		try
+		{
+			return Wsc{}.from_bytes(str.data(), str.data() + str.size());
+		}
+		catch(const std::range_error&)
+		{
+			return std::nullopt;
+		}
+	};
+	auto Expected8 = [](std::u16string_view str) -> std::optional<std::string>
+	{
+		try
+		{
+			return Wsc{}.to_bytes(str.data(), str.data() + str.size());
+		}
+		catch(const std::range_error&)
+		{
+			return std::nullopt;
+		}
+	};
+	auto Report = [&, reported = std::size_t{0U}](std::string_view direction, const auto& str) mutable
+	{
+		if(reported++ >= MAX_REPORTED)
+			return;
+		std::string hex;
+		for(const auto c : str)
+			hex += fmt::format(" {:0{}X}", static_cast<uint32_t>(static_cast<std::make_unsigned_t<std::decay_t<decltype(c)>>>(c)), sizeof(c) * 2U);
+		fmt::print(I18N::BENCH_TRANSCODER_MISMATCH, direction, hex);
+	};
+	std::size_t malformed = 0U;
+	std::size_t mismatches8 = 0U;
+	std::size_t mismatches16 = 0U;
+	for(std::size_t i = 0U; i < STRINGS; i++)
+	{
+		std::string str8;
+		MakeString(str8, (i & 1U) != 0U, Append8, Malformed8);
+		const auto expected16 = Expected16(str8);
+		malformed += static_cast<std::size_t>(!expected16);
+		if(!TranscodesAlike(std::string_view(str8), str8.size(), expected16,
+			[](auto... args){return YGOPro::UTF8ToUTF16(args...);},
+			[](auto... args){return YGOPro::UTF8ToUTF16Scalar(args...);}, rng))
+		{
+			mismatches8++;
+			Report("UTF-8", str8);
+		}
+		std::u16string str16;
+		MakeString(str16, (i & 1U) != 0U, Append16, Malformed16);
+		const auto expected8 = Expected8(str16);
+		malformed += static_cast<std::size_t>(!expected8);
+		if(!TranscodesAlike(std::u16string_view(str16), str16.size() * 3U, expected8,
+			[](auto... args){return YGOPro::UTF16ToUTF8(args...);},
+			[](auto... args){return YGOPro::UTF16ToUTF8Scalar(args...);}, rng))
+		{
+			mismatches16++;
+			Report("UTF-16", str16);
+		}
+	}
+	fmt::print(I18N::BENCH_TRANSCODER_FUZZING, STRINGS, malformed, mismatches8, mismatches16);
+	return mismatches8 + mismatches16;
+}
+
+// Has several threads connect and disconnect at the same time through the
+// table used by the lobby to limit connections per IP, with some IPs shared
+// by every thread and a steady stream of new ones, so slots keep changing
+// owner and the table is rebuilt every so often. Each thread keeps its last
+// connections, which must be what the table counts once all of them are
+// done. Returns how many IPs were counted wrong.
+std::size_t BenchConnectionTable()
+{
+	using Table = LobbyDetail::ConnectionTable;
+	static constexpr std::size_t OPS_PER_THREAD = 400000U;
+	static constexpr std::size_t SHARED_IPS = 256U;
+	static constexpr std::size_t MAX_HELD = 64U;
+	const std::size_t threadCount = std::clamp<std::size_t>(std::thread::hardware_concurrency(), 2U, 8U);
+	auto MakeIp = [](uint8_t owner, uint64_t n) -> Table::IpKey
+	{
+		Table::IpKey ip{};
+		ip[0U] = owner; // 0 for the shared IPs, thread number + 1 otherwise.
+		std::memcpy(&ip[8U], &n, sizeof(n));
+		return ip;
+	};
+	struct Worker
+	{
+		std::vector<Table::IpKey> held;
+		std::vector<uint32_t> latencies; // Nanoseconds taken by each call.
+	};
+	const auto table = std::make_unique<Table>();
+	std::vector<Worker> workers(threadCount);
+	std::atomic<bool> go{false};
+	std::vector<std::thread> threads;
+	for(std::size_t t = 0U; t < threadCount; t++)
+	{
+		workers[t].latencies.reserve(OPS_PER_THREAD);
+		workers[t].held.reserve(MAX_HELD);
+		threads.emplace_back([&, t]()
+		{
+			auto& w = workers[t];
+			RNG::SplitMix64 rng(t);
+			uint64_t fresh = 0U;
+			while(!go.load(std::memory_order_acquire)) {}
+			for(std::size_t i = 0U; i < OPS_PER_THREAD; i++)
+			{
+				const uint64_t r = rng();
+				const bool connect = w.held.empty() ||
+					(w.held.size() < MAX_HELD && (r & 1U) != 0U);
+				Table::IpKey ip;
+				if(connect)
+				{
+					ip = ((r >> 1U) & 1U) != 0U ?
+						MakeIp(0U, (r >> 2U) % SHARED_IPS) :
+						MakeIp(static_cast<uint8_t>(t + 1U), fresh++);
+					w.held.push_back(ip);
+				}
+				else
+				{
+					const std::size_t h = (r >> 1U) % w.held.size();
+					ip = w.held[h];
+					w.held[h] = w.held.back();
+					w.held.pop_back();
+				}
+				const auto start = Clock::now();
+				if(connect)
+					table->Increment(ip);
+				else
+					table->Decrement(ip);
+				const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+				w.latencies.push_back(static_cast<uint32_t>(ns.count()));
+			}
+		});
+	}
+	const auto start = Clock::now();
+	go.store(true, std::memory_order_release);
+	for(auto& thread : threads)
+		thread.join();
+	const auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+	std::map<Table::IpKey, int> expected;
+	for(std::size_t i = 0U; i < SHARED_IPS; i++)
+		expected[MakeIp(0U, i)] = 0;
+	for(const auto& w : workers)
+		for(const auto& ip : w.held)
+			expected[ip]++;
+	std::size_t mismatches = 0U;
+	for(const auto& [ip, count] : expected)
+		if(table->Count(ip) != count)
+			mismatches++;
+	std::vector<uint32_t> latencies;
+	latencies.reserve(threadCount * OPS_PER_THREAD);
+	for(const auto& w : workers)
+		latencies.insert(latencies.end(), w.latencies.cbegin(), w.latencies.cend());
+	auto Percentile = [&](std::size_t p) -> uint32_t
+	{
+		const auto nth = latencies.begin() + static_cast<std::ptrdiff_t>((latencies.size() - 1U) * p / 100U);
+		std::nth_element(latencies.begin(), nth, latencies.end());
+		return *nth;
+	};
+	const auto p50 = Percentile(50U);
+	const auto p99 = Percentile(99U);
+	const auto worst = *std::max_element(latencies.cbegin(), latencies.cend());
+	fmt::print(I18N::BENCH_CONNECTION_TABLE, threadCount, latencies.size(), mismatches,
+		static_cast<double>(latencies.size()) / elapsed, p50, p99, worst);
+	return mismatches;
+}
+
+inline std::shared_ptr<Core::IWrapper> MakeCore(const std::filesystem::path& path, std::string_view type)
+{
+	const auto absPath = std::filesystem::absolute(path).string();
+	if(type == "hornet")
+		return std::make_shared<Core::HornetWrapper>(absPath);
+	return std::make_shared<Core::DLWrapper>(absPath);
+}
+
+int Run(int argc, char* argv[])
+{
+	using namespace std::chrono;
+	using Outcome = ReplaySimulator::Outcome;
+	const std::string_view coreType = (argc > 5) ? argv[5] : "shared";
+	std::shared_ptr<Core::IWrapper> core;
+	std::unique_ptr<ScriptDirectory> scripts;
+	std::unique_ptr<YGOPro::CardDatabase> db;
+	std::vector<std::pair<std::string, YGOPro::ReplayReader>> replays;
+	try
+	{
+		core = MakeCore(argv[1], coreType);
+		scripts = std::make_unique<ScriptDirectory>(argv[2]);
+		fmt::print(I18N::BENCH_LOADED_SCRIPTS, scripts->Count());
+		db = std::make_unique<YGOPro::CardDatabase>();
+		std::size_t dbCount = 0U;
+		for(const auto& entry : std::filesystem::recursive_directory_iterator(argv[3]))
+			if(entry.path().extension() == ".cdb" && db->Merge(entry.path().string()))
+				dbCount++;
+		fmt::print(I18N::BENCH_LOADED_DATABASES, dbCount);
+		for(const auto& entry : std::filesystem::directory_iterator(argv[4]))
+		{
+			if(!entry.is_regular_file() || entry.path().extension() != ".yrpX")
+				continue;
+			try
+			{
+				replays.emplace_back(entry.path().filename().string(), ReadFile(entry.path()));
+			}
+			catch(const std::exception& e)
+			{
+				fmt::print(I18N::BENCH_REPLAY_PARSE_FAILURE, entry.path().string(), e.what());
+			}
+		}
+		fmt::print(I18N::BENCH_LOADED_REPLAYS, replays.size());
+	}
+	catch(const std::exception& e)
+	{
+		fmt::print(I18N::BENCH_INIT_FAILURE, e.what());
+		return EXIT_FAILURE;
+	}
+	ReplaySimulator simulator(*core, *db, *scripts);
+	Probe probe;
+	std::size_t diverged = 0U;
+	std::size_t peakSum = 0U;
+	std::size_t bytesSent = 0U;
+	std::pair<std::size_t, std::string_view> peakMax{0U, {}};
+	const uint64_t startAllocs = allocCount.load();
+	const uint64_t startBytes = allocBytes.load();
+	const auto start = Clock::now();
+	for(const auto& [name, replay] : replays)
+	{
+		const auto result = simulator.Run(replay, &probe);
+		peakSum += result.memoryPeak;
+		bytesSent += result.bytesSent;
+		if(result.memoryPeak > peakMax.first)
+			peakMax = {result.memoryPeak, name};
+		if(result.outcome == Outcome::OUTCOME_CORE_EXCEPTION)
+			fmt::print(I18N::BENCH_REPLAY_CORE_EXCEPT, name, result.error);
+		else if(result.outcome == Outcome::OUTCOME_FAILED)
+			fmt::print(I18N::BENCH_REPLAY_SIMULATION_FAILURE, name, result.error);
+		if(!ReplaySimulator::Matches(replay, result))
+		{
+			fmt::print(I18N::BENCH_REPLAY_DIVERGED, name);
+			diverged++;
+		}
+	}
+	const auto elapsed = duration<double>(Clock::now() - start).count();
+	fmt::print(I18N::BENCH_SUMMARY, replays.size(), diverged, elapsed,
+		static_cast<double>(replays.size()) / elapsed,
+		allocCount.load() - startAllocs, allocBytes.load() - startBytes);
+	if(!replays.empty())
+	{
+		fmt::print(I18N::BENCH_MEMORY_PEAKS, peakSum / replays.size(),
+			peakMax.first, peakMax.second);
+		fmt::print(I18N::BENCH_BYTES_SENT, bytesSent, bytesSent / replays.size());
+	}
+	auto AvgNs = [](const Probe::Entry& e) -> double
+	{
+		return duration<double, std::nano>(e.elapsed).count() / static_cast<double>(e.count);
+	};
+	auto TotalMs = [](const Probe::Entry& e) -> double
+	{
+		return duration<double, std::milli>(e.elapsed).count();
+	};
+	auto AvgAllocs = [](const Probe::Entry& e) -> double
+	{
+		return static_cast<double>(e.allocs) / static_cast<double>(e.count);
+	};
+	if(probe.process.count != 0U)
+	{
+		fmt::print(I18N::BENCH_PROCESS_ROW, probe.process.count,
+			AvgNs(probe.process), TotalMs(probe.process), AvgAllocs(probe.process));
+	}
+	// Message types sorted by the total time spent processing them.
+	std::vector<std::size_t> types;
+	for(std::size_t i = 0U; i < probe.msgs.size(); i++)
+		if(probe.msgs[i].count != 0U)
+			types.push_back(i);
+	std::sort(types.begin(), types.end(), [&](std::size_t a, std::size_t b)
+	{
+		return probe.msgs[a].elapsed > probe.msgs[b].elapsed;
+	});
+	fmt::print(I18N::BENCH_MSG_HEADER, "msg", "count", "avg ns", "total ms", "allocs/msg");
+	for(auto i : types)
+	{
+		const auto& e = probe.msgs[i];
+		fmt::print(I18N::BENCH_MSG_ROW, i, e.count, AvgNs(e), TotalMs(e), AvgAllocs(e));
+	}
+	const std::size_t mismatches = BenchQueryRewriting(replays);
+	const std::size_t misplaced = CheckRefreshCollapsing();
+	const std::size_t misrefreshed = CheckRefreshDivergence(*core, *db, *scripts, replays);
+	BenchDisabledLogging(replays);
+	BenchDeckValidation(*db, replays);
+	const std::size_t misencoded = BenchTranscoding(replays) + CheckTranscoders();
+	const std::size_t miscounted = BenchConnectionTable();
+	const bool ok = diverged == 0U && mismatches == 0U && misplaced == 0U &&
+		misrefreshed == 0U && misencoded == 0U && miscounted == 0U;
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+	if(argc < 5)
+	{
+		fmt::print(Ignis::Multirole::I18N::BENCH_USAGE, argv[0]);
+		return EXIT_FAILURE;
+	}
+	sqlite3_initialize();
+	int exitFlag = Run(argc, argv);
+	sqlite3_shutdown();
+	return exitFlag;
+}
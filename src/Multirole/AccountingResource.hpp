@@ -0,0 +1,73 @@
+#ifndef ACCOUNTINGRESOURCE_HPP
+#define ACCOUNTINGRESOURCE_HPP
+#include <algorithm> // std::max
+#include <cstddef>
+#include <memory_resource>
+
+namespace Ignis::Multirole
+{
+
+// Memory resource that keeps track of how many bytes are currently allocated
+// through it, as well as the highest amount reached, forwarding the actual
+// allocations to an upstream resource. Memory that can't be allocated through
+// it (e.g: buffers owned by messages) can be accounted manually with Charge
+// and Discharge.
+// NOTE: Not thread-safe, meant to be used by a single room (or simulation).
+class AccountingResource final : public std::pmr::memory_resource
+{
+public:
+	AccountingResource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) noexcept :
+		upstream(upstream)
+	{}
+
+	std::size_t Current() const noexcept
+	{
+		return current;
+	}
+
+	std::size_t Peak() const noexcept
+	{
+		return peak;
+	}
+
+	void ResetPeak() noexcept
+	{
+		peak = current;
+	}
+
+	void Charge(std::size_t bytes) noexcept
+	{
+		peak = std::max(peak, current += bytes);
+	}
+
+	void Discharge(std::size_t bytes) noexcept
+	{
+		current -= bytes;
+	}
+private:
+	std::pmr::memory_resource* const upstream;
+	std::size_t current{0U};
+	std::size_t peak{0U};
+
+	void* do_allocate(std::size_t bytes, std::size_t alignment) override
+	{
+		void* p = upstream->allocate(bytes, alignment);
+		Charge(bytes);
+		return p;
+	}
+
+	void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+	{
+		upstream->deallocate(p, bytes, alignment);
+		Discharge(bytes);
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+	{
+		return this == &other;
+	}
+};
+
+} // namespace Ignis::Multirole
+
+#endif // ACCOUNTINGRESOURCE_HPP
@@ -7,6 +7,7 @@
 #include "IScriptSupplier.hpp"
 #include "ILogger.hpp"
 #include "../I18N.hpp"
+#include "../Metrics.hpp"
 #include "../../HornetCommon.hpp"
 #define PROCESS_IMPLEMENTATION
 #include "../../Process.hpp"
@@ -320,6 +321,8 @@ void HornetWrapper::DestroySharedSegment()
 
 void HornetWrapper::NotifyAndWait(Hornet::Action act)
 {
+	const auto requested = act;
+	const auto start = Metrics::Clock::now();
 	Hornet::Action recvAct = Hornet::Action::NO_WORK;
 	std::size_t loopCount = 0U;
 	do
@@ -418,6 +421,7 @@ void HornetWrapper::NotifyAndWait(Hornet::Action act)
 			break;
 		}
 	}while(recvAct != Hornet::Action::NO_WORK);
+	Metrics::ObserveHornet(requested, Metrics::Clock::now() - start);
 }
 
 } // namespace Ignis::Multirole::Core
@@ -0,0 +1,121 @@
+#include "Admission.hpp"
+
+#include <algorithm> // std::min
+
+#include "../Lobby.hpp"
+
+namespace Ignis::Multirole::Endpoint
+{
+
+namespace
+{
+
+// NOTE: Buckets are only dropped once they refill completely, if a flood of
+// distinct addresses goes beyond this, new addresses are not rate limited
+// individually until old ones can be dropped, only by their prefix.
+constexpr std::size_t MAX_BUCKETS = 65536U;
+constexpr auto PRUNE_INTERVAL = std::chrono::seconds(1);
+
+inline bool IsV4Mapped(const boost::asio::ip::address_v6::bytes_type& key) noexcept
+{
+	for(std::size_t i = 0U; i < 10U; i++)
+		if(key[i] != 0U)
+			return false;
+	return key[10U] == 0xFFU && key[11U] == 0xFFU;
+}
+
+} // namespace
+
+std::size_t Admission::KeyHash::operator()(const Key& key) const noexcept
+{
+	// FNV-1a
+	uint64_t h = 0xCBF29CE484222325U;
+	for(const auto b : key)
+		h = (h ^ b) * 0x100000001B3U;
+	return static_cast<std::size_t>(h);
+}
+
+// public
+
+Admission::Admission(const Options& options) :
+	handshakeTimeout(options.handshakeTimeout),
+	maxHandshakes(options.maxHandshakes),
+	ips{options.ipRate, options.ipBurst, {}, {}},
+	prefixes{options.prefixRate, options.prefixBurst, {}, {}},
+	handshakes(0U)
+{}
+
+Admission::Verdict Admission::Admit(const boost::asio::ip::address& address)
+{
+	if(maxHandshakes != 0U && handshakes.load(std::memory_order_relaxed) >= maxHandshakes)
+		return Verdict::HANDSHAKES_FULL;
+	const auto now = Clock::now();
+	const Key ip = Lobby::MakeIpKey(address);
+	Bucket* ipBucket = nullptr;
+	if(ips.rate > 0.0 && (ipBucket = Refill(ips, ip, now)) != nullptr && ipBucket->tokens < 1.0)
+		return Verdict::IP_RATE_LIMITED;
+	Key prefix = ip;
+	std::fill(prefix.begin() + (IsV4Mapped(ip) ? 15U : 8U), prefix.end(), 0U);
+	Bucket* prefixBucket = nullptr;
+	if(prefixes.rate > 0.0 && (prefixBucket = Refill(prefixes, prefix, now)) != nullptr && prefixBucket->tokens < 1.0)
+		return Verdict::PREFIX_RATE_LIMITED;
+	// NOTE: Tokens are only taken once the connection is admitted, so
+	// connections dropped by their prefix don't drain their IP bucket.
+	if(ipBucket != nullptr)
+		ipBucket->tokens -= 1.0;
+	if(prefixBucket != nullptr)
+		prefixBucket->tokens -= 1.0;
+	handshakes.fetch_add(1U, std::memory_order_relaxed);
+	return Verdict::ADMITTED;
+}
+
+void Admission::Release() noexcept
+{
+	handshakes.fetch_sub(1U, std::memory_order_relaxed);
+}
+
+std::chrono::seconds Admission::HandshakeTimeout() const noexcept
+{
+	return handshakeTimeout;
+}
+
+// private
+
+Admission::Bucket* Admission::Refill(Buckets& buckets, const Key& key, Clock::time_point now)
+{
+	auto search = buckets.map.find(key);
+	if(search == buckets.map.end())
+	{
+		if(buckets.map.size() >= MAX_BUCKETS)
+		{
+			Prune(buckets, now);
+			if(buckets.map.size() >= MAX_BUCKETS)
+				return nullptr;
+		}
+		search = buckets.map.emplace(key, Bucket{buckets.burst, now}).first;
+	}
+	auto& bucket = search->second;
+	const std::chrono::duration<double> elapsed = now - bucket.last;
+	bucket.tokens = std::min(buckets.burst, bucket.tokens + elapsed.count() * buckets.rate);
+	bucket.last = now;
+	return &bucket;
+}
+
+void Admission::Prune(Buckets& buckets, Clock::time_point now)
+{
+	// NOTE: Sweeping is linear on the amount of buckets, so it is done at
+	// most once per interval even if nothing could be dropped.
+	if(now - buckets.lastPrune < PRUNE_INTERVAL)
+		return;
+	buckets.lastPrune = now;
+	for(auto it = buckets.map.begin(); it != buckets.map.end();)
+	{
+		const std::chrono::duration<double> elapsed = now - it->second.last;
+		if(it->second.tokens + elapsed.count() * buckets.rate >= buckets.burst)
+			it = buckets.map.erase(it);
+		else
+			++it;
+	}
+}
+
+} // namespace Ignis::Multirole::Endpoint
@@ -0,0 +1,86 @@
+#ifndef ENDPOINT_ADMISSION_HPP
+#define ENDPOINT_ADMISSION_HPP
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <unordered_map>
+
+#include <boost/asio/ip/address.hpp>
+
+namespace Ignis::Multirole::Endpoint
+{
+
+// Decides right after accepting a connection whether or not it is worth
+// handling, before any buffer is allocated for it. Connections are limited
+// by how often their IP and their network prefix (/64 for IPv6, /24 for IPv4)
+// connect, using token buckets, and by how many handshakes are in flight.
+class Admission final
+{
+public:
+	struct Options
+	{
+		double ipRate; // Connections per second, 0 disables the bucket.
+		double ipBurst;
+		double prefixRate; // Connections per second, 0 disables the bucket.
+		double prefixBurst;
+		std::size_t maxHandshakes; // 0 means no limit.
+		std::chrono::seconds handshakeTimeout;
+	};
+
+	enum class Verdict
+	{
+		ADMITTED,
+		IP_RATE_LIMITED,
+		PREFIX_RATE_LIMITED,
+		HANDSHAKES_FULL,
+	};
+
+	Admission(const Options& options);
+
+	// Every admitted connection holds a handshake slot until it calls
+	// Release, which must be done exactly once.
+	// NOTE: Not thread-safe, only meant to be called from the accept handler.
+	Verdict Admit(const boost::asio::ip::address& address);
+
+	// Thread-safe.
+	void Release() noexcept;
+
+	std::chrono::seconds HandshakeTimeout() const noexcept;
+private:
+	using Clock = std::chrono::steady_clock;
+	using Key = boost::asio::ip::address_v6::bytes_type;
+
+	struct Bucket
+	{
+		double tokens;
+		Clock::time_point last;
+	};
+
+	struct KeyHash
+	{
+		std::size_t operator()(const Key& key) const noexcept;
+	};
+
+	struct Buckets
+	{
+		const double rate;
+		const double burst;
+		std::unordered_map<Key, Bucket, KeyHash> map;
+		Clock::time_point lastPrune;
+	};
+
+	const std::chrono::seconds handshakeTimeout;
+	const std::size_t maxHandshakes;
+	Buckets ips;
+	Buckets prefixes;
+	std::atomic<std::size_t> handshakes;
+
+	// Returns the bucket for the key refilled up to `now`, or nullptr if
+	// there are too many buckets that were used recently.
+	static Bucket* Refill(Buckets& buckets, const Key& key, Clock::time_point now);
+	static void Prune(Buckets& buckets, Clock::time_point now);
+};
+
+} // namespace Ignis::Multirole::Endpoint
+
+#endif // ENDPOINT_ADMISSION_HPP
@@ -0,0 +1,146 @@
+#include "MetricsListing.hpp"
+
+#include <array>
+#include <iterator> // std::back_inserter
+
+#include <boost/asio/write.hpp>
+#include <fmt/format.h>
+
+#include "../Lobby.hpp"
+#include "../Metrics.hpp"
+#include "../Workaround.hpp"
+
+namespace Ignis::Multirole::Endpoint
+{
+
+namespace
+{
+
+// NOTE: Same order as Room::StateVariant.
+constexpr std::array<std::string_view, std::variant_size_v<Room::StateVariant>> STATE_NAMES =
+{
+	"choosing_turn",
+	"closing",
+	"dueling",
+	"rematching",
+	"rock_paper_scissor",
+	"sidedecking",
+	"waiting",
+};
+
+} // namespace
+
+class MetricsListing::Connection final : public std::enable_shared_from_this<Connection>
+{
+public:
+	Connection(
+		boost::asio::ip::tcp::socket socket,
+		std::shared_ptr<const std::string> data) noexcept
+		:
+		socket(std::move(socket)),
+		outgoing(std::move(data)),
+		incoming(),
+		writeCalled(false)
+	{}
+
+	void DoRead() noexcept
+	{
+		auto self(shared_from_this());
+		socket.async_read_some(boost::asio::buffer(incoming),
+		[this, self](boost::system::error_code ec, std::size_t /*unused*/)
+		{
+			if(ec)
+				return;
+			if(!writeCalled)
+			{
+				writeCalled = true;
+				DoWrite();
+			}
+			DoRead();
+		});
+	}
+private:
+	boost::asio::ip::tcp::socket socket;
+	std::shared_ptr<const std::string> outgoing;
+	std::array<char, 256U> incoming;
+	bool writeCalled;
+
+	void DoWrite() noexcept
+	{
+		auto self(shared_from_this());
+		boost::asio::async_write(socket, boost::asio::buffer(*outgoing),
+		[this, self](boost::system::error_code ec, std::size_t /*unused*/)
+		{
+			if(!ec)
+				socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+		});
+	}
+};
+
+// public
+
+MetricsListing::MetricsListing(
+	boost::asio::io_context& ioCtx,
+	std::string_view address,
+	unsigned short port,
+	Lobby& lobby)
+	:
+	acceptor(ioCtx, boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address(address), port)),
+	lobby(lobby)
+{
+	Workaround::SetCloseOnExec(acceptor.native_handle());
+	DoAccept();
+}
+
+MetricsListing::~MetricsListing() = default;
+
+void MetricsListing::Stop()
+{
+	acceptor.close();
+}
+
+// private
+
+void MetricsListing::DoAccept()
+{
+	acceptor.async_accept(
+	[this](const boost::system::error_code& ec, boost::asio::ip::tcp::socket socket)
+	{
+		if(!acceptor.is_open())
+			return;
+		if(!ec)
+		{
+			Workaround::SetCloseOnExec(socket.native_handle());
+			std::make_shared<Connection>(std::move(socket), Serialize())->DoRead();
+		}
+		DoAccept();
+	});
+}
+
+std::shared_ptr<const std::string> MetricsListing::Serialize()
+{
+	// NOTE: Unlike the lobby listing, metrics are rendered on every request
+	// as they are expected to be scraped periodically by a single collector.
+	std::array<std::size_t, STATE_NAMES.size()> rooms{};
+	lobby.CollectRooms([&](const Lobby::RoomProps& rp)
+	{
+		rooms[rp.state]++;
+	});
+	fmt::memory_buffer body;
+	fmt::format_to(std::back_inserter(body),
+		"# HELP multirole_rooms Rooms currently in the lobby by state.\n"
+		"# TYPE multirole_rooms gauge\n");
+	for(std::size_t i = 0U; i < rooms.size(); i++)
+		fmt::format_to(std::back_inserter(body), "multirole_rooms{{state=\"{}\"}} {}\n",
+			STATE_NAMES[i], rooms[i]);
+	Metrics::Render(body);
+	constexpr const char* const HTTP_HEADER_FORMAT_STRING =
+	"HTTP/1.0 200 OK\r\n"
+	"Content-Length: {:d}\r\n"
+	"Content-Type: text/plain; version=0.0.4\r\n\r\n";
+	auto full = fmt::format(HTTP_HEADER_FORMAT_STRING, body.size());
+	full.append(body.data(), body.size());
+	return std::make_shared<const std::string>(std::move(full));
+}
+
+} // namespace Ignis::Multirole::Endpoint
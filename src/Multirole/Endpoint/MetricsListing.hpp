@@ -0,0 +1,40 @@
+#ifndef METRICSLISTING_HPP
+#define METRICSLISTING_HPP
+#include <memory>
+#include <string_view>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+namespace Ignis::Multirole
+{
+
+class Lobby;
+
+namespace Endpoint
+{
+
+// Serves the metrics recorded through Metrics, along with the rooms in the
+// lobby grouped by their state, to anything that connects.
+class MetricsListing final
+{
+public:
+	MetricsListing(boost::asio::io_context& ioCtx, std::string_view address, unsigned short port, Lobby& lobby);
+	~MetricsListing();
+
+	void Stop();
+private:
+	class Connection;
+
+	boost::asio::ip::tcp::acceptor acceptor;
+	Lobby& lobby;
+
+	void DoAccept();
+	std::shared_ptr<const std::string> Serialize();
+};
+
+} // namespace Endpoint
+
+} // namespace Ignis::Multirole
+
+#endif // METRICSLISTING_HPP
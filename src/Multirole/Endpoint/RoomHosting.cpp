@@ -1,10 +1,16 @@
 #include "RoomHosting.hpp"
 
+#include <array>
+
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/io_context_strand.hpp>
+#include <boost/asio/post.hpp>
 #include <boost/asio/read.hpp>
 #include <boost/asio/write.hpp>
 
 #include "../I18N.hpp"
 #include "../Lobby.hpp"
+#include "../Metrics.hpp"
 #include "../STOCMsgFactory.hpp"
 #include "../Workaround.hpp"
 #include "../Room/Client.hpp"
@@ -38,28 +44,50 @@ template<typename Buffer>
 inline std::string Utf16BufferToStr(const Buffer& buffer)
 {
 	using namespace YGOPro;
-	return UTF16ToUTF8(BufferToUTF16(buffer, sizeof(Buffer)));
+	std::array<char16_t, sizeof(Buffer) / sizeof(char16_t)> str16;
+	const auto count = BufferToUTF16(buffer, sizeof(Buffer), str16.data());
+	return UTF16ToUTF8({str16.data(), count});
 }
 
 class RoomHosting::Connection final : public std::enable_shared_from_this<Connection>
 {
 public:
-	Connection(const RoomHosting& roomHosting,
+	Connection(RoomHosting& roomHosting,
 		boost::asio::ip::tcp::socket socket) noexcept
 		:
 		roomHosting(roomHosting),
-		socket(std::move(socket))
+		strand(roomHosting.ioCtx),
+		socket(std::move(socket)),
+		deadline(roomHosting.timerWheel, [this]()
+		{
+			// NOTE: Might be called while the connection is being destroyed.
+			if(auto self = weak_from_this().lock(); self)
+			{
+				boost::asio::post(strand, [this, self = std::move(self)]()
+				{
+					Metrics::Add(Metrics::Counter::HANDSHAKES_TIMED_OUT);
+					boost::system::error_code ignore;
+					this->socket.close(ignore);
+				});
+			}
+		})
 	{}
 
-	void DoReadHeader() noexcept
+	~Connection() noexcept
+	{
+		roomHosting.admission.Release();
+	}
+
+	void Start() noexcept
 	{
+		// NOTE: The deadline covers the whole handshake, including writing
+		// back any error, so stalled peers can't hold on.
+		deadline.Arm(roomHosting.admission.HandshakeTimeout());
 		auto self(shared_from_this());
-		auto buffer = boost::asio::buffer(incoming.Data(), YGOPro::CTOSMsg::HEADER_LENGTH);
-		boost::asio::async_read(socket, buffer,
-		[this, self](boost::system::error_code ec, std::size_t /*unused*/)
+		boost::asio::post(strand,
+		[this, self]()
 		{
-			if(!ec && incoming.IsHeaderValid())
-				DoReadBody();
+			DoReadHeader();
 		});
 	}
 private:
@@ -70,18 +98,33 @@ private:
 		STATUS_ERROR,
 	};
 
-	const RoomHosting& roomHosting;
+	RoomHosting& roomHosting;
+	boost::asio::io_context::strand strand;
 	boost::asio::ip::tcp::socket socket;
+	TimerWheel::Handle deadline;
 	std::string ip;
+	Lobby::IpKey ipKey{};
 	std::string name;
 	YGOPro::CTOSMsg incoming;
 	std::queue<YGOPro::STOCMsg> outgoing;
 
+	void DoReadHeader() noexcept
+	{
+		auto self(shared_from_this());
+		auto buffer = boost::asio::buffer(incoming.Data(), YGOPro::CTOSMsg::HEADER_LENGTH);
+		boost::asio::async_read(socket, buffer, boost::asio::bind_executor(strand,
+		[this, self](boost::system::error_code ec, std::size_t /*unused*/)
+		{
+			if(!ec && incoming.IsHeaderValid())
+				DoReadBody();
+		}));
+	}
+
 	void DoReadBody() noexcept
 	{
 		auto self(shared_from_this());
 		auto buffer = boost::asio::buffer(incoming.Body(), incoming.GetLength());
-		boost::asio::async_read(socket, buffer,
+		boost::asio::async_read(socket, buffer, boost::asio::bind_executor(strand,
 		[this, self](boost::system::error_code ec, std::size_t /*unused*/)
 		{
 			if(ec)
@@ -95,7 +138,7 @@ private:
 				DoReadEnd();
 				DoWrite();
 			}
-		});
+		}));
 	}
 
 	void DoWrite() noexcept
@@ -104,6 +147,7 @@ private:
 		auto self(shared_from_this());
 		const auto& front = outgoing.front();
 		boost::asio::async_write(socket, boost::asio::buffer(front.Data(), front.Length()),
+		boost::asio::bind_executor(strand,
 		[this, self](boost::system::error_code ec, std::size_t /*unused*/)
 		{
 			if(ec)
@@ -113,19 +157,19 @@ private:
 				DoWrite();
 			else
 				socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
-		});
+		}));
 	}
 
 	void DoReadEnd() noexcept
 	{
 		auto self(shared_from_this());
 		auto buffer = boost::asio::buffer(incoming.Data(), YGOPro::CTOSMsg::MSG_MAX_LENGTH);
-		socket.async_read_some(buffer,
+		socket.async_read_some(buffer, boost::asio::bind_executor(strand,
 		[this, self](boost::system::error_code ec, std::size_t /*unused*/)
 		{
 			if(!ec)
 				DoReadEnd();
-		});
+		}));
 	}
 
 	Status HandleMsg() noexcept
@@ -149,7 +193,8 @@ private:
 				return Status::STATUS_ERROR;
 			}
 			ip = endpoint.address().to_string();
-			if(roomHosting.lobby.HasMaxConnections(ip))
+			ipKey = Lobby::MakeIpKey(endpoint.address());
+			if(roomHosting.lobby.HasMaxConnections(ipKey))
 			{
 				PushToWriteQueue(PrebuiltMsgId::PREBUILT_MAX_CONNECTION_REACHED);
 				PushToWriteQueue(PrebuiltMsgId::PREBUILT_GENERIC_JOIN_ERROR);
@@ -186,13 +231,15 @@ private:
 			Room::Instance::CreateInfo info
 			{
 				roomHosting.ioCtx,
+				roomHosting.timerWheel,
 				std::string(p->notes),
 				Utf16BufferToStr(p->pass),
 				roomHosting.svc,
 				0U, // NOTE: id, set by lobby.
 				{{}}, // NOTE: seed, set by lobby.
 				roomHosting.svc.banlistProvider.GetBanlistByHash(p->hostInfo.banlistHash),
-				p->hostInfo
+				p->hostInfo,
+				roomHosting.roomMemoryBudget
 			};
 			// Fix some of the options back into expected values in case of
 			// exceptions.
@@ -244,7 +291,10 @@ private:
 				std::move(room),
 				std::move(socket),
 				std::move(ip),
-				std::move(name))->Start();
+				ipKey,
+				std::move(name),
+				roomHosting.timerWheel,
+				roomHosting.waitingTimeout)->Start();
 			return Status::STATUS_MOVED;
 		}
 		case YGOPro::CTOSMsg::MsgType::JOIN_GAME:
@@ -286,7 +336,10 @@ private:
 				std::move(room),
 				std::move(socket),
 				std::move(ip),
-				std::move(name))->Start();
+				ipKey,
+				std::move(name),
+				roomHosting.timerWheel,
+				roomHosting.waitingTimeout)->Start();
 			return Status::STATUS_MOVED;
 		}
 		default:
@@ -306,7 +359,15 @@ inline YGOPro::STOCMsg SrvMsg(const char* const str)
 
 // public
 
-RoomHosting::RoomHosting(boost::asio::io_context& ioCtx, Service& svc, Lobby& lobby, unsigned short port)
+RoomHosting::RoomHosting(
+	boost::asio::io_context& ioCtx,
+	Service& svc,
+	Lobby& lobby,
+	unsigned short port,
+	std::size_t roomMemoryBudget,
+	const Admission::Options& admissionOptions,
+	TimerWheel& timerWheel,
+	std::chrono::seconds waitingTimeout)
 	:
 	prebuiltMsgs({
 		STOCMsgFactory::MakeVersionError(YGOPro::SERVER_VERSION),
@@ -323,6 +384,10 @@ RoomHosting::RoomHosting(boost::asio::io_context& ioCtx, Service& svc, Lobby& lo
 	ioCtx(ioCtx),
 	svc(svc),
 	lobby(lobby),
+	roomMemoryBudget(roomMemoryBudget),
+	admission(admissionOptions),
+	timerWheel(timerWheel),
+	waitingTimeout(waitingTimeout),
 	acceptor(ioCtx, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v6(), port))
 {
 	Workaround::SetCloseOnExec(acceptor.native_handle());
@@ -344,13 +409,38 @@ void RoomHosting::DoAccept()
 	{
 		if(!acceptor.is_open())
 			return;
-		if(!ec)
+		if(!ec && Admit(socket))
 		{
 			Workaround::SetCloseOnExec(socket.native_handle());
-			std::make_shared<Connection>(*this, std::move(socket))->DoReadHeader();
+			std::make_shared<Connection>(*this, std::move(socket))->Start();
 		}
 		DoAccept();
 	});
 }
 
+bool RoomHosting::Admit(const boost::asio::ip::tcp::socket& socket)
+{
+	// NOTE: Dropped connections are simply closed, answering them would
+	// cost about as much as handling them.
+	boost::system::error_code ec;
+	const auto endpoint = socket.remote_endpoint(ec);
+	if(ec)
+		return false;
+	switch(admission.Admit(endpoint.address()))
+	{
+	case Admission::Verdict::ADMITTED:
+		return true;
+	case Admission::Verdict::IP_RATE_LIMITED:
+		Metrics::Add(Metrics::Counter::CONNECTIONS_IP_RATE_LIMITED);
+		break;
+	case Admission::Verdict::PREFIX_RATE_LIMITED:
+		Metrics::Add(Metrics::Counter::CONNECTIONS_PREFIX_RATE_LIMITED);
+		break;
+	case Admission::Verdict::HANDSHAKES_FULL:
+		Metrics::Add(Metrics::Counter::CONNECTIONS_HANDSHAKES_FULL);
+		break;
+	}
+	return false;
+}
+
 } // namespace Ignis::Multirole::Endpoint
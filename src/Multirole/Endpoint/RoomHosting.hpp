@@ -7,7 +7,9 @@
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/ip/tcp.hpp>
 
+#include "Admission.hpp"
 #include "../Service.hpp"
+#include "../TimerWheel.hpp"
 #include "../YGOPro/STOCMsg.hpp"
 
 namespace Ignis::Multirole
@@ -21,7 +23,15 @@ namespace Endpoint
 class RoomHosting final
 {
 public:
-	RoomHosting(boost::asio::io_context& ioCtx, Service& svc, Lobby& lobby, unsigned short port);
+	RoomHosting(
+		boost::asio::io_context& ioCtx,
+		Service& svc,
+		Lobby& lobby,
+		unsigned short port,
+		std::size_t roomMemoryBudget,
+		const Admission::Options& admissionOptions,
+		TimerWheel& timerWheel,
+		std::chrono::seconds waitingTimeout);
 	void Stop() noexcept;
 private:
 	enum class PrebuiltMsgId
@@ -49,9 +59,14 @@ private:
 	boost::asio::io_context& ioCtx;
 	Service& svc;
 	Lobby& lobby;
+	const std::size_t roomMemoryBudget;
+	Admission admission;
+	TimerWheel& timerWheel;
+	const std::chrono::seconds waitingTimeout;
 	boost::asio::ip::tcp::acceptor acceptor;
 
 	void DoAccept();
+	bool Admit(const boost::asio::ip::tcp::socket& socket);
 };
 
 } // namespace Endpoint
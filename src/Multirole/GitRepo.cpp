@@ -6,10 +6,11 @@
 
 #include "I18N.hpp"
 #include "IGitRepoObserver.hpp"
+#include "Metrics.hpp"
 #include "libgit2.hpp"
 #include "Service/LogHandler.hpp"
-#define LOG_INFO(...) lh.Log(ServiceType::GIT_REPO, Level::INFO, __VA_ARGS__)
-#define LOG_ERROR(...) lh.Log(ServiceType::GIT_REPO, Level::ERROR, __VA_ARGS__)
+#define LOG_INFO(...) MULTIROLE_LOG_SVC(lh, ServiceType::GIT_REPO, Level::INFO, __VA_ARGS__)
+#define LOG_ERROR(...) MULTIROLE_LOG_SVC(lh, ServiceType::GIT_REPO, Level::ERROR, __VA_ARGS__)
 
 namespace Ignis::Multirole
 {
@@ -56,8 +57,10 @@ GitRepo::GitRepo(Service::LogHandler& lh, boost::asio::io_context& ioCtx, const
 	LOG_INFO(I18N::GIT_REPO_CHECKING_UPDATES);
 	try
 	{
+		const auto start = Metrics::Clock::now();
 		Fetch();
 		ResetToFetchHead();
+		Metrics::Observe(Metrics::Histogram::GIT_UPDATE, Metrics::Clock::now() - start);
 	}
 	catch(...)
 	{
@@ -91,9 +94,11 @@ void GitRepo::Callback(std::string_view payload)
 	}
 	try
 	{
+		const auto start = Metrics::Clock::now();
 		Fetch();
 		const GitDiff diff = GetFilesDiff();
 		ResetToFetchHead();
+		Metrics::Observe(Metrics::Histogram::GIT_UPDATE, Metrics::Clock::now() - start);
 		LOG_INFO(I18N::GIT_REPO_FINISHED_UPDATING);
 		if(!diff.removed.empty() || !diff.added.empty())
 			for(auto& obs : observers)
@@ -23,8 +23,85 @@ Str MULTIROLE_INIT_SUCCESS = "Initialization finished successfully!";
 Str MULTIROLE_GOODBYE = "Good bye!";
 Str MULTIROLE_CLEANING_UP = "Closing acceptors and repositories...";
 Str MULTIROLE_REMAINING_ROOMS = "Rooms that were not closed: {0}";
+Str MULTIROLE_TRACING_ENABLED = "Tracing enabled, send SIGUSR1 to dump the last {0} seconds.";
+Str MULTIROLE_TRACE_DUMPED = "Dumped {0} spans to '{1}'.";
+Str MULTIROLE_TRACE_DUMP_FAILED = "Could not dump trace: {0}";
+Str MULTIROLE_TRACES_COULD_NOT_CREATE_DIR = "Could not create traces directory.";
+Str MULTIROLE_TRACES_PATH_IS_FILE_NOT_DIR = "Traces path is a file, not a directory.";
 
 Str MAIN_SERVER_INIT_FAILURE = "Could not initialize server: {0}\n";
+Str MAIN_VERIFIER_INIT_FAILURE = "Could not initialize replay verification: {0}\n";
+
+Str REPLAY_VERIFIER_REPLAYS_FOUND = "Verifying {0} replays using {1} threads...\n";
+Str REPLAY_VERIFIER_PARSE_FAILURE = "{0}: Could not parse replay: {1}\n";
+Str REPLAY_VERIFIER_CORE_EXCEPT = "{0}: Core exception: {1}\n";
+Str REPLAY_VERIFIER_SIMULATION_FAILURE = "{0}: Could not simulate replay: {1}\n";
+Str REPLAY_VERIFIER_DIVERGED = "{0}: Regenerated messages diverge from the recorded ones.\n";
+Str REPLAY_VERIFIER_SUMMARY =
+"Verified {0} replays in {1:.3f}s: {2} matched, {3} diverged, {4} failed.\n";
+
+Str ROOM_LOG_USAGE =
+"Usage: {0} <segment file or dir> [--room <id>] [--grep <text>] [--since <unix time>] [--until <unix time>]\n";
+Str ROOM_LOG_INVALID_ARGUMENT = "Invalid argument: {0}\n";
+Str ROOM_LOG_CANNOT_READ = "Could not read {0}\n";
+Str ROOM_LOG_NOT_A_SEGMENT = "{0} is not a room log segment.\n";
+Str ROOM_LOG_TRUNCATED = "{0} ends with a truncated record.\n";
+Str ROOM_LOG_RECORD_ROOM = " [Room:{0}] ";
+
+Str TRACING_CANNOT_WRITE_DUMP = "Could not write trace file.";
+
+Str BENCH_USAGE =
+"Usage: {0} <core file> <scripts dir> <databases dir> <replays dir> [shared|hornet]\n";
+Str BENCH_INIT_FAILURE = "Could not initialize benchmark: {0}\n";
+Str BENCH_LOADED_SCRIPTS = "Loaded {0} scripts.\n";
+Str BENCH_LOADED_DATABASES = "Merged {0} databases.\n";
+Str BENCH_LOADED_REPLAYS = "Loaded {0} replays.\n";
+Str BENCH_REPLAY_PARSE_FAILURE = "Could not parse replay {0}: {1}\n";
+Str BENCH_REPLAY_CORE_EXCEPT = "Core exception while simulating {0}: {1}\n";
+Str BENCH_REPLAY_SIMULATION_FAILURE = "Could not simulate {0}: {1}\n";
+Str BENCH_REPLAY_DIVERGED = "Simulation of {0} diverged from the recorded messages.\n";
+Str BENCH_SUMMARY =
+"Simulated {0} duels ({1} diverged) in {2:.3f}s, {3:.2f} duels/sec, "
+"{4} allocations ({5} bytes).\n";
+Str BENCH_MEMORY_PEAKS =
+"Duel state memory peaks: {0} bytes on average, {1} bytes at most ({2}).\n";
+Str BENCH_BYTES_SENT =
+"Bytes sent to a duelist per team and a spectator: {0} in total, {1} per duel on average.\n";
+Str BENCH_PROCESS_ROW =
+"OCG_DuelProcess: {0} calls, {1:.0f}ns avg, {2:.3f}ms total, {3:.1f} allocs/call\n";
+Str BENCH_MSG_HEADER = "{:>8} {:>10} {:>12} {:>12} {:>12}\n";
+Str BENCH_MSG_ROW = "{:>8} {:>10} {:>12.0f} {:>12.3f} {:>12.1f}\n";
+Str BENCH_QUERY_REWRITE =
+"Query buffers ({0} recorded): {1:.0f}ns avg and {2:.1f} allocs when deserialized, "
+"{3:.0f}ns avg and {4:.1f} allocs when rewritten, {5} mismatches.\n";
+Str BENCH_REFRESH_COLLAPSING =
+"Location refreshes ({0} messages, {1} refreshes requested): {2} sent to each "
+"audience, {3} messages out of place.\n";
+Str BENCH_REFRESH_DIVERGED =
+"Skipping refreshes on {0} leaves clients with different cards after message {1}.\n";
+Str BENCH_REFRESH_DIVERGENCE =
+"Skipped refreshes ({0} replays): {1} of {2} location refreshes skipped, "
+"{3} replays where clients end up with different cards.\n";
+Str BENCH_DISABLED_LOGGING =
+"Logging to \"null\" sinks ({0} records, minimum level {1}): "
+"{2:.1f}ns avg and {3:.1f} allocs when formatted first, "
+"{4:.1f}ns avg and {5:.1f} allocs through the helper overloads, "
+"{6:.1f}ns avg and {7:.1f} allocs through the macros, "
+"{8:.1f}ns avg and {9:.1f} allocs for info records through the macros.\n";
+Str BENCH_DECK_VALIDATION =
+"Deck validation ({0} decks, {1} rejected): {2:.0f}ns avg, {3:.0f} decks/sec and "
+"{4:.1f} allocs per check, {5:.0f}ns avg and {6:.0f} decks/sec when cached.\n";
+Str BENCH_TRANSCODING =
+"Name transcoding ({0} names, {1} mismatches): {2:.1f}ns avg and {3:.1f} allocs "
+"with std::wstring_convert, {4:.1f}ns avg and {5:.1f} allocs with the "
+"transcoders, {6:.1f}ns avg and {7:.1f} allocs onto buffers.\n";
+Str BENCH_TRANSCODER_MISMATCH = "Transcoders disagree on {0}:{1}\n";
+Str BENCH_TRANSCODER_FUZZING =
+"Transcoder fuzzing ({0} strings each way, {1} malformed): {2} transcoded "
+"differently from UTF-8, {3} from UTF-16.\n";
+Str BENCH_CONNECTION_TABLE =
+"Connection table ({0} threads, {1} calls, {2} IPs miscounted): {3:.0f} calls/sec, "
+"{4}ns p50, {5}ns p99 and {6}ns max per call.\n";
 
 Str DLWRAPPER_EXCEPT_CREATE_DUEL = "OCG_CreateDuel failed!";
 
@@ -62,10 +139,15 @@ Str CLIENT_ROOM_REPLAY_TOO_BIG =
 "Unable to send replay, its size exceeds the maximum capacity.";
 Str CLIENT_ROOM_CORE_EXCEPT =
 "Internal scripting engine error! This incident has been reported.";
+Str CLIENT_ROOM_MEMORY_EXCEEDED =
+"This duel exceeded the memory allowed for a single room and was ended.";
+Str CLIENT_ROOM_CANNOT_SPECTATE =
+"This duel can no longer be spectated as it is using too much memory.";
 
 Str SCRIPT_LOGGER_USER_MSG = "User debug message: ";
 
 Str CLIENT_ROOM_KICKED = "{0} has been kicked.";
+Str CLIENT_ROOM_INACTIVE = "You have been disconnected due to inactivity.";
 
 Str BANLIST_PROVIDER_LOADING_ONE = "Loading up {0}...";
 Str BANLIST_PROVIDER_COULD_NOT_LOAD_ONE = "Could not load banlist: {0}";
@@ -78,20 +160,27 @@ Str CORE_PROVIDER_COPYING_CORE_FILE = "Copying core from '{0}' to '{1}'...";
 Str CORE_PROVIDER_FAILED_TO_COPY_CORE_FILE = "Failed to copy core file! Re-testing old one.";
 Str CORE_PROVIDER_VERSION_REPORTED = "Version reported by core: {0}.{1}";
 Str CORE_PROVIDER_ERROR_WHILE_TESTING = "Error while testing core '{0}': {1}";
+Str CORE_PROVIDER_CANARY_STARTED = "Core '{0}' will be shadowing {1}% of the duels, it will be used after {2} matching duels.";
+Str CORE_PROVIDER_CANARY_REPLACED = "Discarding candidate core '{0}' in favor of a newer one.";
+Str CORE_PROVIDER_CANARY_DIVERGED = "Candidate core '{0}' diverged from the current one on process call #{1}, discarding it.";
+Str CORE_PROVIDER_CANARY_CRASHED = "Candidate core '{0}' crashed while shadowing a duel, discarding it: {1}";
+Str CORE_PROVIDER_CANARY_FELL_BEHIND = "Candidate core '{0}' fell too far behind on a shadowed duel, {1} calls were not mirrored.";
+Str CORE_PROVIDER_CANARY_PROMOTED = "Candidate core '{0}' matched on {1} duels, now using it. Average latency over {2} process calls: {3:.2f}us (old) vs {4:.2f}us (new).";
 
 Str DATA_PROVIDER_LOADING_ONE = BANLIST_PROVIDER_LOADING_ONE;
 Str DATA_PROVIDER_COULD_NOT_MERGE = "Could not merge database.";
+Str DATA_PROVIDER_COULD_NOT_SUMMARIZE = "Could not read cards from databases: {0}";
 
 Str ROOM_LOGGER_ROOM_NOTES = "Room Notes = \"{0}\"";
 Str ROOM_LOGGER_ROOM_HOST = "Room Host = {0}({1})";
 Str ROOM_LOGGER_IS_PRIVATE = "Room is private, not logging anything else.";
 Str ROOM_LOGGER_CHAT = "{0}({1}): {2}";
+Str ROOM_LOGGER_DUEL_MEMORY_PEAK = "Duel {0} memory peak: {1} bytes";
 
 Str LOG_HANDLER_COULD_NOT_CREATE_DIR = "LogHandler: Could not create room logging directory.";
 Str LOG_HANDLER_PATH_IS_FILE_NOT_DIR = "LogHandler: Room logging directory path points to a file.";
-Str LOG_HANDLER_CANNOT_CREATE_ROOM_LOGGER = "Unable to create RoomLogger: {0}";
-
-Str ROOM_LOGGER_FILE_IS_NOT_OPEN = "File is not open.";
+Str LOG_HANDLER_CANNOT_OPEN_ROOM_LOG = "LogHandler: Could not open a room log segment.";
+Str LOG_HANDLER_RECORDS_DROPPED = "Log queue was full, {0} records were dropped.";
 
 Str DWH_URI_COLON_NOT_FOUND = "URI scheme colon separator not found.";
 Str DWH_URI_TOO_SHORT = "URI length unexpectedly short.";
@@ -99,6 +188,10 @@ Str DWH_URI_NO_PATH = "URI has no path.";
 Str DWH_ERROR_RESOLVING_HOST = "Resolving host yielded no endpoints.";
 Str DWH_SERVICE_MESSAGE_TITLE = "Service Message";
 Str DWH_RIDFORMAT_ERROR = "\n**¡¡¡ERROR FORMATTING TEXT!!!** Check your `ridFormat` format string.";
+Str DWH_OCCURRENCES = "Occurred {0} times";
+Str DWH_RECORDS_DROPPED = "{0} records were dropped as too many were waiting to be sent.";
+Str DWH_REQUEST_RETRIED = "Discord webhook answered with HTTP status {0}, records will be sent again.";
+Str DWH_REQUEST_REJECTED = "Discord webhook rejected a request with HTTP status {0}, {1} records were dropped.";
 
 Str REPLAY_MANAGER_NOT_SAVING_REPLAYS = "Not saving replays, replay IDs will always be 0";
 Str REPLAY_MANAGER_COULD_NOT_CREATE_DIR = "ReplayManager: Could not create replay directory.";
@@ -28,8 +28,56 @@ extern Str MULTIROLE_INIT_SUCCESS;
 extern Str MULTIROLE_GOODBYE;
 extern Str MULTIROLE_CLEANING_UP;
 extern Str MULTIROLE_REMAINING_ROOMS;
+extern Str MULTIROLE_TRACING_ENABLED;
+extern Str MULTIROLE_TRACE_DUMPED;
+extern Str MULTIROLE_TRACE_DUMP_FAILED;
+extern Str MULTIROLE_TRACES_COULD_NOT_CREATE_DIR;
+extern Str MULTIROLE_TRACES_PATH_IS_FILE_NOT_DIR;
 
 extern Str MAIN_SERVER_INIT_FAILURE;
+extern Str MAIN_VERIFIER_INIT_FAILURE;
+
+extern Str REPLAY_VERIFIER_REPLAYS_FOUND;
+extern Str REPLAY_VERIFIER_PARSE_FAILURE;
+extern Str REPLAY_VERIFIER_CORE_EXCEPT;
+extern Str REPLAY_VERIFIER_SIMULATION_FAILURE;
+extern Str REPLAY_VERIFIER_DIVERGED;
+extern Str REPLAY_VERIFIER_SUMMARY;
+
+extern Str ROOM_LOG_USAGE;
+extern Str ROOM_LOG_INVALID_ARGUMENT;
+extern Str ROOM_LOG_CANNOT_READ;
+extern Str ROOM_LOG_NOT_A_SEGMENT;
+extern Str ROOM_LOG_TRUNCATED;
+extern Str ROOM_LOG_RECORD_ROOM;
+
+extern Str TRACING_CANNOT_WRITE_DUMP;
+
+extern Str BENCH_USAGE;
+extern Str BENCH_INIT_FAILURE;
+extern Str BENCH_LOADED_SCRIPTS;
+extern Str BENCH_LOADED_DATABASES;
+extern Str BENCH_LOADED_REPLAYS;
+extern Str BENCH_REPLAY_PARSE_FAILURE;
+extern Str BENCH_REPLAY_CORE_EXCEPT;
+extern Str BENCH_REPLAY_SIMULATION_FAILURE;
+extern Str BENCH_REPLAY_DIVERGED;
+extern Str BENCH_SUMMARY;
+extern Str BENCH_MEMORY_PEAKS;
+extern Str BENCH_BYTES_SENT;
+extern Str BENCH_PROCESS_ROW;
+extern Str BENCH_MSG_HEADER;
+extern Str BENCH_MSG_ROW;
+extern Str BENCH_QUERY_REWRITE;
+extern Str BENCH_REFRESH_COLLAPSING;
+extern Str BENCH_REFRESH_DIVERGED;
+extern Str BENCH_REFRESH_DIVERGENCE;
+extern Str BENCH_DISABLED_LOGGING;
+extern Str BENCH_DECK_VALIDATION;
+extern Str BENCH_TRANSCODING;
+extern Str BENCH_TRANSCODER_MISMATCH;
+extern Str BENCH_TRANSCODER_FUZZING;
+extern Str BENCH_CONNECTION_TABLE;
 
 extern Str DLWRAPPER_EXCEPT_CREATE_DUEL;
 
@@ -60,10 +108,13 @@ extern Str ROOM_DUELING_CORE_EXCEPT_DESTRUCTOR;
 extern Str ROOM_DUELING_MSG_RETRY_RECEIVED;
 extern Str CLIENT_ROOM_REPLAY_TOO_BIG;
 extern Str CLIENT_ROOM_CORE_EXCEPT;
+extern Str CLIENT_ROOM_MEMORY_EXCEEDED;
+extern Str CLIENT_ROOM_CANNOT_SPECTATE;
 
 extern Str SCRIPT_LOGGER_USER_MSG;
 
 extern Str CLIENT_ROOM_KICKED;
+extern Str CLIENT_ROOM_INACTIVE;
 
 extern Str BANLIST_PROVIDER_LOADING_ONE;
 extern Str BANLIST_PROVIDER_COULD_NOT_LOAD_ONE;
@@ -76,20 +127,27 @@ extern Str CORE_PROVIDER_COPYING_CORE_FILE;
 extern Str CORE_PROVIDER_FAILED_TO_COPY_CORE_FILE;
 extern Str CORE_PROVIDER_VERSION_REPORTED;
 extern Str CORE_PROVIDER_ERROR_WHILE_TESTING;
+extern Str CORE_PROVIDER_CANARY_STARTED;
+extern Str CORE_PROVIDER_CANARY_REPLACED;
+extern Str CORE_PROVIDER_CANARY_DIVERGED;
+extern Str CORE_PROVIDER_CANARY_CRASHED;
+extern Str CORE_PROVIDER_CANARY_FELL_BEHIND;
+extern Str CORE_PROVIDER_CANARY_PROMOTED;
 
 extern Str DATA_PROVIDER_LOADING_ONE;
 extern Str DATA_PROVIDER_COULD_NOT_MERGE;
+extern Str DATA_PROVIDER_COULD_NOT_SUMMARIZE;
 
 extern Str ROOM_LOGGER_ROOM_NOTES;
 extern Str ROOM_LOGGER_ROOM_HOST;
 extern Str ROOM_LOGGER_IS_PRIVATE;
 extern Str ROOM_LOGGER_CHAT;
+extern Str ROOM_LOGGER_DUEL_MEMORY_PEAK;
 
 extern Str LOG_HANDLER_COULD_NOT_CREATE_DIR;
 extern Str LOG_HANDLER_PATH_IS_FILE_NOT_DIR;
-extern Str LOG_HANDLER_CANNOT_CREATE_ROOM_LOGGER;
-
-extern Str ROOM_LOGGER_FILE_IS_NOT_OPEN;
+extern Str LOG_HANDLER_CANNOT_OPEN_ROOM_LOG;
+extern Str LOG_HANDLER_RECORDS_DROPPED;
 
 // NOTE: DWH == DiscordWebhook
 extern Str DWH_URI_COLON_NOT_FOUND;
@@ -98,6 +156,10 @@ extern Str DWH_URI_NO_PATH;
 extern Str DWH_ERROR_RESOLVING_HOST;
 extern Str DWH_SERVICE_MESSAGE_TITLE;
 extern Str DWH_RIDFORMAT_ERROR;
+extern Str DWH_OCCURRENCES;
+extern Str DWH_RECORDS_DROPPED;
+extern Str DWH_REQUEST_RETRIED;
+extern Str DWH_REQUEST_REJECTED;
 
 extern Str REPLAY_MANAGER_NOT_SAVING_REPLAYS;
 extern Str REPLAY_MANAGER_COULD_NOT_CREATE_DIR;
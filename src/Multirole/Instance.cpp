@@ -2,14 +2,17 @@
 
 #include <csignal>
 #include <cstdlib> // Exit flags
+#include <stdexcept> // std::runtime_error
 #include <thread>
 
 #include <boost/asio/dispatch.hpp>
 #include <boost/asio/thread_pool.hpp>
 #include <boost/json/value.hpp>
 
-#define LOG_INFO(...) logHandler.Log(ServiceType::MULTIROLE, Level::INFO, __VA_ARGS__)
+#define LOG_INFO(...) MULTIROLE_LOG_SVC(logHandler, ServiceType::MULTIROLE, Level::INFO, __VA_ARGS__)
+#define LOG_ERROR(...) MULTIROLE_LOG_SVC(logHandler, ServiceType::MULTIROLE, Level::ERROR, __VA_ARGS__)
 #include "I18N.hpp"
+#include "Tracing.hpp"
 
 namespace Ignis::Multirole
 {
@@ -34,6 +37,31 @@ inline Service::CoreProvider::CoreType GetCoreType(std::string_view str)
 	return ret;
 }
 
+inline Service::CoreProvider::CanaryOptions GetCanaryOptions(const boost::json::value& v)
+{
+	return
+	{
+		v.at("enabled").as_bool(),
+		std::min(v.at("sampleRate").to_number<unsigned int>(), 100U),
+		v.at("duelsToPromote").to_number<std::size_t>(),
+		std::max(v.at("threads").to_number<unsigned int>(), 1U),
+		std::max(v.at("maxPendingCalls").to_number<std::size_t>(), std::size_t{1U})
+	};
+}
+
+inline Endpoint::Admission::Options GetAdmissionOptions(const boost::json::value& v)
+{
+	return
+	{
+		v.at("ipRate").to_number<double>(),
+		std::max(v.at("ipBurst").to_number<double>(), 1.0),
+		v.at("prefixRate").to_number<double>(),
+		std::max(v.at("prefixBurst").to_number<double>(), 1.0),
+		v.at("maxHandshakes").to_number<std::size_t>(),
+		std::chrono::seconds(std::max(v.at("handshakeTimeout").to_number<unsigned int>(), 1U))
+	};
+}
+
 } // namespace
 
 // public
@@ -50,7 +78,8 @@ Instance::Instance(const boost::json::value& cfg) :
 		cfg.at("coreProvider").at("fileRegex").as_string(),
 		cfg.at("coreProvider").at("tmpPath").as_string().data(),
 		GetCoreType(cfg.at("coreProvider").at("coreType").as_string()),
-		cfg.at("coreProvider").at("loadPerRoom").as_bool()),
+		cfg.at("coreProvider").at("loadPerRoom").as_bool(),
+		GetCanaryOptions(cfg.at("coreProvider").at("canary"))),
 	dataProvider(logHandler, cfg.at("dataProvider").at("fileRegex").as_string()),
 	replayManager(
 		logHandler,
@@ -60,6 +89,8 @@ Instance::Instance(const boost::json::value& cfg) :
 	service({banlistProvider, coreProvider, dataProvider, logHandler,
 		replayManager, scriptProvider}),
 	lobby(cfg.at("lobbyMaxConnections").to_number<int>()),
+	// NOTE: Fine enough for duel time limits, which are in seconds.
+	timerWheel(lIoCtx, std::chrono::milliseconds(100)),
 	lobbyListing(
 		lIoCtx,
 		cfg.at("lobbyListingPort").to_number<unsigned short>(),
@@ -68,9 +99,23 @@ Instance::Instance(const boost::json::value& cfg) :
 		lIoCtx,
 		service,
 		lobby,
-		cfg.at("roomHostingPort").to_number<unsigned short>()),
-	signalSet(lIoCtx)
+		cfg.at("roomHostingPort").to_number<unsigned short>(),
+		cfg.at("roomMemoryBudget").to_number<std::size_t>(),
+		GetAdmissionOptions(cfg.at("roomHostingAdmission")),
+		timerWheel,
+		std::chrono::seconds(cfg.at("roomWaitingTimeout").to_number<unsigned int>())),
+	signalSet(lIoCtx),
+	traceSignalSet(lIoCtx),
+	traceWindow(0)
 {
+	if(const auto& opts = cfg.at("metricsListing"); opts.at("enabled").as_bool())
+	{
+		metricsListing.emplace(
+			lIoCtx,
+			opts.at("address").as_string(),
+			opts.at("port").to_number<unsigned short>(),
+			lobby);
+	}
 	// Load up and update repositories while also adding them to the std::map
 	for(const auto& opts : cfg.at("repos").as_array())
 	{
@@ -99,6 +144,21 @@ Instance::Instance(const boost::json::value& cfg) :
 		LOG_INFO(I18N::MULTIROLE_SIGNAL_RECEIVED);
 		Stop();
 	});
+	if(const auto& opts = cfg.at("tracing"); opts.at("enabled").as_bool())
+	{
+		tracesDir = opts.at("path").as_string().data();
+		if(!exists(tracesDir) && !create_directory(tracesDir))
+			throw std::runtime_error(I18N::MULTIROLE_TRACES_COULD_NOT_CREATE_DIR);
+		if(!is_directory(tracesDir))
+			throw std::runtime_error(I18N::MULTIROLE_TRACES_PATH_IS_FILE_NOT_DIR);
+		traceWindow = std::chrono::seconds(opts.at("window").to_number<unsigned int>());
+		Tracing::Enable(opts.at("spansPerThread").to_number<std::size_t>());
+#ifdef SIGUSR1
+		traceSignalSet.add(SIGUSR1);
+		DoWaitTraceSignal();
+#endif // SIGUSR1
+		LOG_INFO(I18N::MULTIROLE_TRACING_ENABLED, traceWindow.count());
+	}
 	LOG_INFO(I18N::MULTIROLE_HOSTING_THREADS_NUM, hostingConcurrency);
 	LOG_INFO(I18N::MULTIROLE_INIT_SUCCESS);
 }
@@ -121,12 +181,41 @@ void Instance::Stop() noexcept
 {
 	LOG_INFO(I18N::MULTIROLE_CLEANING_UP);
 	auxIoCtx.stop(); // Finishes execution of thread created in Instance::Run
+	traceSignalSet.cancel();
 	lIoCtxGuard.reset(); // Allows hosting threads to finish execution
 	repos.clear(); // Closes repositories (so other process can acquire locks)
 	lobbyListing.Stop();
 	roomHosting.Stop();
+	if(metricsListing)
+		metricsListing->Stop();
 	if(const std::size_t remainingRooms = lobby.Close(); remainingRooms > 0U)
 		LOG_INFO(I18N::MULTIROLE_REMAINING_ROOMS, remainingRooms);
+	// NOTE: Duels that could not be closed still need their time limits, as
+	// do the connections still being handled, so the wheel only stops once
+	// every one of them is gone.
+	timerWheel.StopWhenIdle([this](){return !lobby.HasRooms();});
+}
+
+void Instance::DoWaitTraceSignal() noexcept
+{
+	traceSignalSet.async_wait([this](std::error_code ec, int /*unused*/)
+	{
+		if(ec)
+			return;
+		using namespace std::chrono;
+		const auto ms = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+		const auto file = tracesDir / (std::to_string(ms) + ".json");
+		try
+		{
+			const std::size_t count = Tracing::Dump(file, traceWindow);
+			LOG_INFO(I18N::MULTIROLE_TRACE_DUMPED, count, file.string());
+		}
+		catch(const std::exception& e)
+		{
+			LOG_ERROR(I18N::MULTIROLE_TRACE_DUMP_FAILED, e.what());
+		}
+		DoWaitTraceSignal();
+	});
 }
 
 } // namespace Ignis::Multirole
@@ -1,6 +1,9 @@
 #ifndef SERVERINSTANCE_HPP
 #define SERVERINSTANCE_HPP
+#include <chrono>
+#include <filesystem>
 #include <map>
+#include <optional>
 
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/signal_set.hpp>
@@ -9,7 +12,9 @@
 #include "GitRepo.hpp"
 #include "Lobby.hpp"
 #include "Service.hpp"
+#include "TimerWheel.hpp"
 #include "Endpoint/LobbyListing.hpp"
+#include "Endpoint/MetricsListing.hpp"
 #include "Endpoint/RoomHosting.hpp"
 #include "Service/BanlistProvider.hpp"
 #include "Service/CoreProvider.hpp"
@@ -39,12 +44,18 @@ private:
 	Service::ScriptProvider scriptProvider;
 	Service service;
 	Lobby lobby;
+	TimerWheel timerWheel;
 	Endpoint::LobbyListing lobbyListing;
 	Endpoint::RoomHosting roomHosting;
+	std::optional<Endpoint::MetricsListing> metricsListing;
 	boost::asio::signal_set signalSet;
+	boost::asio::signal_set traceSignalSet;
+	std::filesystem::path tracesDir;
+	std::chrono::seconds traceWindow;
 	std::map<std::string, GitRepo> repos;
 
 	void Stop() noexcept;
+	void DoWaitTraceSignal() noexcept;
 };
 
 } // namespace Ignis::Multirole
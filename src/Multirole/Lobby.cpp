@@ -1,7 +1,15 @@
 #include "Lobby.hpp"
 
-#include "RNG/Xoshiro256.hpp"
+#include <algorithm> // std::any_of, std::min, std::sort
+#include <array>
 #include <chrono>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+#include "Lobby/ConnectionTable.hpp"
+#include "RNG/SplitMix64.hpp"
+#include "RNG/Xoshiro256.hpp"
 
 namespace Ignis::Multirole
 {
@@ -18,127 +26,264 @@ inline std::chrono::time_point<Clock>::rep TimeNowInt64()
 
 } // namespace
 
+// Keeps track of which room IDs are in use and of a weak reference to each
+// room, spread across shards so lookups and insertions on different rooms
+// don't contend on the same lock.
+class Lobby::Registry final
+{
+public:
+	using RoomPtr = std::shared_ptr<Room::Instance>;
+
+	Registry(RNG::SplitMix64::StateType seed) :
+		rng(seed),
+		firstFreeWord(0U)
+	{}
+
+	// Sets the lowest ID not used by any room and a new seed on the given
+	// info.
+	void Reserve(Room::Instance::CreateInfo& info)
+	{
+		std::scoped_lock lock(mIds);
+		// NOTE: Only words that are completely used are skipped, and words
+		// before the hint are never free, so this rarely goes past it.
+		std::size_t w = firstFreeWord;
+		while(w < usedIds.size() && usedIds[w] == ~uint64_t{0U})
+			w++;
+		if(w == usedIds.size())
+			usedIds.push_back(0U);
+		firstFreeWord = w;
+		uint32_t bit = 0U;
+		while(((usedIds[w] >> bit) & 1U) != 0U)
+			bit++;
+		usedIds[w] |= uint64_t{1U} << bit;
+		info.id = static_cast<uint32_t>(w * ID_WORD_BITS + bit + 1U);
+		info.seed = RNG::Xoshiro256StarStar::StateType
+		{{
+			rng(),
+			rng(),
+			rng(),
+			rng(),
+		}};
+	}
+
+	// Adds the room unless the registry was closed already.
+	void Insert(uint32_t id, const RoomPtr& room)
+	{
+		auto& shard = ShardOf(id);
+		const std::size_t index = IndexOf(id);
+		std::scoped_lock lock(shard.m);
+		if(shard.closed)
+			return;
+		if(index >= shard.rooms.size())
+			shard.rooms.resize(index + 1U);
+		shard.rooms[index] = room;
+	}
+
+	// Called once a room is destroyed, makes its ID available again.
+	void Release(uint32_t id) noexcept
+	{
+		// NOTE: The slot is cleared before the ID is given back, otherwise
+		// a new room could take the ID and then have its slot cleared.
+		{
+			auto& shard = ShardOf(id);
+			const std::size_t index = IndexOf(id);
+			std::scoped_lock lock(shard.m);
+			if(index < shard.rooms.size())
+				shard.rooms[index].reset();
+		}
+		const std::size_t w = (id - 1U) / ID_WORD_BITS;
+		std::scoped_lock lock(mIds);
+		usedIds[w] &= ~(uint64_t{1U} << ((id - 1U) % ID_WORD_BITS));
+		firstFreeWord = std::min(firstFreeWord, w);
+	}
+
+	bool HasIds() const
+	{
+		std::scoped_lock lock(mIds);
+		return std::any_of(usedIds.cbegin(), usedIds.cend(), [](uint64_t w){return w != 0U;});
+	}
+
+	RoomPtr Find(uint32_t id) const
+	{
+		if(id == 0U)
+			return nullptr;
+		const auto& shard = ShardOf(id);
+		const std::size_t index = IndexOf(id);
+		std::shared_lock lock(shard.m);
+		if(index < shard.rooms.size())
+			return shard.rooms[index].lock();
+		return nullptr;
+	}
+
+	// Appends all the rooms that are still alive, in no particular order.
+	void Collect(std::vector<std::pair<uint32_t, RoomPtr>>& out) const
+	{
+		for(std::size_t s = 0U; s < SHARD_COUNT; s++)
+		{
+			const auto& shard = shards[s];
+			std::shared_lock lock(shard.m);
+			for(std::size_t i = 0U; i < shard.rooms.size(); i++)
+				if(auto room = shard.rooms[i].lock(); room)
+					out.emplace_back(static_cast<uint32_t>(i * SHARD_COUNT + s + 1U), std::move(room));
+		}
+	}
+
+	// Forgets about every room and prevents new ones from being added,
+	// appending the rooms that were still alive. Every room is either
+	// appended or never added, as each shard is closed and emptied at once.
+	void Close(std::vector<std::pair<uint32_t, RoomPtr>>& out)
+	{
+		for(std::size_t s = 0U; s < SHARD_COUNT; s++)
+		{
+			auto& shard = shards[s];
+			std::scoped_lock lock(shard.m);
+			for(std::size_t i = 0U; i < shard.rooms.size(); i++)
+				if(auto room = shard.rooms[i].lock(); room)
+					out.emplace_back(static_cast<uint32_t>(i * SHARD_COUNT + s + 1U), std::move(room));
+			shard.rooms.clear();
+			shard.closed = true;
+		}
+	}
+private:
+	static constexpr std::size_t SHARD_COUNT = 16U;
+	static constexpr std::size_t ID_WORD_BITS = 64U;
+
+	struct alignas(64U) Shard
+	{
+		// Index (ID - 1) / SHARD_COUNT holds the room with that ID.
+		std::vector<std::weak_ptr<Room::Instance>> rooms;
+		bool closed = false;
+		mutable std::shared_mutex m;
+	};
+
+	std::array<Shard, SHARD_COUNT> shards;
+
+	RNG::SplitMix64 rng;
+	std::vector<uint64_t> usedIds; // Bit (ID - 1) is set if the ID is in use.
+	std::size_t firstFreeWord; // No word before this one has a free ID.
+	mutable std::mutex mIds;
+
+	Shard& ShardOf(uint32_t id) noexcept
+	{
+		return shards[(id - 1U) % SHARD_COUNT];
+	}
+
+	const Shard& ShardOf(uint32_t id) const noexcept
+	{
+		return shards[(id - 1U) % SHARD_COUNT];
+	}
+
+	static std::size_t IndexOf(uint32_t id) noexcept
+	{
+		return (id - 1U) / SHARD_COUNT;
+	}
+};
+
 // public
 
 Lobby::Lobby(int maxConnections) :
 	maxConnections(maxConnections),
-	rng(static_cast<RNG::SplitMix64::StateType>(TimeNowInt64())),
-	closed(false)
+	registry(std::make_shared<Registry>(static_cast<RNG::SplitMix64::StateType>(TimeNowInt64()))),
+	connections((maxConnections < 0) ? nullptr : std::make_unique<LobbyDetail::ConnectionTable>())
 {}
 
+Lobby::~Lobby() = default;
+
+Lobby::IpKey Lobby::MakeIpKey(const boost::asio::ip::address& address) noexcept
+{
+	if(address.is_v4())
+		return boost::asio::ip::make_address_v6(boost::asio::ip::v4_mapped, address.to_v4()).to_bytes();
+	return address.to_v6().to_bytes();
+}
+
 std::shared_ptr<Room::Instance> Lobby::GetRoomById(uint32_t id) const
 {
-	std::shared_lock lock(mRooms);
-	if(id != 0U && id <= rooms.size())
-		return rooms[id - 1U].second.lock();
-	return nullptr;
+	return registry->Find(id);
 }
 
-bool Lobby::HasMaxConnections(const std::string& ip) const
+bool Lobby::HasMaxConnections(const IpKey& ip) const noexcept
 {
 	if(maxConnections < 0)
 		return false;
-	std::shared_lock lock(mConnections);
-	if(const auto search = connections.find(ip); search != connections.end())
-		return search->second >= maxConnections;
-	return false;
+	return connections->Count(ip) >= maxConnections;
 }
 
 std::size_t Lobby::Close()
 {
+	std::vector<std::pair<uint32_t, Registry::RoomPtr>> rooms;
+	registry->Close(rooms);
 	std::size_t count = 0U;
-	std::scoped_lock lock(mRooms);
-	for(auto& slot : rooms)
-		if(auto room = slot.second.lock(); room)
-			count += static_cast<std::size_t>(!room->TryClose());
-	rooms.clear();
-	closed = true;
+	for(const auto& [id, room] : rooms)
+		count += static_cast<std::size_t>(!room->TryClose());
 	return count;
 }
 
+bool Lobby::HasRooms() const
+{
+	// NOTE: IDs are given back once rooms are destroyed, so this also covers
+	// the rooms the registry no longer holds a reference to.
+	return registry->HasIds();
+}
+
 std::shared_ptr<Room::Instance> Lobby::MakeRoom(Room::Instance::CreateInfo& info)
 {
-	std::scoped_lock lock(mRooms);
-	info.id = [&]()
+	registry->Reserve(info);
+	Room::Instance* ptr = nullptr;
+	try
 	{
-		uint32_t id = 1U;
-		for(const auto& slot : rooms)
-		{
-			if(!slot.first)
-				break;
-			id++;
-		}
-		return id;
-	}();
-	info.seed = RNG::Xoshiro256StarStar::StateType
-	{{
-		rng(),
-		rng(),
-		rng(),
-		rng(),
-	}};
-	auto room = std::make_shared<Room::Instance>(info);
-	if(!closed)
-	{
-		if(info.id <= rooms.size())
-		{
-			auto& slot = rooms[info.id - 1U];
-			slot.first = true;
-			slot.second = room;
-		}
-		else
-		{
-			rooms.emplace_back(true, room);
-		}
+		ptr = new Room::Instance(info);
 	}
+	catch(...)
+	{
+		registry->Release(info.id);
+		throw;
+	}
+	std::shared_ptr<Room::Instance> room(ptr, [registry = registry, id = info.id](Room::Instance* r)
+	{
+		delete r;
+		registry->Release(id);
+	});
+	registry->Insert(info.id, room);
 	return room;
 }
 
 void Lobby::CollectRooms(const std::function<void(const RoomProps&)>& f)
 {
+	// NOTE: References are taken out of the registry first so no lock is
+	// held while the function runs, or when a room dies along the vector.
+	std::vector<std::pair<uint32_t, Registry::RoomPtr>> rooms;
+	registry->Collect(rooms);
+	std::sort(rooms.begin(), rooms.end(), [](const auto& a, const auto& b)
+	{
+		return a.first < b.first;
+	});
 	RoomProps props{};
-	uint32_t id = 1U;
-	std::scoped_lock lock(mRooms);
-	for(auto& slot : rooms)
+	for(const auto& [id, room] : rooms)
 	{
-		if(auto room = slot.second.lock(); room)
-		{
-			props.id = id;
-			auto& r = *room;
-			props.hostInfo = &r.HostInfo();
-			props.notes = &r.Notes();
-			props.passworded = r.IsPrivate();
-			props.started = r.Started();
-			props.duelists = r.DuelistNames();
-			f(props);
-		}
-		else if(slot.first)
-		{
-			slot.first = false;
-			slot.second.reset(); // deallocates memory.
-		}
-		id++;
+		props.id = id;
+		auto& r = *room;
+		props.hostInfo = &r.HostInfo();
+		props.notes = &r.Notes();
+		props.passworded = r.IsPrivate();
+		props.started = r.Started();
+		props.state = r.StateIndex();
+		props.duelists = r.DuelistNames();
+		f(props);
 	}
 }
 
-void Lobby::IncrementConnectionCount(const std::string& ip)
+void Lobby::IncrementConnectionCount(const IpKey& ip) noexcept
 {
 	if(maxConnections < 0)
 		return;
-	std::scoped_lock lock(mConnections);
-	connections[ip]++;
+	connections->Increment(ip);
 }
 
-void Lobby::DecrementConnectionCount(const std::string& ip)
+void Lobby::DecrementConnectionCount(const IpKey& ip) noexcept
 {
 	if(maxConnections < 0)
 		return;
-	std::scoped_lock lock(mConnections);
-	auto search = connections.find(ip);
-	assert(search != connections.end());
-	search->second--;
-	if(search->second == 0)
-		connections.erase(search);
+	connections->Decrement(ip);
 }
 
 } // namespace Ignis::Multirole
@@ -1,16 +1,22 @@
 #ifndef LOBBY_HPP
 #define LOBBY_HPP
-#include <deque>
 #include <functional>
-#include <shared_mutex>
-#include <unordered_map>
+#include <memory>
+
+#include <boost/asio/ip/address.hpp>
 
-#include "RNG/SplitMix64.hpp"
 #include "Room/Instance.hpp"
 
 namespace Ignis::Multirole
 {
 
+namespace LobbyDetail
+{
+
+class ConnectionTable;
+
+} // namespace LobbyDetail
+
 class Lobby final
 {
 public:
@@ -22,15 +28,23 @@ public:
 		const std::string* notes;
 		bool passworded : 1;
 		bool started : 1;
+		std::size_t state; // Index within Room::StateVariant.
 		Room::DuelistsMap duelists;
 	};
 
+	// Binary form of an IP address, IPv4 addresses are stored as IPv4-mapped
+	// IPv6 addresses so both families share the same keys.
+	using IpKey = boost::asio::ip::address_v6::bytes_type;
+
 	Lobby(int maxConnections);
+	~Lobby();
+
+	static IpKey MakeIpKey(const boost::asio::ip::address& address) noexcept;
 
 	std::shared_ptr<Room::Instance> GetRoomById(uint32_t id) const;
 
 	// Tells if a particular IP has too many connections already.
-	bool HasMaxConnections(const std::string& ip) const;
+	bool HasMaxConnections(const IpKey& ip) const noexcept;
 
 	// Attempts to close all rooms whose state is not Waiting and
 	// clears the dictionary of weak references. Also sets a flag so that
@@ -38,24 +52,28 @@ public:
 	// Returns the number of rooms that were **not** closed.
 	std::size_t Close();
 
-	// Creates a single room and adds it to the dictionary.
+	// Tells if any room is still alive, including rooms made after Close.
+	bool HasRooms() const;
+
+	// Creates a single room and adds it to the dictionary, its ID is given
+	// back to the lobby as soon as the room is destroyed.
 	std::shared_ptr<Room::Instance> MakeRoom(Room::Instance::CreateInfo& info);
 
-	// Removes dead rooms from the dictionary and calls function f for each
-	// non-dead room with its properties as argument.
+	// Calls function f for each room, in ascending ID order, with its
+	// properties as argument.
 	void CollectRooms(const std::function<void(const RoomProps&)>& f);
 
 	// Change the number of active connections a particular IP has.
-	void IncrementConnectionCount(const std::string& ip);
-	void DecrementConnectionCount(const std::string& ip);
+	void IncrementConnectionCount(const IpKey& ip) noexcept;
+	void DecrementConnectionCount(const IpKey& ip) noexcept;
 private:
+	class Registry;
+
 	const int maxConnections;
-	RNG::SplitMix64 rng;
-	bool closed;
-	std::deque<std::pair<bool, std::weak_ptr<Room::Instance>>> rooms;
-	mutable std::shared_mutex mRooms;
-	std::unordered_map<std::string, int> connections;
-	mutable std::shared_mutex mConnections;
+	// NOTE: Shared with the deleter of every room, so rooms that outlive
+	// the lobby can still give their ID back safely.
+	const std::shared_ptr<Registry> registry;
+	const std::unique_ptr<LobbyDetail::ConnectionTable> connections;
 };
 
 } // namespace Ignis::Multirole
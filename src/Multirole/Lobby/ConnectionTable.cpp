@@ -0,0 +1,217 @@
+#include "ConnectionTable.hpp"
+
+#include <cstring> // std::memcpy
+
+namespace Ignis::Multirole::LobbyDetail
+{
+
+ConnectionTable::ConnectionTable() :
+	slots(std::make_unique<Slot[]>(CAPACITY)),
+	scratch(std::make_unique<Entry[]>(MAX_USED)),
+	used(0U),
+	reclaimable(false)
+{
+	for(std::size_t i = 0U; i < CAPACITY; i++)
+	{
+		slots[i].key[0U].store(0U, std::memory_order_relaxed);
+		slots[i].key[1U].store(0U, std::memory_order_relaxed);
+		slots[i].state.store(MakeState(0U, EMPTY), std::memory_order_relaxed);
+	}
+}
+
+int ConnectionTable::Count(const IpKey& ip) const noexcept
+{
+	uint64_t state = 0U;
+	if(Find(ToKey(ip), state) == nullptr)
+		return 0;
+	return static_cast<int>(ValueOf(state));
+}
+
+void ConnectionTable::Increment(const IpKey& ip) noexcept
+{
+	const Key key = ToKey(ip);
+	uint64_t state = 0U;
+	if(Slot* slot = Find(key, state); slot != nullptr && TryAdd(*slot, GenOf(state), 1))
+		return;
+	std::scoped_lock lock(mSlots);
+	Insert(key);
+}
+
+void ConnectionTable::Decrement(const IpKey& ip) noexcept
+{
+	const Key key = ToKey(ip);
+	uint64_t state = 0U;
+	uint32_t count = 0U;
+	if(Slot* slot = Find(key, state); slot == nullptr || !TryAdd(*slot, GenOf(state), -1, &count))
+	{
+		// NOTE: Slot was being moved, owners can't change while the
+		// mutex is held so this lookup is final.
+		std::scoped_lock lock(mSlots);
+		slot = Find(key, state);
+		if(slot == nullptr)
+			return; // IP was not tracked because the table was full.
+		TryAdd(*slot, GenOf(state), -1, &count);
+	}
+	if(count == 0U)
+		reclaimable.store(true, std::memory_order_relaxed);
+}
+
+// private
+
+ConnectionTable::Key ConnectionTable::ToKey(const IpKey& ip) noexcept
+{
+	static_assert(sizeof(Key) == sizeof(IpKey));
+	Key key;
+	std::memcpy(key.data(), ip.data(), sizeof(Key));
+	return key;
+}
+
+std::size_t ConnectionTable::HomeOf(const Key& key) noexcept
+{
+	uint64_t h = key[0U] ^ (key[1U] * 0x9E3779B97F4A7C15U);
+	h ^= h >> 33U;
+	h *= 0xFF51AFD7ED558CCDU;
+	h ^= h >> 33U;
+	return static_cast<std::size_t>(h) & (CAPACITY - 1U);
+}
+
+std::size_t ConnectionTable::Next(std::size_t i) noexcept
+{
+	return (i + 1U) & (CAPACITY - 1U);
+}
+
+bool ConnectionTable::KeyMatches(const Slot& slot, const Key& key) noexcept
+{
+	return slot.key[0U].load(std::memory_order_relaxed) == key[0U] &&
+	       slot.key[1U].load(std::memory_order_relaxed) == key[1U];
+}
+
+ConnectionTable::Slot* ConnectionTable::Find(const Key& key, uint64_t& state) const noexcept
+{
+	std::size_t i = HomeOf(key);
+	for(std::size_t n = 0U; n < CAPACITY;)
+	{
+		Slot& slot = slots[i];
+		const uint64_t before = slot.state.load(std::memory_order_acquire);
+		if(ValueOf(before) == EMPTY)
+			return nullptr;
+		if(IsOwned(before))
+		{
+			const bool matches = KeyMatches(slot, key);
+			// Makes sure the key read belongs to the same owner.
+			std::atomic_thread_fence(std::memory_order_acquire);
+			const uint64_t after = slot.state.load(std::memory_order_relaxed);
+			if(GenOf(after) != GenOf(before))
+				continue; // Owner changed while reading, check again.
+			if(matches)
+			{
+				state = after;
+				return &slot;
+			}
+		}
+		i = Next(i);
+		n++;
+	}
+	return nullptr;
+}
+
+bool ConnectionTable::TryAdd(Slot& slot, uint32_t gen, int delta, uint32_t* result) noexcept
+{
+	uint64_t state = slot.state.load(std::memory_order_relaxed);
+	for(;;)
+	{
+		if(GenOf(state) != gen || !IsOwned(state))
+			return false;
+		uint32_t next = ValueOf(state);
+		if(delta >= 0 || next != 0U)
+			next += static_cast<uint32_t>(delta);
+		if(next == ValueOf(state) ||
+		   slot.state.compare_exchange_weak(state, MakeState(gen, next), std::memory_order_relaxed))
+		{
+			if(result != nullptr)
+				*result = next;
+			return true;
+		}
+	}
+}
+
+void ConnectionTable::Claim(Slot& slot, const Key& key, uint32_t gen, uint32_t count) noexcept
+{
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.key[0U].store(key[0U], std::memory_order_relaxed);
+	slot.key[1U].store(key[1U], std::memory_order_relaxed);
+	slot.state.store(MakeState(gen, count), std::memory_order_release);
+}
+
+void ConnectionTable::Insert(const Key& key) noexcept
+{
+	for(bool rebuilt = false;;)
+	{
+		std::size_t i = HomeOf(key);
+		for(std::size_t n = 0U; n < CAPACITY; n++, i = Next(i))
+		{
+			Slot& slot = slots[i];
+			uint64_t state = slot.state.load(std::memory_order_relaxed);
+			if(ValueOf(state) == EMPTY)
+			{
+				if(used >= MAX_USED)
+					break;
+				used++;
+				const uint32_t gen = GenOf(state) + 1U;
+				slot.state.store(MakeState(gen, BUSY), std::memory_order_relaxed);
+				Claim(slot, key, gen, 1U);
+				return;
+			}
+			if(KeyMatches(slot, key))
+			{
+				TryAdd(slot, GenOf(state), 1);
+				return;
+			}
+		}
+		if(rebuilt || !reclaimable.exchange(false, std::memory_order_relaxed))
+			return; // Table is full of connected IPs, this one is not limited.
+		Rebuild();
+		rebuilt = true;
+	}
+}
+
+void ConnectionTable::Rebuild() noexcept
+{
+	std::size_t count = 0U;
+	for(std::size_t i = 0U; i < CAPACITY; i++)
+	{
+		Slot& slot = slots[i];
+		uint64_t state = slot.state.load(std::memory_order_relaxed);
+		while(IsOwned(state))
+		{
+			if(!slot.state.compare_exchange_weak(state,
+				MakeState(GenOf(state) + 1U, BUSY), std::memory_order_relaxed))
+				continue;
+			if(ValueOf(state) != 0U)
+			{
+				const Key key{slot.key[0U].load(std::memory_order_relaxed),
+				              slot.key[1U].load(std::memory_order_relaxed)};
+				scratch[count++] = {key, ValueOf(state)};
+			}
+			break;
+		}
+	}
+	for(std::size_t i = 0U; i < CAPACITY; i++)
+	{
+		const uint64_t state = slots[i].state.load(std::memory_order_relaxed);
+		slots[i].state.store(MakeState(GenOf(state), EMPTY), std::memory_order_relaxed);
+	}
+	used = count;
+	for(std::size_t e = 0U; e < count; e++)
+	{
+		std::size_t i = HomeOf(scratch[e].key);
+		while(ValueOf(slots[i].state.load(std::memory_order_relaxed)) != EMPTY)
+			i = Next(i);
+		Slot& slot = slots[i];
+		const uint32_t gen = GenOf(slot.state.load(std::memory_order_relaxed)) + 1U;
+		slot.state.store(MakeState(gen, BUSY), std::memory_order_relaxed);
+		Claim(slot, scratch[e].key, gen, scratch[e].count);
+	}
+}
+
+} // namespace Ignis::Multirole::LobbyDetail
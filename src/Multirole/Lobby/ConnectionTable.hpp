@@ -0,0 +1,110 @@
+#ifndef MULTIROLE_LOBBY_CONNECTIONTABLE_HPP
+#define MULTIROLE_LOBBY_CONNECTIONTABLE_HPP
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include <boost/asio/ip/address_v6.hpp>
+
+namespace Ignis::Multirole::LobbyDetail
+{
+
+// Counts the connections each IP has on a fixed size open addressing table.
+// Counting for an IP that already has a slot only takes atomic operations on
+// that slot, the mutex is only taken to give a slot to an IP without one.
+class ConnectionTable final
+{
+public:
+	// Same as Lobby::IpKey.
+	using IpKey = boost::asio::ip::address_v6::bytes_type;
+
+	static constexpr std::size_t CAPACITY = 1U << 16U;
+	static constexpr std::size_t MAX_USED = CAPACITY / 2U;
+
+	ConnectionTable();
+
+	// NOTE: Might report 0 for an IP while the table is being rebuilt.
+	int Count(const IpKey& ip) const noexcept;
+
+	void Increment(const IpKey& ip) noexcept;
+	void Decrement(const IpKey& ip) noexcept;
+private:
+	// NOTE: The low half of a slot state is either the connection count of
+	// the IP that owns the slot or one of the special values below, the high
+	// half is bumped every time the slot changes owner, so a thread holding
+	// an old state can never update a slot that now belongs to another IP.
+	static constexpr uint32_t EMPTY = 0xFFFFFFFFU; // Unowned, ends a chain.
+	static constexpr uint32_t BUSY = 0xFFFFFFFEU; // Changing owner.
+
+	using Key = std::array<uint64_t, 2U>;
+
+	struct Slot
+	{
+		std::atomic<uint64_t> key[2U];
+		std::atomic<uint64_t> state;
+	};
+
+	struct Entry
+	{
+		Key key;
+		uint32_t count;
+	};
+
+	const std::unique_ptr<Slot[]> slots;
+	const std::unique_ptr<Entry[]> scratch; // Used while rebuilding.
+	std::size_t used; // Slots that are not EMPTY.
+	// Set whenever an IP drops to zero connections, avoids rebuilding over
+	// and over when the table is full of IPs that are all connected.
+	std::atomic<bool> reclaimable;
+	std::mutex mSlots;
+
+	static constexpr uint64_t MakeState(uint32_t gen, uint32_t value) noexcept
+	{
+		return (uint64_t{gen} << 32U) | value;
+	}
+
+	static constexpr uint32_t GenOf(uint64_t state) noexcept
+	{
+		return static_cast<uint32_t>(state >> 32U);
+	}
+
+	static constexpr uint32_t ValueOf(uint64_t state) noexcept
+	{
+		return static_cast<uint32_t>(state);
+	}
+
+	static constexpr bool IsOwned(uint64_t state) noexcept
+	{
+		return ValueOf(state) < BUSY;
+	}
+
+	static Key ToKey(const IpKey& ip) noexcept;
+	static std::size_t HomeOf(const Key& key) noexcept;
+	static std::size_t Next(std::size_t i) noexcept;
+	static bool KeyMatches(const Slot& slot, const Key& key) noexcept;
+
+	// Looks for the slot owned by the given key, writing the state it had
+	// when its key was read. Returns nullptr if there's none.
+	Slot* Find(const Key& key, uint64_t& state) const noexcept;
+
+	// Adds `delta` to the count of a slot as long as it still has the same
+	// owner, returns false otherwise. The new count is written to `result`.
+	static bool TryAdd(Slot& slot, uint32_t gen, int delta, uint32_t* result = nullptr) noexcept;
+
+	// Gives a slot to the key, which must have been taken with BUSY first.
+	static void Claim(Slot& slot, const Key& key, uint32_t gen, uint32_t count) noexcept;
+
+	// NOTE: Both of these are only called with mSlots held.
+
+	void Insert(const Key& key) noexcept;
+
+	// Moves every IP that has connections back to the slot closest to its
+	// home, dropping the ones without connections.
+	void Rebuild() noexcept;
+};
+
+} // namespace Ignis::Multirole::LobbyDetail
+
+#endif // MULTIROLE_LOBBY_CONNECTIONTABLE_HPP
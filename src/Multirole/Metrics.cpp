@@ -0,0 +1,286 @@
+#include "Metrics.hpp"
+
+#include <array>
+#include <atomic>
+#include <iterator> // std::back_inserter
+#include <string_view>
+
+#include "../HornetCommon.hpp"
+#include "YGOPro/STOCMsg.hpp"
+
+namespace Ignis::Multirole::Metrics
+{
+
+namespace
+{
+
+// NOTE: Threads are assigned a shard in a round-robin fashion the first time
+// they record something, having more threads than shards just means some of
+// them will share one, which is still correct.
+constexpr std::size_t SHARD_COUNT = 16U;
+
+constexpr std::size_t COUNTER_COUNT = static_cast<std::size_t>(Counter::COUNTER_COUNT);
+constexpr std::size_t HISTOGRAM_COUNT = static_cast<std::size_t>(Histogram::HISTOGRAM_COUNT);
+constexpr std::size_t HORNET_ACTION_COUNT = static_cast<std::size_t>(Hornet::Action::CB_DONE) + 1U;
+constexpr std::size_t MSG_TYPE_COUNT = 256U;
+
+// Upper bounds of the histogram buckets, in microseconds. An extra bucket
+// catches everything above the last bound.
+constexpr std::array<uint64_t, 18U> BUCKET_BOUNDS =
+{
+	50U, 100U, 250U, 500U,
+	1'000U, 2'500U, 5'000U, 10'000U, 25'000U, 50'000U, 100'000U, 250'000U, 500'000U,
+	1'000'000U, 2'500'000U, 5'000'000U, 10'000'000U, 30'000'000U
+};
+
+struct HistogramData
+{
+	std::array<std::atomic<uint64_t>, BUCKET_BOUNDS.size() + 1U> buckets;
+	std::atomic<uint64_t> sum; // In microseconds.
+};
+
+struct alignas(64U) Shard
+{
+	// NOTE: Kept unsigned so gauges can be decremented on a different shard
+	// than the one that incremented them, the total wraps back correctly.
+	std::array<std::atomic<uint64_t>, COUNTER_COUNT> counters;
+	std::array<std::atomic<uint64_t>, MSG_TYPE_COUNT> msgsSent;
+	std::array<std::atomic<uint64_t>, MSG_TYPE_COUNT> bytesSent;
+	std::array<HistogramData, HISTOGRAM_COUNT> histograms;
+	std::array<HistogramData, HORNET_ACTION_COUNT> hornet;
+};
+
+Shard shards[SHARD_COUNT]{};
+std::atomic<std::size_t> nextShard{0U};
+
+struct MetricDesc
+{
+	std::string_view name;
+	std::string_view type;
+	std::string_view help;
+};
+
+constexpr std::array<MetricDesc, COUNTER_COUNT> COUNTER_DESCS =
+{{
+	{"multirole_clients_connected", "gauge", "Clients currently connected to a room."},
+	{"multirole_card_data_cache_hits_total", "counter", "Card data lookups served from the database cache."},
+	{"multirole_card_data_cache_misses_total", "counter", "Card data lookups that had to query the database."},
+	{"multirole_card_extra_cache_hits_total", "counter", "Card extra data lookups served from the database cache."},
+	{"multirole_card_extra_cache_misses_total", "counter", "Card extra data lookups that had to query the database."},
+	{"multirole_deck_check_cache_hits_total", "counter", "Deck checks answered from the results of a previous check."},
+	{"multirole_deck_check_cache_misses_total", "counter", "Deck checks that had to go through every card."},
+	{"multirole_connections_ip_rate_limited_total", "counter", "Connections dropped because their IP connected too often."},
+	{"multirole_connections_prefix_rate_limited_total", "counter", "Connections dropped because their network prefix connected too often."},
+	{"multirole_connections_handshakes_full_total", "counter", "Connections dropped because too many handshakes were in flight."},
+	{"multirole_handshakes_timed_out_total", "counter", "Connections closed for not joining a room in time."},
+	{"multirole_canary_calls_skipped_total", "counter", "Core calls not mirrored on a candidate core because it fell behind."},
+}};
+
+constexpr std::array<MetricDesc, HISTOGRAM_COUNT> HISTOGRAM_DESCS =
+{{
+	{"multirole_context_process_seconds", "histogram", "Time taken to process a duel until it needs a response."},
+	{"multirole_replay_serialize_seconds", "histogram", "Time taken to serialize a replay."},
+	{"multirole_git_update_seconds", "histogram", "Time taken to fetch and update a repository."},
+}};
+
+constexpr std::array<std::string_view, HORNET_ACTION_COUNT> HORNET_ACTION_NAMES =
+{
+	"NO_WORK",
+	"HEARTBEAT",
+	"EXIT",
+	"EXIT_CONFIRMED",
+	"OCG_GET_VERSION",
+	"OCG_CREATE_DUEL",
+	"OCG_DESTROY_DUEL",
+	"OCG_DUEL_NEW_CARD",
+	"OCG_START_DUEL",
+	"OCG_DUEL_PROCESS",
+	"OCG_DUEL_GET_MESSAGE",
+	"OCG_DUEL_SET_RESPONSE",
+	"OCG_LOAD_SCRIPT",
+	"OCG_DUEL_QUERY_COUNT",
+	"OCG_DUEL_QUERY",
+	"OCG_DUEL_QUERY_LOCATION",
+	"OCG_DUEL_QUERY_FIELD",
+	"CB_DATA_READER",
+	"CB_SCRIPT_READER",
+	"CB_LOG_HANDLER",
+	"CB_DATA_READER_DONE",
+	"CB_DONE",
+};
+
+constexpr std::string_view MsgTypeName(uint8_t type) noexcept
+{
+	using MsgType = YGOPro::STOCMsg::MsgType;
+	switch(static_cast<MsgType>(type))
+	{
+#define X(v) case MsgType::v: return #v;
+	X(GAME_MSG)
+	X(ERROR_MSG)
+	X(CHOOSE_RPS)
+	X(CHOOSE_ORDER)
+	X(RPS_RESULT)
+	X(ORDER_RESULT)
+	X(CHANGE_SIDE)
+	X(WAITING_SIDE)
+	X(CREATE_GAME)
+	X(JOIN_GAME)
+	X(TYPE_CHANGE)
+	X(LEAVE_GAME)
+	X(DUEL_START)
+	X(DUEL_END)
+	X(REPLAY)
+	X(TIME_LIMIT)
+	X(PLAYER_ENTER)
+	X(PLAYER_CHANGE)
+	X(WATCH_CHANGE)
+	X(NEW_REPLAY)
+	X(CATCHUP)
+	X(REMATCH)
+	X(REMATCH_WAIT)
+	X(CHAT_2)
+#undef X
+	}
+	return {};
+}
+
+inline Shard& LocalShard() noexcept
+{
+	thread_local Shard& shard = shards[nextShard++ % SHARD_COUNT];
+	return shard;
+}
+
+inline void Record(HistogramData& hd, Clock::duration d) noexcept
+{
+	const auto us = static_cast<uint64_t>(
+		std::chrono::duration_cast<std::chrono::microseconds>(d).count());
+	std::size_t i = 0U;
+	while(i < BUCKET_BOUNDS.size() && us > BUCKET_BOUNDS[i])
+		i++;
+	hd.buckets[i].fetch_add(1U, std::memory_order_relaxed);
+	hd.sum.fetch_add(us, std::memory_order_relaxed);
+}
+
+template<typename Func>
+inline uint64_t Sum(Func&& f) noexcept
+{
+	uint64_t total = 0U;
+	for(const auto& shard : shards)
+		total += f(shard).load(std::memory_order_relaxed);
+	return total;
+}
+
+inline void WriteHeader(fmt::memory_buffer& out, const MetricDesc& desc)
+{
+	fmt::format_to(std::back_inserter(out), "# HELP {0} {1}\n# TYPE {0} {2}\n",
+		desc.name, desc.help, desc.type);
+}
+
+// NOTE: `labels` must either be empty or end with a comma.
+template<typename Func>
+void WriteHistogram(fmt::memory_buffer& out, std::string_view name, std::string_view labels, Func&& f)
+{
+	uint64_t cumulative = 0U;
+	for(std::size_t i = 0U; i <= BUCKET_BOUNDS.size(); i++)
+	{
+		cumulative += Sum([&](const Shard& s) -> auto& {return f(s).buckets[i];});
+		if(i < BUCKET_BOUNDS.size())
+			fmt::format_to(std::back_inserter(out), "{}_bucket{{{}le=\"{}\"}} {}\n",
+				name, labels, static_cast<double>(BUCKET_BOUNDS[i]) / 1e6, cumulative);
+		else
+			fmt::format_to(std::back_inserter(out), "{}_bucket{{{}le=\"+Inf\"}} {}\n",
+				name, labels, cumulative);
+	}
+	const auto sum = Sum([&](const Shard& s) -> auto& {return f(s).sum;});
+	if(labels.empty())
+	{
+		fmt::format_to(std::back_inserter(out), "{}_sum {}\n{}_count {}\n",
+			name, static_cast<double>(sum) / 1e6, name, cumulative);
+		return;
+	}
+	labels.remove_suffix(1U);
+	fmt::format_to(std::back_inserter(out), "{0}_sum{{{1}}} {2}\n{0}_count{{{1}}} {3}\n",
+		name, labels, static_cast<double>(sum) / 1e6, cumulative);
+}
+
+} // namespace
+
+void Add(Counter c, int64_t n) noexcept
+{
+	LocalShard().counters[static_cast<std::size_t>(c)].fetch_add(
+		static_cast<uint64_t>(n), std::memory_order_relaxed);
+}
+
+void Observe(Histogram h, Clock::duration d) noexcept
+{
+	Record(LocalShard().histograms[static_cast<std::size_t>(h)], d);
+}
+
+void MsgSent(uint8_t type, std::size_t bytes) noexcept
+{
+	auto& shard = LocalShard();
+	shard.msgsSent[type].fetch_add(1U, std::memory_order_relaxed);
+	shard.bytesSent[type].fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void ObserveHornet(Hornet::Action act, Clock::duration d) noexcept
+{
+	if(const auto i = static_cast<std::size_t>(act); i < HORNET_ACTION_COUNT)
+		Record(LocalShard().hornet[i], d);
+}
+
+void Render(fmt::memory_buffer& out)
+{
+	for(std::size_t c = 0U; c < COUNTER_COUNT; c++)
+	{
+		const auto& desc = COUNTER_DESCS[c];
+		const auto total = Sum([&](const Shard& s) -> auto& {return s.counters[c];});
+		WriteHeader(out, desc);
+		if(desc.type == "gauge")
+			fmt::format_to(std::back_inserter(out), "{} {}\n", desc.name, static_cast<int64_t>(total));
+		else
+			fmt::format_to(std::back_inserter(out), "{} {}\n", desc.name, total);
+	}
+	auto WriteMsgCounter = [&](const MetricDesc& desc, auto member)
+	{
+		WriteHeader(out, desc);
+		for(std::size_t t = 0U; t < MSG_TYPE_COUNT; t++)
+		{
+			const auto total = Sum([&](const Shard& s) -> auto& {return (s.*member)[t];});
+			if(total == 0U)
+				continue;
+			if(const auto name = MsgTypeName(static_cast<uint8_t>(t)); !name.empty())
+				fmt::format_to(std::back_inserter(out), "{}{{type=\"{}\"}} {}\n", desc.name, name, total);
+			else
+				fmt::format_to(std::back_inserter(out), "{}{{type=\"{}\"}} {}\n", desc.name, t, total);
+		}
+	};
+	WriteMsgCounter({"multirole_stoc_msgs_sent_total", "counter",
+		"Messages sent to clients by message type."}, &Shard::msgsSent);
+	WriteMsgCounter({"multirole_stoc_bytes_sent_total", "counter",
+		"Bytes sent to clients by message type."}, &Shard::bytesSent);
+	for(std::size_t h = 0U; h < HISTOGRAM_COUNT; h++)
+	{
+		WriteHeader(out, HISTOGRAM_DESCS[h]);
+		WriteHistogram(out, HISTOGRAM_DESCS[h].name, {},
+			[&](const Shard& s) -> auto& {return s.histograms[h];});
+	}
+	constexpr MetricDesc HORNET_DESC{"multirole_hornet_round_trip_seconds", "histogram",
+		"Time taken for a request to Hornet to complete, by action."};
+	WriteHeader(out, HORNET_DESC);
+	for(std::size_t a = 0U; a < HORNET_ACTION_COUNT; a++)
+	{
+		// NOTE: Skip actions that never happened, most of them are callbacks
+		// which are only ever requested by Hornet.
+		uint64_t count = 0U;
+		for(std::size_t i = 0U; i <= BUCKET_BOUNDS.size(); i++)
+			count += Sum([&](const Shard& s) -> auto& {return s.hornet[a].buckets[i];});
+		if(count == 0U)
+			continue;
+		const auto labels = fmt::format("action=\"{}\",", HORNET_ACTION_NAMES[a]);
+		WriteHistogram(out, HORNET_DESC.name, labels,
+			[&](const Shard& s) -> auto& {return s.hornet[a];});
+	}
+}
+
+} // namespace Ignis::Multirole::Metrics
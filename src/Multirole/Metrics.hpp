@@ -0,0 +1,89 @@
+#ifndef MULTIROLE_METRICS_HPP
+#define MULTIROLE_METRICS_HPP
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include <fmt/format.h>
+
+namespace Ignis::Hornet
+{
+
+enum class Action : uint8_t;
+
+} // namespace Ignis::Hornet
+
+namespace Ignis::Multirole::Metrics
+{
+
+// Process-wide registry of runtime metrics. Every value is split in a fixed
+// amount of cache line aligned shards, each thread always records on the same
+// shard so threads rarely contend on the same atomics, the shards are only
+// summed up when the metrics are rendered.
+
+enum class Counter : std::size_t
+{
+	CLIENTS_CONNECTED, // Gauge: incremented and decremented.
+	CARD_DATA_CACHE_HITS,
+	CARD_DATA_CACHE_MISSES,
+	CARD_EXTRA_CACHE_HITS,
+	CARD_EXTRA_CACHE_MISSES,
+	DECK_CHECK_CACHE_HITS,
+	DECK_CHECK_CACHE_MISSES,
+	CONNECTIONS_IP_RATE_LIMITED,
+	CONNECTIONS_PREFIX_RATE_LIMITED,
+	CONNECTIONS_HANDSHAKES_FULL,
+	HANDSHAKES_TIMED_OUT,
+	CANARY_CALLS_SKIPPED,
+
+	COUNTER_COUNT
+};
+
+enum class Histogram : std::size_t
+{
+	CONTEXT_PROCESS,
+	REPLAY_SERIALIZE,
+	GIT_UPDATE,
+
+	HISTOGRAM_COUNT
+};
+
+using Clock = std::chrono::steady_clock;
+
+void Add(Counter c, int64_t n = 1) noexcept;
+void Observe(Histogram h, Clock::duration d) noexcept;
+
+// Records a message sent to a client, `type` is its STOCMsg::MsgType.
+void MsgSent(uint8_t type, std::size_t bytes) noexcept;
+
+// Records the time taken for a whole exchange with Hornet, including the
+// callbacks it requested in between.
+void ObserveHornet(Hornet::Action act, Clock::duration d) noexcept;
+
+// Appends all the metrics in Prometheus' text exposition format.
+void Render(fmt::memory_buffer& out);
+
+// Observes the time elapsed since its construction on destruction.
+class ScopedTimer final
+{
+public:
+	ScopedTimer(Histogram h) noexcept :
+		h(h),
+		start(Clock::now())
+	{}
+
+	~ScopedTimer() noexcept
+	{
+		Observe(h, Clock::now() - start);
+	}
+
+	ScopedTimer(const ScopedTimer&) = delete;
+	ScopedTimer& operator=(const ScopedTimer&) = delete;
+private:
+	const Histogram h;
+	const Clock::time_point start;
+};
+
+} // namespace Ignis::Multirole::Metrics
+
+#endif // MULTIROLE_METRICS_HPP
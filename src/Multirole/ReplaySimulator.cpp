@@ -0,0 +1,315 @@
+#include "ReplaySimulator.hpp"
+
+#include <algorithm> // std::equal
+#include <deque>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+#include "AccountingResource.hpp"
+#include "Core/IScriptSupplier.hpp"
+#include "Core/IWrapper.hpp"
+#include "Room/MsgPipeline.hpp"
+#include "YGOPro/Constants.hpp"
+#include "YGOPro/CoreUtils.hpp"
+#include "YGOPro/QueryCache.hpp"
+#include "YGOPro/Replay.hpp"
+#include "YGOPro/ReplayReader.hpp"
+#include "YGOPro/STOCMsg.hpp"
+
+namespace Ignis::Multirole
+{
+
+namespace
+{
+
+// Stand-in for the clients of a room, only keeping what spectators would
+// have received, which is what a room keeps in memory, and counting the bytes
+// sent as if there was a single duelist per team and a single spectator.
+class Output final : public Room::IMsgOutput
+{
+public:
+	Output(AccountingResource& memory, std::pmr::deque<YGOPro::STOCMsg>& spectatorCache, std::size_t& bytesSent, ISimulationProbe* probe) noexcept :
+		memory(memory),
+		spectatorCache(spectatorCache),
+		bytesSent(bytesSent),
+		probe(probe)
+	{}
+
+	void SendToDuelist(uint8_t team, const YGOPro::STOCMsg& msg) noexcept override
+	{
+		Sent(team, msg);
+	}
+
+	void SendToTeam(uint8_t team, const YGOPro::STOCMsg& msg) noexcept override
+	{
+		Sent(team, msg);
+	}
+
+	void SendToSpectators(YGOPro::STOCMsg&& msg) noexcept override
+	{
+		Sent(SPECTATORS, msg);
+		SaveToSpectatorCache(std::move(msg));
+	}
+
+	void SendToAllExceptDuelist(uint8_t team, YGOPro::STOCMsg&& msg) noexcept override
+	{
+		Sent(1U - team, msg);
+		Sent(SPECTATORS, msg);
+		SaveToSpectatorCache(std::move(msg));
+	}
+
+	void SendToAll(YGOPro::STOCMsg&& msg) noexcept override
+	{
+		Sent(0U, msg);
+		Sent(1U, msg);
+		Sent(SPECTATORS, msg);
+		SaveToSpectatorCache(std::move(msg));
+	}
+private:
+	static constexpr uint8_t SPECTATORS = 2U;
+
+	AccountingResource& memory;
+	std::pmr::deque<YGOPro::STOCMsg>& spectatorCache;
+	std::size_t& bytesSent;
+	ISimulationProbe* const probe;
+
+	void Sent(uint8_t audience, const YGOPro::STOCMsg& msg) noexcept
+	{
+		bytesSent += msg.Length();
+		if(probe != nullptr)
+			probe->OnMsgSent(audience, msg);
+	}
+
+	void SaveToSpectatorCache(YGOPro::STOCMsg&& msg) noexcept
+	{
+		memory.Charge(msg.HeapSize());
+		spectatorCache.emplace_back(std::move(msg));
+	}
+};
+
+} // namespace
+
+ReplaySimulator::ReplaySimulator(
+	Core::IWrapper& core,
+	Core::IDataSupplier& dataSupplier,
+	Core::IScriptSupplier& scriptSupplier,
+	bool sendEveryRefresh) noexcept
+	:
+	core(core),
+	dataSupplier(dataSupplier),
+	scriptSupplier(scriptSupplier),
+	sendEveryRefresh(sendEveryRefresh)
+{}
+
+ReplaySimulator::Result ReplaySimulator::Run(const YGOPro::ReplayReader& replay, ISimulationProbe* probe) noexcept
+{
+	Result result{Outcome::OUTCOME_DUEL_ENDED, {}, 0U, {}, 0U, 0U};
+	try
+	{
+		Simulate(replay, probe, result);
+	}
+	catch(const std::exception& e)
+	{
+		// NOTE: Neither the suppliers nor allocations are expected to fail,
+		// but if they do, only this replay is given up on.
+		result.outcome = Outcome::OUTCOME_FAILED;
+		result.error = e.what();
+	}
+	return result;
+}
+
+// private
+
+void ReplaySimulator::Simulate(const YGOPro::ReplayReader& replay, ISimulationProbe* probe, Result& result)
+{
+	using namespace YGOPro;
+	using namespace YGOPro::CoreUtils;
+	AccountingResource memory;
+	// Released after each Process call, same as the room does.
+	std::pmr::monotonic_buffer_resource scratch;
+	// Replay used to record the regenerated messages exactly like the room
+	// would have recorded them.
+	const HostInfo hostInfo = [&]()
+	{
+		HostInfo info{};
+		info.startingLP = replay.StartingLP();
+		info.startingDrawCount = static_cast<uint8_t>(replay.StartingDrawCount());
+		info.drawCountPerTurn = static_cast<uint8_t>(replay.DrawCountPerTurn());
+		info.duelFlagsHigh = static_cast<uint32_t>(replay.DuelFlags() >> 32U);
+		info.duelFlagsLow = static_cast<uint32_t>(replay.DuelFlags());
+		return info;
+	}();
+	Replay recorder(replay.Timestamp(), replay.Seed(), hostInfo, replay.ExtraCards(), &memory);
+	// Stand-ins for the room state that is not relevant without clients.
+	std::pmr::deque<STOCMsg> spectatorCache(&memory);
+	QueryCache queryCache(&memory);
+	Output output(memory, spectatorCache, result.bytesSent, probe);
+	Msg lastHint;
+	Msg lastRequest;
+	Core::IWrapper::Duel duel = nullptr;
+	std::optional<Room::MsgPipeline> pipeline;
+	// Returns true if the duel should not continue after this message.
+	auto ProcessSingleMsg = [&](const Msg& msg) -> bool
+	{
+		const uint8_t msgType = GetMessageType(msg);
+		if(msgType == MSG_HINT && msg[1U] == 3U) // NOLINT: HINT_SELECTMSG
+			lastHint = msg;
+		else if(DoesMessageRequireAnswer(msgType))
+			lastRequest = msg;
+		pipeline->Handle(msg);
+		// NOTE: A rejected response is never stored on a replay unless it
+		// was the one that ended the duel, so any retry is final here.
+		if(msgType == MSG_RETRY)
+		{
+			result.outcome = Outcome::OUTCOME_RETRY_RECEIVED;
+			return true;
+		}
+		return msgType == MSG_WIN;
+	};
+	try
+	{
+		const Core::IWrapper::Player popt =
+		{
+			replay.StartingLP(),
+			replay.StartingDrawCount(),
+			replay.DrawCountPerTurn()
+		};
+		const Core::IWrapper::DuelOptions dopts =
+		{
+			dataSupplier,
+			scriptSupplier,
+			nullptr,
+			replay.Seed(),
+			replay.DuelFlags(),
+			popt,
+			popt
+		};
+		duel = core.CreateDuel(dopts);
+		pipeline.emplace(core, duel, recorder, sendEveryRefresh ? nullptr : &queryCache, output, scratch);
+		auto LoadScript = [&](std::string_view file)
+		{
+			const auto script = scriptSupplier.ScriptFromFilePath(file);
+			if(const char* const data = Core::IScriptSupplier::GetData(script); data != nullptr)
+				core.LoadScript(duel, file, {data, Core::IScriptSupplier::GetSize(script)});
+		};
+		LoadScript("constant.lua");
+		LoadScript("utility.lua");
+		OCG_NewCardInfo nci{};
+		nci.pos = POS_FACEDOWN_DEFENSE;
+		for(auto code : replay.ExtraCards())
+		{
+			nci.code = code;
+			core.AddCard(duel, nci);
+		}
+		// NOTE: Decks are stored already shuffled and keyed by the team and
+		// duelist index the core uses, so they are added as they are.
+		for(uint8_t team = 0U; team < 2U; team++)
+		{
+			for(const auto& kv : replay.Duelists()[team])
+			{
+				nci.team = nci.con = team;
+				nci.duelist = kv.first;
+				nci.loc = LOCATION_DECK;
+				for(auto code : kv.second.main)
+				{
+					nci.code = code;
+					core.AddCard(duel, nci);
+				}
+				nci.loc = LOCATION_EXTRA;
+				for(auto code : kv.second.extra)
+				{
+					nci.code = code;
+					core.AddCard(duel, nci);
+				}
+				auto duelist = kv.second;
+				recorder.AddDuelist(team, kv.first, std::move(duelist));
+			}
+		}
+		core.Start(duel);
+		recorder.RecordMsg(MakeStartMsg(
+			{
+				replay.StartingLP(),
+				core.QueryCount(duel, 0U, LOCATION_DECK),
+				core.QueryCount(duel, 0U, LOCATION_EXTRA),
+				core.QueryCount(duel, 1U, LOCATION_DECK),
+				core.QueryCount(duel, 1U, LOCATION_EXTRA),
+			}));
+		auto RecordLocation = [&](uint8_t team, uint32_t loc, uint32_t flags)
+		{
+			const Core::IWrapper::QueryInfo qInfo = {flags, team, loc, 0U, 0U};
+			const auto buffer = core.QueryLocation(duel, qInfo);
+			recorder.RecordMsg(MakeUpdateDataMsg(qInfo.con, qInfo.loc, buffer));
+		};
+		RecordLocation(0U, LOCATION_DECK, 0x1181FFF);
+		RecordLocation(1U, LOCATION_DECK, 0x1181FFF);
+		RecordLocation(0U, LOCATION_EXTRA, 0x381FFF);
+		RecordLocation(1U, LOCATION_EXTRA, 0x381FFF);
+		auto nextResponse = replay.Responses().cbegin();
+		for(bool finished = false; !finished;)
+		{
+			pipeline->NewBatch();
+			scratch.release();
+			if(probe != nullptr)
+				probe->OnProcessBegin();
+			const auto status = core.Process(duel);
+			const auto msgs = SplitToMsgs(core.GetMessages(duel), &scratch);
+			if(probe != nullptr)
+				probe->OnProcessEnd();
+			for(const auto& msg : msgs)
+			{
+				const uint8_t msgType = GetMessageType(msg);
+				if(probe != nullptr)
+					probe->OnMsgBegin(msgType);
+				finished = ProcessSingleMsg(msg);
+				if(probe != nullptr)
+					probe->OnMsgEnd(msgType);
+				if(finished)
+					break;
+			}
+			if(finished || status == Core::IWrapper::DuelStatus::DUEL_STATUS_END)
+				break;
+			if(status != Core::IWrapper::DuelStatus::DUEL_STATUS_WAITING)
+				continue;
+			if(nextResponse == replay.Responses().cend())
+			{
+				result.outcome = Outcome::OUTCOME_RESPONSES_EXHAUSTED;
+				break;
+			}
+			recorder.RecordResponse(*nextResponse);
+			core.SetResponse(duel, *nextResponse++);
+			result.responsesUsed++;
+		}
+		core.DestroyDuel(duel);
+	}
+	catch(Core::Exception& e)
+	{
+		// NOTE: Like in the room, the duel is not destroyed as the core
+		// state can't be trusted anymore.
+		result.outcome = Outcome::OUTCOME_CORE_EXCEPTION;
+		result.error = e.what();
+	}
+	result.messages = recorder.Messages();
+	result.memoryPeak = memory.Peak();
+}
+
+bool ReplaySimulator::Matches(const YGOPro::ReplayReader& replay, const Result& result) noexcept
+{
+	if(result.outcome == Outcome::OUTCOME_FAILED)
+		return false;
+	const auto& stored = replay.Messages();
+	const auto& regenerated = result.messages;
+	auto SameMsg = [](const auto& a, const auto& b)
+	{
+		return std::equal(a.cbegin(), a.cend(), b.cbegin(), b.cend());
+	};
+	if(stored.size() == regenerated.size())
+		return std::equal(stored.cbegin(), stored.cend(), regenerated.cbegin(), SameMsg);
+	if(result.outcome == Outcome::OUTCOME_DUEL_ENDED)
+		return false;
+	if(stored.size() != regenerated.size() + 1U || stored.back()[0U] != MSG_WIN)
+		return false;
+	return std::equal(regenerated.cbegin(), regenerated.cend(), stored.cbegin(), SameMsg);
+}
+
+} // namespace Ignis::Multirole
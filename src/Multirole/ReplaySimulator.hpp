@@ -0,0 +1,106 @@
+#ifndef REPLAYSIMULATOR_HPP
+#define REPLAYSIMULATOR_HPP
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "YGOPro/Replay.hpp"
+
+namespace YGOPro
+{
+
+class ReplayReader;
+class STOCMsg;
+
+} // namespace YGOPro
+
+namespace Ignis::Multirole
+{
+
+namespace Core
+{
+
+class IDataSupplier;
+class IScriptSupplier;
+class IWrapper;
+
+} // namespace Core
+
+// Hooks called around each step of a simulation, used by tools to measure
+// what happens within them. All of them are called from the thread that
+// called ReplaySimulator::Run.
+class ISimulationProbe
+{
+public:
+	virtual void OnProcessBegin() noexcept = 0;
+	virtual void OnProcessEnd() noexcept = 0;
+	virtual void OnMsgBegin(uint8_t msgType) noexcept = 0;
+	virtual void OnMsgEnd(uint8_t msgType) noexcept = 0;
+	// Called for every message sent to the duelist of a team (0 or 1) or to
+	// the spectators (2), while the core message causing it is handled.
+	virtual void OnMsgSent(uint8_t audience, const YGOPro::STOCMsg& msg) noexcept = 0;
+protected:
+	inline ~ISimulationProbe() = default;
+};
+
+// Re-runs a recorded duel headlessly: the duel is created with the seed,
+// options and cards stored on the replay, and the recorded responses are fed
+// back to the core whenever it waits for one. Every core message goes through
+// the same Room::MsgPipeline rooms use while dueling (queries, knowledge
+// stripping and message wrapping), except that the resulting messages are
+// dropped instead of being sent to clients.
+class ReplaySimulator final
+{
+public:
+	enum class Outcome
+	{
+		OUTCOME_DUEL_ENDED,
+		OUTCOME_RESPONSES_EXHAUSTED,
+		OUTCOME_RETRY_RECEIVED,
+		OUTCOME_CORE_EXCEPTION,
+		OUTCOME_FAILED, // Anything else threw while simulating.
+	};
+
+	struct Result
+	{
+		Outcome outcome;
+		std::string error; // Set when outcome is OUTCOME_CORE_EXCEPTION or OUTCOME_FAILED.
+		std::size_t responsesUsed;
+		// Messages in the same form and order they would have been recorded
+		// by YGOPro::Replay while the duel was played.
+		YGOPro::Replay::MsgList messages;
+		// Highest amount of bytes used by the recorded replay and spectator
+		// cache, the same memory a room accounts for while dueling.
+		std::size_t memoryPeak;
+		// Bytes sent to clients, counting a single duelist per team and a
+		// single spectator.
+		std::size_t bytesSent;
+	};
+
+	// NOTE: Location refreshes that clients already have are skipped the same
+	// way rooms do, unless `sendEveryRefresh` is set.
+	ReplaySimulator(
+		Core::IWrapper& core,
+		Core::IDataSupplier& dataSupplier,
+		Core::IScriptSupplier& scriptSupplier,
+		bool sendEveryRefresh = false) noexcept;
+
+	Result Run(const YGOPro::ReplayReader& replay, ISimulationProbe* probe = nullptr) noexcept;
+
+	// Compares the messages regenerated by Run against the ones stored on the
+	// replay. Duels that did not end by themselves (surrender, timeout, etc)
+	// have a MSG_WIN appended by the server that the core never generates,
+	// so that message alone is allowed to be missing from the result.
+	static bool Matches(const YGOPro::ReplayReader& replay, const Result& result) noexcept;
+private:
+	Core::IWrapper& core;
+	Core::IDataSupplier& dataSupplier;
+	Core::IScriptSupplier& scriptSupplier;
+	const bool sendEveryRefresh;
+
+	void Simulate(const YGOPro::ReplayReader& replay, ISimulationProbe* probe, Result& result);
+};
+
+} // namespace Ignis::Multirole
+
+#endif // REPLAYSIMULATOR_HPP
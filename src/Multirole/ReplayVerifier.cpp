@@ -0,0 +1,166 @@
+#include "ReplayVerifier.hpp"
+
+#include <algorithm> // std::max
+#include <atomic>
+#include <chrono>
+#include <cstdlib> // Exit flags
+#include <fstream>
+#include <iterator> // std::istreambuf_iterator
+#include <mutex>
+#include <thread>
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <boost/json/value.hpp>
+#include <fmt/format.h>
+
+#include "I18N.hpp"
+#include "ReplaySimulator.hpp"
+#include "Core/IWrapper.hpp"
+#include "YGOPro/CardDatabase.hpp"
+#include "YGOPro/ReplayReader.hpp"
+
+namespace Ignis::Multirole
+{
+
+namespace
+{
+
+inline std::vector<uint8_t> ReadFile(const std::filesystem::path& path)
+{
+	std::ifstream file(path, std::ifstream::binary);
+	return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+} // namespace
+
+// public
+
+ReplayVerifier::ReplayVerifier(const boost::json::value& cfg) :
+	ioCtx(),
+	logHandler(ioCtx, cfg.at("logHandler").as_object()),
+	// NOTE: Cores are always loaded per call so each worker thread gets its
+	// own wrapper.
+	coreProvider(
+		logHandler,
+		cfg.at("coreProvider").at("fileRegex").as_string(),
+		cfg.at("coreProvider").at("tmpPath").as_string().data(),
+		Service::CoreProvider::CoreType::SHARED,
+		true,
+		{false, 0U, 0U, 0U, 0U}),
+	dataProvider(logHandler, cfg.at("dataProvider").at("fileRegex").as_string()),
+	scriptProvider(logHandler, cfg.at("scriptProvider").at("fileRegex").as_string())
+{
+	// Feed the providers with the files already present on the local copies
+	// of their observed repositories, the same way GitRepo would have done.
+	auto RegRepos = [&](IGitRepoObserver& obs, const boost::json::value& v)
+	{
+		for(const auto& observed : v.at("observedRepos").as_array())
+		{
+			for(const auto& opts : cfg.at("repos").as_array())
+			{
+				if(opts.at("name").as_string() != observed.as_string())
+					continue;
+				const std::filesystem::path path(opts.at("path").as_string().data());
+				PathVector pv;
+				for(const auto& entry : std::filesystem::recursive_directory_iterator(path))
+					if(entry.is_regular_file())
+						pv.emplace_back(entry.path().lexically_relative(path).generic_string());
+				obs.OnAdd(path, pv);
+			}
+		}
+	};
+	RegRepos(dataProvider, cfg.at("dataProvider"));
+	RegRepos(scriptProvider, cfg.at("scriptProvider"));
+	RegRepos(coreProvider, cfg.at("coreProvider"));
+}
+
+int ReplayVerifier::Run(const std::filesystem::path& dir) noexcept
+{
+	using Outcome = ReplaySimulator::Outcome;
+	std::vector<std::filesystem::path> files;
+	try
+	{
+		for(const auto& entry : std::filesystem::recursive_directory_iterator(dir))
+			if(entry.is_regular_file() && entry.path().extension() == ".yrpX")
+				files.emplace_back(entry.path());
+	}
+	catch(const std::exception& e)
+	{
+		fmt::print(I18N::MAIN_VERIFIER_INIT_FAILURE, e.what());
+		return EXIT_FAILURE;
+	}
+	const unsigned int threadCount = std::max(1U, std::thread::hardware_concurrency());
+	fmt::print(I18N::REPLAY_VERIFIER_REPLAYS_FOUND, files.size(), threadCount);
+	// NOTE: Replays are independent from each other, so workers just keep
+	// taking the next unverified replay until none are left, this keeps all
+	// of them busy regardless of how long each duel takes to simulate.
+	std::atomic<std::size_t> next{0U};
+	std::atomic<std::size_t> matched{0U};
+	std::atomic<std::size_t> diverged{0U};
+	std::atomic<std::size_t> failed{0U};
+	std::mutex mOutput;
+	auto Worker = [&]()
+	{
+		Service::CoreProvider::CorePtr core;
+		try
+		{
+			core = coreProvider.GetCore();
+		}
+		catch(const std::exception& e)
+		{
+			std::scoped_lock lock(mOutput);
+			fmt::print(I18N::MAIN_VERIFIER_INIT_FAILURE, e.what());
+			return;
+		}
+		const auto db = dataProvider.GetDatabase();
+		ReplaySimulator simulator(*core, *db, scriptProvider);
+		for(std::size_t i = next++; i < files.size(); i = next++)
+		{
+			const auto& file = files[i];
+			try
+			{
+				const YGOPro::ReplayReader replay(ReadFile(file));
+				const auto result = simulator.Run(replay);
+				if(ReplaySimulator::Matches(replay, result))
+				{
+					matched++;
+					continue;
+				}
+				std::scoped_lock lock(mOutput);
+				if(result.outcome == Outcome::OUTCOME_CORE_EXCEPTION)
+				{
+					fmt::print(I18N::REPLAY_VERIFIER_CORE_EXCEPT, file.string(), result.error);
+					failed++;
+				}
+				else if(result.outcome == Outcome::OUTCOME_FAILED)
+				{
+					fmt::print(I18N::REPLAY_VERIFIER_SIMULATION_FAILURE, file.string(), result.error);
+					failed++;
+				}
+				else
+				{
+					fmt::print(I18N::REPLAY_VERIFIER_DIVERGED, file.string());
+					diverged++;
+				}
+			}
+			catch(const std::exception& e)
+			{
+				std::scoped_lock lock(mOutput);
+				fmt::print(I18N::REPLAY_VERIFIER_PARSE_FAILURE, file.string(), e.what());
+				failed++;
+			}
+		}
+	};
+	const auto start = std::chrono::steady_clock::now();
+	boost::asio::thread_pool threads(threadCount);
+	for(unsigned int i = 0U; i < threadCount; i++)
+		boost::asio::post(threads, Worker);
+	threads.join();
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	fmt::print(I18N::REPLAY_VERIFIER_SUMMARY, files.size(), elapsed.count(),
+		matched.load(), diverged.load(), failed.load());
+	return (matched == files.size()) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+} // namespace Ignis::Multirole
@@ -0,0 +1,35 @@
+#ifndef REPLAYVERIFIER_HPP
+#define REPLAYVERIFIER_HPP
+#include <filesystem>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/json/fwd.hpp>
+
+#include "Service/CoreProvider.hpp"
+#include "Service/DataProvider.hpp"
+#include "Service/LogHandler.hpp"
+#include "Service/ScriptProvider.hpp"
+
+namespace Ignis::Multirole
+{
+
+// Re-simulates every replay of a directory using the core, scripts and
+// databases found in the local copies of the repositories set in the config,
+// checking that the regenerated messages match the ones that were recorded.
+// Meant to validate new core builds before they are deployed.
+class ReplayVerifier final
+{
+public:
+	ReplayVerifier(const boost::json::value& cfg);
+	int Run(const std::filesystem::path& dir) noexcept;
+private:
+	boost::asio::io_context ioCtx;
+	Service::LogHandler logHandler;
+	Service::CoreProvider coreProvider;
+	Service::DataProvider dataProvider;
+	Service::ScriptProvider scriptProvider;
+};
+
+} // namespace Ignis::Multirole
+
+#endif // REPLAYVERIFIER_HPP
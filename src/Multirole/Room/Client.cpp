@@ -1,11 +1,19 @@
 #include "Client.hpp"
 
+#include <algorithm> // std::clamp
+#include <array>
+
 #include <boost/asio/bind_executor.hpp>
+#include <boost/asio/post.hpp>
 #include <boost/asio/read.hpp>
 #include <boost/asio/write.hpp>
 
 #include "Instance.hpp"
+#include "../I18N.hpp"
 #include "../Lobby.hpp"
+#include "../Metrics.hpp"
+#include "../STOCMsgFactory.hpp"
+#include "../Tracing.hpp"
 #include "../YGOPro/StringUtils.hpp"
 
 namespace Ignis::Multirole::Room
@@ -16,26 +24,39 @@ Client::Client(
 	std::shared_ptr<Instance> r,
 	boost::asio::ip::tcp::socket socket,
 	std::string ip,
-	std::string name) noexcept
+	const IpKey& ipKey,
+	std::string name,
+	TimerWheel& timerWheel,
+	std::chrono::seconds waitingTimeout) noexcept
 	:
 	lobby(lobby),
 	room(std::move(r)),
 	strand(room->Strand()),
 	socket(std::move(socket)),
 	ip(std::move(ip)),
+	ipKey(ipKey),
 	name(std::move(name)),
 	connectionLost(false),
 	disconnecting(false),
 	position(POSITION_SPECTATOR),
 	ready(false),
-	originalDeck(std::make_unique<YGOPro::Deck>())
+	originalDeck(std::make_unique<YGOPro::Deck>()),
+	waitingTimeout(waitingTimeout),
+	inactivity(timerWheel, [this]()
+	{
+		// NOTE: Might be called while the client is being destroyed.
+		if(auto self = weak_from_this().lock(); self)
+			boost::asio::post(strand, [this, self = std::move(self)](){OnInactive();});
+	})
 {
-	lobby.IncrementConnectionCount(this->ip);
+	lobby.IncrementConnectionCount(ipKey);
+	Metrics::Add(Metrics::Counter::CLIENTS_CONNECTED);
 }
 
 Client::~Client() noexcept
 {
-	lobby.DecrementConnectionCount(ip);
+	lobby.DecrementConnectionCount(ipKey);
+	Metrics::Add(Metrics::Counter::CLIENTS_CONNECTED, -1);
 }
 
 void Client::Start() noexcept
@@ -46,6 +67,8 @@ void Client::Start() noexcept
 	{
 		room->Dispatch(Event::Join{*this});
 	});
+	if(waitingTimeout.count() > 0)
+		inactivity.Arm(waitingTimeout);
 	DoReadHeader();
 }
 
@@ -110,6 +133,7 @@ void Client::Send(const YGOPro::STOCMsg& msg) noexcept
 {
 	if(connectionLost || !socket.is_open())
 		return;
+	const Tracing::Span span("Client::Send", room->Id());
 	std::scoped_lock lock(mOutgoing);
 	const bool writeInProgress = !outgoing.empty();
 	outgoing.push(msg);
@@ -156,6 +180,8 @@ void Client::DoReadBody() noexcept
 		{
 			// Unlike Endpoint::RoomHosting, we dont want to finish connection
 			// if the message is not properly handled. Just ignore it.
+			if(waitingTimeout.count() > 0)
+				inactivity.Arm(waitingTimeout);
 			HandleMsg();
 			DoReadHeader();
 		}
@@ -172,11 +198,13 @@ void Client::DoWrite() noexcept
 	auto self = shared_from_this();
 	const auto& front = outgoing.front();
 	boost::asio::async_write(socket, boost::asio::buffer(front.Data(), front.Length()),
-	[this, self](boost::system::error_code ec, std::size_t /*unused*/)
+	[this, self](boost::system::error_code ec, std::size_t length)
 	{
 		if(ec)
 			return;
+		const Tracing::Span span("Client::DoWrite completion", room->Id());
 		std::scoped_lock lock(mOutgoing);
+		Metrics::MsgSent(static_cast<uint8_t>(outgoing.front().Type()), length);
 		outgoing.pop();
 		if(!outgoing.empty())
 			DoWrite();
@@ -191,8 +219,23 @@ void Client::Shutdown() noexcept
 	socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignore);
 }
 
+void Client::OnInactive() noexcept
+{
+	// NOTE: Once started, the room has its own timers to deal with clients
+	// that don't respond, and spectators are expected to be quiet, so the
+	// deadline is just pushed back in case the room goes back to waiting.
+	if(room->Started())
+	{
+		inactivity.Arm(waitingTimeout);
+		return;
+	}
+	Send(STOCMsgFactory::MakeChat(CHAT_MSG_TYPE_ERROR, I18N::CLIENT_ROOM_INACTIVE));
+	Disconnect();
+}
+
 void Client::HandleMsg() noexcept
 {
+	const Tracing::Span span("Client::HandleMsg", room->Id());
 	switch(incoming.GetType())
 	{
 	case YGOPro::CTOSMsg::MsgType::RESPONSE:
@@ -253,9 +296,16 @@ void Client::HandleMsg() noexcept
 	case YGOPro::CTOSMsg::MsgType::CHAT:
 	{
 		using namespace YGOPro;
-		auto str16 = BufferToUTF16(incoming.Body(), incoming.GetLength());
-		auto str = UTF16ToUTF8(str16);
-		room->Dispatch(Event::Chat{*this, str});
+		// NOTE: Transcoded on the stack, as messages are bounded anyways.
+		std::array<char16_t, CTOSMsg::MSG_MAX_LENGTH / sizeof(char16_t)> str16;
+		std::array<char, str16.size() * 3U> str;
+		const auto length = std::clamp<int>(incoming.GetLength(), 0, CTOSMsg::MSG_MAX_LENGTH);
+		const auto count16 = BufferToUTF16(incoming.Body(), static_cast<std::size_t>(length), str16.data());
+		const auto count = UTF16ToUTF8({str16.data(), count16}, str.data(), str.size());
+		if(count == TRANSCODE_ERROR)
+			room->Dispatch(Event::Chat{*this, INVALID_STRING});
+		else
+			room->Dispatch(Event::Chat{*this, {str.data(), count}});
 		break;
 	}
 	case YGOPro::CTOSMsg::MsgType::TO_DUELIST:
@@ -7,6 +7,7 @@
 #include <boost/asio/io_context_strand.hpp>
 #include <boost/asio/ip/tcp.hpp>
 
+#include "../TimerWheel.hpp"
 #include "../YGOPro/CTOSMsg.hpp"
 #include "../YGOPro/Deck.hpp"
 #include "../YGOPro/STOCMsg.hpp"
@@ -27,7 +28,19 @@ public:
 	using PosType = std::pair<uint8_t, uint8_t>;
 	static constexpr PosType POSITION_SPECTATOR = {UINT8_MAX, UINT8_MAX};
 
-	Client(Lobby& lobby, std::shared_ptr<Instance> r, boost::asio::ip::tcp::socket socket, std::string ip, std::string name) noexcept;
+	using IpKey = boost::asio::ip::address_v6::bytes_type;
+
+	// NOTE: A client that sends nothing for `waitingTimeout` while the room
+	// has not started is disconnected, 0 disables this.
+	Client(
+		Lobby& lobby,
+		std::shared_ptr<Instance> r,
+		boost::asio::ip::tcp::socket socket,
+		std::string ip,
+		const IpKey& ipKey,
+		std::string name,
+		TimerWheel& timerWheel,
+		std::chrono::seconds waitingTimeout) noexcept;
 	~Client() noexcept;
 	void Start() noexcept;
 
@@ -63,6 +76,7 @@ private:
 	boost::asio::io_context::strand& strand;
 	boost::asio::ip::tcp::socket socket;
 	const std::string ip;
+	const IpKey ipKey; // Used to account connections on the lobby.
 	const std::string name;
 	bool connectionLost;
 	bool disconnecting;
@@ -70,6 +84,8 @@ private:
 	bool ready;
 	std::unique_ptr<YGOPro::Deck> originalDeck;
 	std::unique_ptr<YGOPro::Deck> currentDeck;
+	const std::chrono::seconds waitingTimeout;
+	TimerWheel::Handle inactivity;
 
 	// Message data
 	YGOPro::CTOSMsg incoming;
@@ -87,6 +103,9 @@ private:
 
 	// Handles received CTOS message
 	void HandleMsg() noexcept;
+
+	// Called on the strand once `waitingTimeout` passes without messages.
+	void OnInactive() noexcept;
 };
 
 } // namespace Room
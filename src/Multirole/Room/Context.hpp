@@ -8,6 +8,7 @@
 #include "Event.hpp"
 #include "ScriptLogger.hpp"
 #include "State.hpp"
+#include "../AccountingResource.hpp"
 #include "../Service.hpp"
 #include "../STOCMsgFactory.hpp"
 #include "../RNG/Xoshiro256.hpp"
@@ -18,12 +19,14 @@ namespace YGOPro
 class Banlist;
 using BanlistPtr = std::shared_ptr<Banlist>;
 class CardDatabase;
+class DeckValidator;
 
 } // namespace YGOPro
 
 namespace Ignis::Multirole
 {
 
+struct CardDataSnapshot;
 class RoomLogger;
 
 namespace Room
@@ -45,6 +48,7 @@ public:
 		YGOPro::HostInfo hostInfo;
 		bool isPrivate;
 		const std::string& notes;
+		std::size_t memoryBudget; // 0 == unlimited.
 	};
 
 	struct DuelFinishReason
@@ -57,6 +61,7 @@ public:
 			REASON_WRONG_RESPONSE,
 			REASON_CONNECTION_LOST,
 			REASON_CORE_CRASHED,
+			REASON_MEMORY_EXCEEDED,
 		} reason;
 		uint8_t winner; // 2 == DRAW
 	};
@@ -64,6 +69,7 @@ public:
 	Context(CreateInfo&& info) noexcept;
 	~Context() noexcept;
 
+	uint32_t Id() const noexcept;
 	const YGOPro::HostInfo& HostInfo() const noexcept;
 	bool IsStarted() const noexcept;
 	bool IsPrivate() const noexcept;
@@ -133,6 +139,8 @@ public:
 		return std::nullopt;
 	}
 private:
+	Context(CreateInfo&& info, CardDataSnapshot&& data) noexcept;
+
 	// Creation options and resources.
 	Service& svc;
 	TimerAggregator& tagg;
@@ -140,13 +148,20 @@ private:
 	const YGOPro::BanlistPtr banlist;
 	const YGOPro::HostInfo hostInfo;
 	const std::shared_ptr<YGOPro::CardDatabase> cdb;
+	const std::shared_ptr<const YGOPro::DeckValidator> validator;
 	const int32_t neededWins;
 	const YGOPro::STOCMsg joinMsg;
 	const bool isPrivate;
+	const std::size_t memoryBudget;
 	bool isStarted;
 	std::unique_ptr<RoomLogger> rl;
 	ScriptLogger scriptLogger;
 	RNG::Xoshiro256StarStar rng;
+	// Accounts the memory used by the duel state (replay and spectator cache).
+	AccountingResource memory;
+	// Arena for the short-lived messages and queries produced while a duel is
+	// processed, released after every call to Process.
+	std::pmr::monotonic_buffer_resource scratch;
 
 	// Client management variables.
 	std::map<Client::PosType, Client*> duelists;
@@ -199,9 +214,10 @@ private:
 	Client& GetCurrentTeamClient(State::Dueling& s, uint8_t team) noexcept;
 	std::optional<DuelFinishReason> Process(State::Dueling& s) noexcept;
 	StateVariant Finish(State::Dueling& s, const DuelFinishReason& dfr) noexcept;
-	static const YGOPro::STOCMsg& SaveToSpectatorCache(
+	const YGOPro::STOCMsg& SaveToSpectatorCache(
 		State::Dueling& s,
 		YGOPro::STOCMsg&& msg) noexcept;
+	void DropSpectatorCache(State::Dueling& s) noexcept;
 	// State/RockPaperScissor.cpp
 	void SendRPS() noexcept;
 	// State/Waiting.cpp
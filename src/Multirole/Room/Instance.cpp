@@ -1,12 +1,14 @@
 #include "Instance.hpp"
 
+#include "../Tracing.hpp"
+
 namespace Ignis::Multirole::Room
 {
 
 Instance::Instance(CreateInfo& info) noexcept
 	:
 	strand(info.ioCtx),
-	tagg(*this),
+	tagg(*this, info.timerWheel),
 	notes(std::move(info.notes)),
 	pass(std::move(info.pass)),
 	ctx({
@@ -17,10 +19,17 @@ Instance::Instance(CreateInfo& info) noexcept
 		std::move(info.banlist),
 		info.hostInfo,
 		!pass.empty(),
-		notes}),
-	state(State::Waiting{nullptr})
+		notes,
+		info.memoryBudget}),
+	state(State::Waiting{nullptr}),
+	stateIndex(state.index())
 {}
 
+uint32_t Instance::Id() const noexcept
+{
+	return ctx.Id();
+}
+
 bool Instance::IsPrivate() const noexcept
 {
 	return ctx.IsPrivate();
@@ -31,6 +40,11 @@ bool Instance::Started() const noexcept
 	return ctx.IsStarted();
 }
 
+std::size_t Instance::StateIndex() const noexcept
+{
+	return stateIndex.load(std::memory_order_relaxed);
+}
+
 const std::string& Instance::Notes() const noexcept
 {
 	return notes;
@@ -83,12 +97,19 @@ boost::asio::io_context::strand& Instance::Strand() noexcept
 
 void Instance::Dispatch(const EventVariant& e) noexcept
 {
-	std::scoped_lock lock(mState);
+	const uint32_t id = Id();
+	std::unique_lock lock(mState, std::defer_lock);
+	{
+		const Tracing::Span span("Instance::Dispatch wait", id);
+		lock.lock();
+	}
+	const Tracing::Span span("Instance::Dispatch", id);
 	for(StateOpt newState = std::visit(ctx, state, e); newState;)
 	{
 		state = std::move(*newState);
 		newState = std::visit(ctx, state);
 	}
+	stateIndex.store(state.index(), std::memory_order_relaxed);
 }
 
 } // namespace Ignis::Multirole::Room
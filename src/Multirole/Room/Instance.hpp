@@ -1,5 +1,6 @@
 #ifndef ROOM_INSTANCE_HPP
 #define ROOM_INSTANCE_HPP
+#include <atomic>
 #include <set>
 #include <string>
 #include <string_view>
@@ -21,6 +22,7 @@ public:
 	struct CreateInfo
 	{
 		boost::asio::io_context& ioCtx;
+		TimerWheel& timerWheel;
 		std::string notes;
 		std::string pass;
 		Service& svc;
@@ -28,17 +30,24 @@ public:
 		RNG::Xoshiro256StarStar::StateType seed;
 		YGOPro::BanlistPtr banlist;
 		YGOPro::HostInfo hostInfo;
+		std::size_t memoryBudget;
 	};
 
 	// Ctor and registering.
 	Instance(CreateInfo& info) noexcept;
 
+	// Get the ID of the room, as shown in the lobby.
+	uint32_t Id() const noexcept;
+
 	// Get whether or not the room is private (has password set).
 	bool IsPrivate() const noexcept;
 
 	// Check if the room state is not Waiting.
 	bool Started() const noexcept;
 
+	// Get the index of the current state within StateVariant.
+	std::size_t StateIndex() const noexcept;
+
 	// Get the notes of the room.
 	const std::string& Notes() const noexcept;
 
@@ -73,6 +82,9 @@ private:
 
 	StateVariant state;
 	mutable std::shared_mutex mState;
+	// NOTE: Mirrors state.index() so it can be queried without waiting for
+	// an ongoing dispatch to finish.
+	std::atomic<std::size_t> stateIndex;
 
 	std::set<std::string> kicked;
 	mutable std::mutex mKicked;
@@ -0,0 +1,235 @@
+#include "MsgPipeline.hpp"
+
+#include <array>
+
+#include "../Tracing.hpp"
+#include "../YGOPro/Constants.hpp"
+#include "../YGOPro/QueryCache.hpp"
+#include "../YGOPro/Replay.hpp"
+
+namespace Ignis::Multirole::Room
+{
+
+namespace
+{
+
+inline YGOPro::STOCMsg MakeGameMsg(const YGOPro::CoreUtils::Msg& msg)
+{
+	return YGOPro::STOCMsg{YGOPro::STOCMsg::MsgType::GAME_MSG, msg};
+}
+
+} // namespace
+
+MsgPipeline::MsgPipeline(
+	Core::IWrapper& core,
+	Core::IWrapper::Duel duel,
+	YGOPro::Replay& replay,
+	YGOPro::QueryCache* queryCache,
+	IMsgOutput& output,
+	std::pmr::memory_resource& scratch,
+	uint32_t roomId) noexcept
+	:
+	core(core),
+	duel(duel),
+	replay(replay),
+	queryCache(queryCache),
+	output(output),
+	scratch(scratch),
+	roomId(roomId),
+	batchQueries(&scratch),
+	refreshed(&scratch)
+{}
+
+void MsgPipeline::NewBatch() noexcept
+{
+	batchQueries.clear();
+	refreshed.clear();
+}
+
+void MsgPipeline::Handle(const YGOPro::CoreUtils::Msg& msg)
+{
+	using namespace YGOPro::CoreUtils;
+	ProcessQueryRequests(GetPreDistQueryRequests(msg, &scratch));
+	Distribute(msg);
+	// NOTE: The message itself might have changed what clients have, the
+	// same way the query cache forgets about it.
+	if(!DoesMessageKeepCards(GetMessageType(msg)))
+	{
+		if(const auto card = GetMessageChangedCard(msg); card && (card->loc & LOCATION_OVERLAY) == 0U)
+			ForgetRefreshed(card->con, card->loc);
+		else
+			refreshed.clear();
+	}
+	ProcessQueryRequests(GetPostDistQueryRequests(msg, &scratch));
+}
+
+// private
+
+// NOTE: The duel doesn't change while the messages from a single call to
+// Process are handled, so a query repeated within them (e.g: every chain
+// message refreshing the field) gives the same result, which is kept so the
+// core is only asked and the result rewritten once.
+const MsgPipeline::BatchQuery& MsgPipeline::Query(const Core::IWrapper::QueryInfo& qInfo, bool isLocation)
+{
+	using namespace YGOPro::CoreUtils;
+	const BatchQueryKey key{isLocation, qInfo.con, qInfo.loc, qInfo.seq, qInfo.flags};
+	if(auto it = batchQueries.find(key); it != batchQueries.end())
+		return it->second;
+	auto full = [&]()
+	{
+		const Tracing::Span span("IWrapper::Query", roomId);
+		return isLocation ? core.QueryLocation(duel, qInfo) : core.Query(duel, qInfo);
+	}();
+	auto rewritten = [&]() -> QueryBufferPair
+	{
+		if(!isLocation)
+			return RewriteSingleQueryBuffer(full, &scratch);
+		// NOTE: Decks are not sent and the extra deck is only sent to
+		// its owner, so they are never rewritten.
+		if(qInfo.loc == LOCATION_DECK || qInfo.loc == LOCATION_EXTRA)
+			return {QueryBuffer(&scratch), QueryBuffer(&scratch)};
+		return RewriteLocationQueryBuffer(full, &scratch);
+	}();
+	return batchQueries.emplace(key, BatchQuery{std::move(full), std::move(rewritten)}).first->second;
+}
+
+void MsgPipeline::ProcessQueryRequests(const YGOPro::CoreUtils::QueryRequestVector& qreqs)
+{
+	using namespace YGOPro::CoreUtils;
+	const Tracing::Span span("ProcessQueryRequests", roomId);
+	for(const auto& reqVar : qreqs)
+	{
+		if(std::holds_alternative<QuerySingleRequest>(reqVar))
+		{
+			const auto& req = std::get<QuerySingleRequest>(reqVar);
+			auto MakeMsg = [&](const QueryBuffer& qb) -> YGOPro::STOCMsg
+			{
+				return MakeGameMsg(MakeUpdateCardMsg(req.con, req.loc, req.seq, qb, &scratch));
+			};
+			const Core::IWrapper::QueryInfo qInfo =
+			{
+				req.flags,
+				req.con,
+				req.loc,
+				req.seq,
+				0U
+			};
+			const auto& [fullBuffer, rewritten] = Query(qInfo, false);
+			const auto& [ownerBuffer, strippedBuffer] = rewritten;
+			replay.RecordMsg(MakeUpdateCardMsg(req.con, req.loc, req.seq, fullBuffer, &scratch));
+			if(queryCache != nullptr)
+				queryCache->Invalidate(req.con, req.loc);
+			ForgetRefreshed(req.con, req.loc);
+			auto strippedMsg = MakeMsg(strippedBuffer);
+			output.SendToTeam(req.con, MakeMsg(ownerBuffer));
+			output.SendToTeam(1U - req.con, strippedMsg);
+			output.SendToSpectators(std::move(strippedMsg));
+		}
+		else /*if(std::holds_alternative<QueryLocationRequest>(reqVar))*/
+		{
+			const auto& req = std::get<QueryLocationRequest>(reqVar);
+			auto MakeMsg = [&](const auto& qb) -> YGOPro::STOCMsg
+			{
+				return MakeGameMsg(MakeUpdateDataMsg(req.con, req.loc, qb, &scratch));
+			};
+			const Core::IWrapper::QueryInfo qInfo =
+			{
+				req.flags,
+				req.con,
+				req.loc,
+				0U,
+				0U
+			};
+			const auto& [fullBuffer, rewritten] = Query(qInfo, true);
+			replay.RecordMsg(MakeUpdateDataMsg(req.con, req.loc, fullBuffer, &scratch));
+			if(req.loc == LOCATION_DECK)
+				continue;
+			// NOTE: Only sending is skipped, so replays keep every refresh.
+			if(queryCache != nullptr && !MarkRefreshed({req.con, req.loc, req.flags}))
+				continue;
+			if(req.loc == LOCATION_EXTRA)
+			{
+				output.SendToTeam(req.con, MakeMsg(fullBuffer));
+				continue;
+			}
+			const auto& [ownerBuffer, strippedBuffer] = rewritten;
+			using Audience = YGOPro::QueryCache::Audience;
+			auto IsRedundant = [&](Audience a, const auto& qb)
+			{
+				return queryCache != nullptr && queryCache->IsRedundant(a, req.con, req.loc, qb);
+			};
+			if(!IsRedundant(Audience::AUDIENCE_OWNER, ownerBuffer))
+				output.SendToTeam(req.con, MakeMsg(ownerBuffer));
+			if(IsRedundant(Audience::AUDIENCE_PUBLIC, strippedBuffer))
+				continue;
+			auto strippedMsg = MakeMsg(strippedBuffer);
+			output.SendToTeam(1U - req.con, strippedMsg);
+			output.SendToSpectators(std::move(strippedMsg));
+		}
+	}
+}
+
+void MsgPipeline::Distribute(const YGOPro::CoreUtils::Msg& msg)
+{
+	using namespace YGOPro::CoreUtils;
+	replay.RecordMsg(msg);
+	if(queryCache != nullptr)
+		queryCache->OnMsg(msg);
+	switch(GetMessageDistributionType(msg))
+	{
+	case MsgDistType::MSG_DIST_TYPE_SPECIFIC_TEAM_DUELIST_STRIPPED:
+	{
+		uint8_t team = GetMessageReceivingTeam(msg);
+		output.SendToDuelist(team, MakeGameMsg(StripMessageForTeam(team, msg, &scratch)));
+		break;
+	}
+	case MsgDistType::MSG_DIST_TYPE_SPECIFIC_TEAM_DUELIST:
+	{
+		output.SendToDuelist(GetMessageReceivingTeam(msg), MakeGameMsg(msg));
+		break;
+	}
+	case MsgDistType::MSG_DIST_TYPE_SPECIFIC_TEAM:
+	{
+		output.SendToTeam(GetMessageReceivingTeam(msg), MakeGameMsg(msg));
+		break;
+	}
+	case MsgDistType::MSG_DIST_TYPE_EVERYONE_EXCEPT_TEAM_DUELIST:
+	{
+		output.SendToAllExceptDuelist(GetMessageReceivingTeam(msg), MakeGameMsg(msg));
+		break;
+	}
+	case MsgDistType::MSG_DIST_TYPE_EVERYONE_STRIPPED:
+	{
+		const std::array<Msg, 2U> sMsgs =
+		{
+			StripMessageForTeam(0U, msg, &scratch),
+			StripMessageForTeam(1U, msg, &scratch)
+		};
+		output.SendToTeam(0U, MakeGameMsg(sMsgs[0U]));
+		output.SendToTeam(1U, MakeGameMsg(sMsgs[1U]));
+		output.SendToSpectators(MakeGameMsg(StripMessageForTeam(1U, sMsgs[0U], &scratch)));
+		break;
+	}
+	case MsgDistType::MSG_DIST_TYPE_EVERYONE:
+	{
+		output.SendToAll(MakeGameMsg(msg));
+		break;
+	}
+	}
+}
+
+// Tells if the location was not sent yet since clients last changed it,
+// remembering it as sent.
+bool MsgPipeline::MarkRefreshed(const RefreshKey& key) noexcept
+{
+	return refreshed.insert(key).second;
+}
+
+void MsgPipeline::ForgetRefreshed(uint8_t con, uint32_t loc) noexcept
+{
+	auto it = refreshed.lower_bound({con, loc, 0U});
+	while(it != refreshed.end() && std::get<0U>(*it) == con && std::get<1U>(*it) == loc)
+		it = refreshed.erase(it);
+}
+
+} // namespace Ignis::Multirole::Room
@@ -0,0 +1,97 @@
+#ifndef ROOM_MSGPIPELINE_HPP
+#define ROOM_MSGPIPELINE_HPP
+#include <map>
+#include <memory_resource>
+#include <set>
+#include <tuple>
+
+#include "../Core/IWrapper.hpp"
+#include "../YGOPro/CoreUtils.hpp"
+#include "../YGOPro/STOCMsg.hpp"
+
+namespace YGOPro
+{
+
+class QueryCache;
+class Replay;
+
+} // namespace YGOPro
+
+namespace Ignis::Multirole::Room
+{
+
+// Receives the messages produced by MsgPipeline for each audience. Teams are
+// the ones used by the core, not the ones seen by clients.
+class IMsgOutput
+{
+public:
+	// Only the duelist currently playing for the team.
+	virtual void SendToDuelist(uint8_t team, const YGOPro::STOCMsg& msg) noexcept = 0;
+	virtual void SendToTeam(uint8_t team, const YGOPro::STOCMsg& msg) noexcept = 0;
+	// NOTE: Messages passed to the functions below are seen by spectators,
+	// so they are also kept for the spectators that join later on.
+	virtual void SendToSpectators(YGOPro::STOCMsg&& msg) noexcept = 0;
+	virtual void SendToAllExceptDuelist(uint8_t team, YGOPro::STOCMsg&& msg) noexcept = 0;
+	virtual void SendToAll(YGOPro::STOCMsg&& msg) noexcept = 0;
+protected:
+	inline ~IMsgOutput() = default;
+};
+
+// Turns each message generated by the core into the messages each audience
+// receives: the queries the message requests are made before and after it,
+// everything is stripped of what each audience is not supposed to know, and
+// recorded on the replay. Used by rooms while dueling as well as by
+// ReplaySimulator, so replays are verified against what rooms actually do.
+class MsgPipeline final
+{
+public:
+	// NOTE: Everything is allocated from `scratch`, so NewBatch must be
+	// called before it is released. Without a query cache every location
+	// refresh is sent, even if clients already have what it holds.
+	MsgPipeline(
+		Core::IWrapper& core,
+		Core::IWrapper::Duel duel,
+		YGOPro::Replay& replay,
+		YGOPro::QueryCache* queryCache,
+		IMsgOutput& output,
+		std::pmr::memory_resource& scratch,
+		uint32_t roomId = 0U) noexcept;
+
+	// To be called after each call to Process, as the query results kept
+	// from the previous call might not be valid anymore.
+	void NewBatch() noexcept;
+
+	// Throws Core::Exception if the core fails while being queried.
+	void Handle(const YGOPro::CoreUtils::Msg& msg);
+private:
+	struct BatchQuery
+	{
+		YGOPro::CoreUtils::Buffer full;
+		YGOPro::CoreUtils::QueryBufferPair rewritten;
+	};
+	using BatchQueryKey = std::tuple<bool, uint8_t, uint32_t, uint32_t, uint32_t>;
+	using RefreshKey = std::tuple<uint8_t, uint32_t, uint32_t>;
+
+	Core::IWrapper& core;
+	const Core::IWrapper::Duel duel;
+	YGOPro::Replay& replay;
+	YGOPro::QueryCache* const queryCache;
+	IMsgOutput& output;
+	std::pmr::memory_resource& scratch;
+	const uint32_t roomId;
+	std::pmr::map<BatchQueryKey, BatchQuery> batchQueries;
+	// Locations sent to clients since they last changed any of their cards,
+	// within the current batch.
+	std::pmr::set<RefreshKey> refreshed;
+
+	bool MarkRefreshed(const RefreshKey& key) noexcept;
+	void ForgetRefreshed(uint8_t con, uint32_t loc) noexcept;
+
+	const BatchQuery& Query(const Core::IWrapper::QueryInfo& qInfo, bool isLocation);
+	void ProcessQueryRequests(const YGOPro::CoreUtils::QueryRequestVector& qreqs);
+	void Distribute(const YGOPro::CoreUtils::Msg& msg);
+};
+
+} // namespace Ignis::Multirole::Room
+
+#endif // ROOM_MSGPIPELINE_HPP
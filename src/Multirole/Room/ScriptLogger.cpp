@@ -46,6 +46,9 @@ void ScriptLogger::SetTurnCounter(uint32_t count)
 
 void ScriptLogger::Log(LogType type, std::string_view str)
 {
+	// NOTE: Messages are not even put together if they are going nowhere.
+	if(!IsLevelEnabled(Level::ERROR) || !lh.IsEnabled(ec))
+		return;
 	if(type == LogType::LOG_TYPE_ERROR)
 	{
 		currMsg += str;
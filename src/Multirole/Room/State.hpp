@@ -3,10 +3,12 @@
 #include <array>
 #include <chrono>
 #include <deque>
+#include <memory_resource>
 #include <optional>
 #include <set>
 #include <variant>
 
+#include "../YGOPro/QueryCache.hpp"
 #include "../YGOPro/Replay.hpp"
 #include "../YGOPro/STOCMsg.hpp"
 
@@ -45,11 +47,13 @@ struct Dueling
 	std::unique_ptr<YGOPro::Replay> replay;
 	std::array<uint8_t, 2U> currentPos;
 	std::array<uint8_t, 2U> retryCount;
-	std::vector<uint8_t> lastHint;
-	std::vector<uint8_t> lastRequest;
+	std::pmr::vector<uint8_t> lastHint;
+	std::pmr::vector<uint8_t> lastRequest;
 	Client* replier;
 	std::optional<uint32_t> matchKillReason;
-	std::deque<YGOPro::STOCMsg> spectatorCache;
+	std::pmr::deque<YGOPro::STOCMsg> spectatorCache;
+	bool spectatorCacheDropped;
+	YGOPro::QueryCache queryCache;
 	std::array<std::chrono::milliseconds, 2U> timeRemaining;
 };
 
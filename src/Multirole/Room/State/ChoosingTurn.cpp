@@ -1,6 +1,7 @@
 #include "../Context.hpp"
 
 #include "../../Service/CoreProvider.hpp"
+#include "../../YGOPro/CardDatabase.hpp"
 #include "../../YGOPro/Constants.hpp"
 
 namespace Ignis::Multirole::Room
@@ -35,18 +36,20 @@ StateOpt Context::operator()(State::ChoosingTurn& s, const Event::ChooseTurn& e)
 	};
 	return State::Dueling
 	{
-		svc.coreProvider.GetCore(),
+		svc.coreProvider.GetCore(cdb),
 		nullptr,
 		0U,
 		0U,
 		nullptr,
 		DecidePlayerOrder(),
 		{uint8_t(0U), uint8_t(0U)},
-		{},
-		{},
+		std::pmr::vector<uint8_t>(&memory),
+		std::pmr::vector<uint8_t>(&memory),
 		nullptr,
 		std::nullopt,
-		{},
+		std::pmr::deque<YGOPro::STOCMsg>(&memory),
+		false,
+		YGOPro::QueryCache(&memory),
 		{}
 	};
 }
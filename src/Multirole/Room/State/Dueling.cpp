@@ -1,11 +1,14 @@
 #include "../Context.hpp"
 
+#include "../MsgPipeline.hpp"
 #include "../TimerAggregator.hpp"
 #include "../../I18N.hpp"
+#include "../../Metrics.hpp"
+#include "../../Tracing.hpp"
 #include "../../Core/IWrapper.hpp"
 #include "../../Service/LogHandler.hpp"
-#define LOG_INFO(...) svc.logHandler.Log(ErrorCategory::CORE, s.replayId, s.turnCounter, __VA_ARGS__)
-#define LOG_ERROR(...) svc.logHandler.Log(ErrorCategory::CORE, s.replayId, s.turnCounter, __VA_ARGS__)
+#define LOG_INFO(...) MULTIROLE_LOG_EC(svc.logHandler, ErrorCategory::CORE, s.replayId, s.turnCounter, __VA_ARGS__)
+#define LOG_ERROR(...) MULTIROLE_LOG_EC(svc.logHandler, ErrorCategory::CORE, s.replayId, s.turnCounter, __VA_ARGS__)
 #include "../../Service/ReplayManager.hpp"
 #include "../../Service/ScriptProvider.hpp"
 #include "../../YGOPro/CardDatabase.hpp"
@@ -69,6 +72,7 @@ StateOpt Context::operator()(State::Dueling& s) noexcept
 	X(EXTRA_RULE_ACTION_DUEL,        151999999U); // NOLINT
 #undef X
 	// Construct replay.
+	memory.ResetPeak();
 	scriptLogger.SetReplayID(s.replayId = svc.replayManager.NewId());
 	auto CurrentTime = []()
 	{
@@ -80,7 +84,8 @@ StateOpt Context::operator()(State::Dueling& s) noexcept
 		static_cast<uint32_t>(CurrentTime()),
 		seed,
 		hostInfo,
-		extraCards
+		extraCards,
+		&memory
 	);
 	// Create core duel with room's options.
 	const OCG_Player popt =
@@ -249,6 +254,13 @@ StateOpt Context::operator()(State::Dueling& s, const Event::ConnectionLost& e)
 
 StateOpt Context::operator()(State::Dueling& s, const Event::Join& e) noexcept
 {
+	// NOTE: Without the cache there is no way to catch up new spectators.
+	if(s.spectatorCacheDropped)
+	{
+		e.client.Send(MakeChat(CHAT_MSG_TYPE_ERROR, I18N::CLIENT_ROOM_CANNOT_SPECTATE));
+		e.client.Disconnect();
+		return std::nullopt;
+	}
 	SetupAsSpectator(e.client);
 	e.client.Send(MakeDuelStart());
 	e.client.Send(MakeCatchUp(true));
@@ -316,6 +328,8 @@ Client& Context::GetCurrentTeamClient(State::Dueling& s, uint8_t team) noexcept
 std::optional<Context::DuelFinishReason> Context::Process(State::Dueling& s) noexcept
 {
 	using namespace YGOPro::CoreUtils;
+	const Metrics::ScopedTimer timer(Metrics::Histogram::CONTEXT_PROCESS);
+	const Tracing::Span span("Context::Process", id);
 	auto PreAnalyzeMsg = [&](const Msg& msg) -> bool
 	{
 		uint8_t msgType = GetMessageType(msg);
@@ -361,126 +375,45 @@ std::optional<Context::DuelFinishReason> Context::Process(State::Dueling& s) noe
 		}
 		return true;
 	};
-	auto ProcessQueryRequests = [&](const std::vector<QueryRequest>& qreqs)
-	{
-		for(const auto& reqVar : qreqs)
-		{
-			if(std::holds_alternative<QuerySingleRequest>(reqVar))
-			{
-				const auto& req = std::get<QuerySingleRequest>(reqVar);
-				auto MakeMsg = [&](const QueryBuffer& qb) -> YGOPro::STOCMsg
-				{
-					return MakeGameMsg(MakeUpdateCardMsg(req.con, req.loc, req.seq, qb));
-				};
-				const Core::IWrapper::QueryInfo qInfo =
-				{
-					req.flags,
-					req.con,
-					req.loc,
-					req.seq,
-					0U
-				};
-				const auto fullBuffer = s.core->Query(s.duelPtr, qInfo);
-				const auto query = DeserializeSingleQueryBuffer(fullBuffer);
-				const auto ownerBuffer = SerializeSingleQuery(query, false);
-				const auto strippedBuffer = SerializeSingleQuery(query, true);
-				s.replay->RecordMsg(MakeUpdateCardMsg(req.con, req.loc, req.seq, fullBuffer));
-				auto strippedMsg = MakeMsg(strippedBuffer);
-				uint8_t team = GetSwappedTeam(req.con);
-				SendToTeam(team, MakeMsg(ownerBuffer));
-				SendToTeam(1U - team, strippedMsg);
-				SendToSpectators(SaveToSpectatorCache(s, std::move(strippedMsg)));
-			}
-			else /*if(std::holds_alternative<QueryLocationRequest>(reqVar))*/
-			{
-				const auto& req = std::get<QueryLocationRequest>(reqVar);
-				auto MakeMsg = [&](const QueryBuffer& qb) -> YGOPro::STOCMsg
-				{
-					return MakeGameMsg(MakeUpdateDataMsg(req.con, req.loc, qb));
-				};
-				const Core::IWrapper::QueryInfo qInfo =
-				{
-					req.flags,
-					req.con,
-					req.loc,
-					0U,
-					0U
-				};
-				uint8_t team = GetSwappedTeam(req.con);
-				const auto fullBuffer = s.core->QueryLocation(s.duelPtr, qInfo);
-				s.replay->RecordMsg(MakeUpdateDataMsg(req.con, req.loc, fullBuffer));
-				if(req.loc == LOCATION_DECK)
-					continue;
-				if(req.loc == LOCATION_EXTRA)
-				{
-					SendToTeam(team, MakeMsg(fullBuffer));
-					continue;
-				}
-				const auto query = DeserializeLocationQueryBuffer(fullBuffer);
-				const auto ownerBuffer = SerializeLocationQuery(query, false);
-				const auto strippedBuffer = SerializeLocationQuery(query, true);
-				auto strippedMsg = MakeMsg(strippedBuffer);
-				SendToTeam(team, MakeMsg(ownerBuffer));
-				SendToTeam(1U - team, strippedMsg);
-				SendToSpectators(SaveToSpectatorCache(s, std::move(strippedMsg)));
-			}
-		}
-	};
-	auto DistributeMsg = [&](const Msg& msg)
+	// Sends the messages produced by the pipeline to the clients of the room,
+	// swapping the teams used by the core for the ones clients see.
+	class Output final : public IMsgOutput
 	{
-		s.replay->RecordMsg(msg);
-		switch(GetMessageDistributionType(msg))
-		{
-		case MsgDistType::MSG_DIST_TYPE_SPECIFIC_TEAM_DUELIST_STRIPPED:
+	public:
+		Output(Context& ctx, State::Dueling& s) noexcept : ctx(ctx), s(s)
+		{}
+
+		void SendToDuelist(uint8_t team, const YGOPro::STOCMsg& msg) noexcept override
 		{
-			uint8_t team = GetMessageReceivingTeam(msg);
-			const auto sMsg = StripMessageForTeam(team, msg);
-			auto& client = GetCurrentTeamClient(s, GetSwappedTeam(team));
-			client.Send(MakeGameMsg(sMsg));
-			break;
+			ctx.GetCurrentTeamClient(s, ctx.GetSwappedTeam(team)).Send(msg);
 		}
-		case MsgDistType::MSG_DIST_TYPE_SPECIFIC_TEAM_DUELIST:
+
+		void SendToTeam(uint8_t team, const YGOPro::STOCMsg& msg) noexcept override
 		{
-			uint8_t team = GetMessageReceivingTeam(msg);
-			auto& client = GetCurrentTeamClient(s, GetSwappedTeam(team));
-			client.Send(MakeGameMsg(msg));
-			break;
+			ctx.SendToTeam(ctx.GetSwappedTeam(team), msg);
 		}
-		case MsgDistType::MSG_DIST_TYPE_SPECIFIC_TEAM:
+
+		void SendToSpectators(YGOPro::STOCMsg&& msg) noexcept override
 		{
-			uint8_t team = GetMessageReceivingTeam(msg);
-			SendToTeam(GetSwappedTeam(team), MakeGameMsg(msg));
-			break;
+			ctx.SendToSpectators(ctx.SaveToSpectatorCache(s, std::move(msg)));
 		}
-		case MsgDistType::MSG_DIST_TYPE_EVERYONE_EXCEPT_TEAM_DUELIST:
+
+		void SendToAllExceptDuelist(uint8_t team, YGOPro::STOCMsg&& msg) noexcept override
 		{
-			uint8_t team = GetMessageReceivingTeam(msg);
-			SendToAllExcept(
-				GetCurrentTeamClient(s, GetSwappedTeam(team)),
-				SaveToSpectatorCache(s, MakeGameMsg(msg)));
-			break;
+			ctx.SendToAllExcept(
+				ctx.GetCurrentTeamClient(s, ctx.GetSwappedTeam(team)),
+				ctx.SaveToSpectatorCache(s, std::move(msg)));
 		}
-		case MsgDistType::MSG_DIST_TYPE_EVERYONE_STRIPPED:
-		{
-			const std::array<Msg, 2U> sMsgs =
-			{
-				StripMessageForTeam(0U, msg),
-				StripMessageForTeam(1U, msg)
-			};
-			SendToTeam(GetSwappedTeam(0U), MakeGameMsg(sMsgs[0U]));
-			SendToTeam(GetSwappedTeam(1U), MakeGameMsg(sMsgs[1U]));
-			SendToSpectators(
-				SaveToSpectatorCache(s,
-					MakeGameMsg(StripMessageForTeam(1U, sMsgs[0U]))));
-			break;
-		}
-		case MsgDistType::MSG_DIST_TYPE_EVERYONE:
+
+		void SendToAll(YGOPro::STOCMsg&& msg) noexcept override
 		{
-			SendToAll(SaveToSpectatorCache(s, MakeGameMsg(msg)));
-			break;
-		}
+			ctx.SendToAll(ctx.SaveToSpectatorCache(s, std::move(msg)));
 		}
-	};
+	private:
+		Context& ctx;
+		State::Dueling& s;
+	} output(*this, s);
+	MsgPipeline pipeline(*s.core, s.duelPtr, *s.replay, &s.queryCache, output, scratch, id);
 	auto PostAnalyzeMsg = [&](const Msg& msg) -> std::optional<DuelFinishReason>
 	{
 		using Reason = DuelFinishReason::Reason;
@@ -515,33 +448,64 @@ std::optional<Context::DuelFinishReason> Context::Process(State::Dueling& s) noe
 		}
 		return std::nullopt;
 	};
+	// Degrades the room when the memory budget is exceeded, first by not
+	// letting anyone else spectate, which allows dropping the spectator cache,
+	// and then by aborting the duel if that was not enough.
+	auto CheckMemoryBudget = [&]() -> std::optional<DuelFinishReason>
+	{
+		if(memoryBudget == 0U || memory.Current() <= memoryBudget)
+			return std::nullopt;
+		if(!s.spectatorCacheDropped)
+		{
+			DropSpectatorCache(s);
+			if(memory.Current() <= memoryBudget)
+				return std::nullopt;
+		}
+		return DuelFinishReason{DuelFinishReason::Reason::REASON_MEMORY_EXCEEDED, 2U};
+	};
 	auto ProcessSingleMsg = [&](const Msg& msg) -> std::optional<DuelFinishReason>
 	{
 		if(!PreAnalyzeMsg(msg))
 			return std::nullopt;
-		ProcessQueryRequests(GetPreDistQueryRequests(msg));
-		DistributeMsg(msg);
-		ProcessQueryRequests(GetPostDistQueryRequests(msg));
-		return PostAnalyzeMsg(msg);
+		pipeline.Handle(msg);
+		if(auto dfrOpt = PostAnalyzeMsg(msg); dfrOpt)
+			return dfrOpt;
+		return CheckMemoryBudget();
 	};
+	// NOTE: Everything allocated from the scratch arena is gone once this
+	// function returns, so anything that has to outlive it (replay, spectator
+	// cache, last hint and request) is copied into memory of its own.
+	std::optional<DuelFinishReason> dfrOpt;
 	try
 	{
 		for(;;)
 		{
-			Core::IWrapper::DuelStatus status = s.core->Process(s.duelPtr);
-			for(const auto& msg : SplitToMsgs(s.core->GetMessages(s.duelPtr)))
-				if(auto dfrOpt = ProcessSingleMsg(msg); dfrOpt)
-					return dfrOpt;
-			if(status != Core::IWrapper::DuelStatus::DUEL_STATUS_CONTINUE)
+			const auto status = [&]()
+			{
+				const Tracing::Span span("IWrapper::Process", id);
+				return s.core->Process(s.duelPtr);
+			}();
+			pipeline.NewBatch();
+			const auto buffer = [&]()
+			{
+				const Tracing::Span span("IWrapper::GetMessages", id);
+				return s.core->GetMessages(s.duelPtr);
+			}();
+			for(const auto& msg : SplitToMsgs(buffer, &scratch))
+				if((dfrOpt = ProcessSingleMsg(msg)))
+					break;
+			if(dfrOpt || status != Core::IWrapper::DuelStatus::DUEL_STATUS_CONTINUE)
 				break;
 		}
 	}
 	catch(Core::Exception& e)
 	{
 		LOG_ERROR(I18N::ROOM_DUELING_CORE_EXCEPT_PROCESSING, e.what());
-		return CORE_EXC_REASON;
+		dfrOpt = CORE_EXC_REASON;
 	}
-	return std::nullopt;
+	pipeline.NewBatch(); // NOTE: Its queries are gone after releasing.
+	scratch.release();
+	return dfrOpt;
 }
 
 StateVariant Context::Finish(State::Dueling& s, const DuelFinishReason& dfr) noexcept
@@ -563,9 +527,12 @@ StateVariant Context::Finish(State::Dueling& s, const DuelFinishReason& dfr) noe
 	}
 	tagg.Cancel(0U);
 	tagg.Cancel(1U);
+	if(rl)
+		rl->Log(I18N::ROOM_LOGGER_DUEL_MEMORY_PEAK, s.replayId, memory.Peak());
+	DropSpectatorCache(s); // NOTE: Also gives back the charged bytes.
 	auto SendWinMsg = [&](uint8_t reason)
 	{
-		const std::vector<uint8_t> winMsg =
+		const YGOPro::CoreUtils::Msg winMsg =
 		{
 			MSG_WIN,
 			(dfr.winner != 2U) ? GetSwappedTeam(dfr.winner) : uint8_t(2U),
@@ -576,7 +543,10 @@ StateVariant Context::Finish(State::Dueling& s, const DuelFinishReason& dfr) noe
 	};
 	auto SendReplay = [&]()
 	{
-		s.replay->Serialize();
+		{
+			const Metrics::ScopedTimer timer(Metrics::Histogram::REPLAY_SERIALIZE);
+			s.replay->Serialize();
+		}
 		svc.replayManager.Save(s.replayId, *s.replay);
 		if(s.replay->Bytes().size() > YGOPro::STOCMsg::MAX_PAYLOAD_SIZE)
 			SendToAll(MakeChat(CHAT_MSG_TYPE_ERROR, I18N::CLIENT_ROOM_REPLAY_TOO_BIG));
@@ -626,8 +596,12 @@ StateVariant Context::Finish(State::Dueling& s, const DuelFinishReason& dfr) noe
 		return State::Sidedecking{turnDecider, {}};
 	}
 	case Reason::REASON_CORE_CRASHED:
+	case Reason::REASON_MEMORY_EXCEEDED:
 	{
-		SendToAll(MakeChat(CHAT_MSG_TYPE_ERROR, I18N::CLIENT_ROOM_CORE_EXCEPT));
+		if(dfr.reason == Reason::REASON_CORE_CRASHED)
+			SendToAll(MakeChat(CHAT_MSG_TYPE_ERROR, I18N::CLIENT_ROOM_CORE_EXCEPT));
+		else
+			SendToAll(MakeChat(CHAT_MSG_TYPE_ERROR, I18N::CLIENT_ROOM_MEMORY_EXCEEDED));
 		SendWinMsg(WIN_REASON_INTERNAL_ERROR);
 		SendReplay();
 		if(hostInfo.bestOf <= 1)
@@ -652,8 +626,22 @@ const YGOPro::STOCMsg& Context::SaveToSpectatorCache(
 	State::Dueling& s,
 	YGOPro::STOCMsg&& msg) noexcept
 {
+	// NOTE: The message is used by the caller within the same expression
+	// that constructed it, so it can be returned directly if not cached.
+	if(s.spectatorCacheDropped)
+		return msg;
+	memory.Charge(msg.HeapSize());
 	s.spectatorCache.emplace_back(msg);
 	return s.spectatorCache.back();
 }
 
+void Context::DropSpectatorCache(State::Dueling& s) noexcept
+{
+	for(const auto& msg : s.spectatorCache)
+		memory.Discharge(msg.HeapSize());
+	s.spectatorCache.clear();
+	s.spectatorCache.shrink_to_fit();
+	s.spectatorCacheDropped = true;
+}
+
 } // namespace Ignis::Multirole::Room
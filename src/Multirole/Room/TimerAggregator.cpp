@@ -1,41 +1,54 @@
 #include "TimerAggregator.hpp"
 
-#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/post.hpp>
 
 #include "Instance.hpp"
 
 namespace Ignis::Multirole::Room
 {
 
-TimerAggregator::TimerAggregator(Instance& room) :
+TimerAggregator::TimerAggregator(Instance& room, TimerWheel& wheel) :
 	room(room),
-	strand(room.Strand()),
-	timers({AsioTimer(strand.context()), AsioTimer(strand.context())})
+	expiries(),
+	timers({{
+		{wheel, [this](){OnExpire(0U);}},
+		{wheel, [this](){OnExpire(1U);}},
+	}})
 {}
 
 void TimerAggregator::Cancel(uint8_t team)
 {
 	assert(team <= 1U);
-	timers[team].cancel();
+	timers[team].Cancel();
 }
 
-void TimerAggregator::ExpiresAfter(uint8_t team, const AsioTimer::duration& expiryTime)
+void TimerAggregator::ExpiresAfter(uint8_t team, const TimerClock::duration& expiryTime)
 {
 	assert(team <= 1U);
-	timers[team].expires_after(expiryTime);
-	timers[team].async_wait(boost::asio::bind_executor(strand,
-	[team, room = room.shared_from_this()](boost::system::error_code ec)
-	{
-		if(!ec)
-			room->Dispatch(Event::TimerExpired{team});
-	}));
+	expiries[team] = TimerClock::now() + expiryTime;
+	timers[team].Arm(expiryTime);
 }
 
-AsioTimer::time_point TimerAggregator::Expiry(uint8_t team) const
+TimerClock::time_point TimerAggregator::Expiry(uint8_t team) const
 {
 	assert(team <= 1U);
-	return timers[team].expiry();
+	return expiries[team];
 }
 
+// private
+
+void TimerAggregator::OnExpire(uint8_t team) noexcept
+{
+	// NOTE: Called from the wheel, the room might be going away. The
+	// reference is moved into the handler so the room is never destroyed
+	// here, as that would cancel its handles with the wheel still locked.
+	if(auto r = room.weak_from_this().lock(); r)
+	{
+		boost::asio::post(room.Strand(), [team, r = std::move(r)]()
+		{
+			r->Dispatch(Event::TimerExpired{team});
+		});
+	}
+}
 
 } // Ignis::Multirole::Room
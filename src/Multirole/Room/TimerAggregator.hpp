@@ -1,36 +1,39 @@
 #ifndef ROOM_TIMER_AGGREGATOR_HPP
 #define ROOM_TIMER_AGGREGATOR_HPP
 #include <array>
+#include <chrono>
 
-#include <boost/asio/io_context_strand.hpp>
-#include <boost/asio/system_timer.hpp>
+#include "../TimerWheel.hpp"
 
 namespace Ignis::Multirole::Room
 {
 
 class Instance;
 
-using AsioTimer = boost::asio::system_timer;
+// NOTE: Expiry times are reported on the system clock as they are sent to
+// clients, the deadlines themselves live on the wheel.
+using TimerClock = std::chrono::system_clock;
 
 class TimerAggregator final
 {
 public:
-	TimerAggregator(Instance& room);
+	TimerAggregator(Instance& room, TimerWheel& wheel);
 
-	// Cancels one timer's asynchronous operations that were set by
-	// calling ExpireAfter.
+	// Cancels one timer's deadline that was set by calling ExpiresAfter.
 	void Cancel(uint8_t team);
 
-	// Sets one timer's expiry time relative to now, also sets
-	// asynchronous operation to dispatch time-out event to room instance.
-	void ExpiresAfter(uint8_t team, const AsioTimer::duration& expiryTime);
+	// Sets one timer's expiry time relative to now, once reached a time-out
+	// event is dispatched to the room instance.
+	void ExpiresAfter(uint8_t team, const TimerClock::duration& expiryTime);
 
 	// Gets one timer's expiry time as an absolute time.
-	AsioTimer::time_point Expiry(uint8_t team) const;
+	TimerClock::time_point Expiry(uint8_t team) const;
 private:
 	Instance& room;
-	boost::asio::io_context::strand& strand;
-	std::array<AsioTimer, 2U> timers;
+	std::array<TimerClock::time_point, 2U> expiries;
+	std::array<TimerWheel::Handle, 2U> timers;
+
+	void OnExpire(uint8_t team) noexcept;
 };
 
 } // Ignis::Multirole::Room
@@ -33,10 +33,8 @@ STOCMsg STOCMsgFactory::MakeChat(const Room::Client& c, bool isTeam, std::string
 	else
 		proto.type = STOCMsg::Chat2::PTYPE_DUELIST;
 	proto.isTeam = static_cast<uint8_t>(isTeam);
-	auto str16 = UTF8ToUTF16(c.Name());
-	std::memcpy(&proto.clientName[0U], str16.data(), UTF16ByteCount(str16));
-	str16 = UTF8ToUTF16(str);
-	std::memcpy(&proto.msg[0U], str16.data(), UTF16ByteCount(str16));
+	UTF8ToUTF16Field(c.Name(), proto.clientName);
+	UTF8ToUTF16Field(str, proto.msg);
 	return {proto};
 }
 
@@ -49,16 +47,14 @@ STOCMsg STOCMsgFactory::MakeChat(ChatMsgType type, std::string_view str)
 		proto.type = STOCMsg::Chat2::PTYPE_SYSTEM_ERROR;
 	else // if(type == PTYPE_SYSTEM_SHOUT)
 		proto.type = STOCMsg::Chat2::PTYPE_SYSTEM_SHOUT;
-	const auto str16 = UTF8ToUTF16(str);
-	std::memcpy(&proto.msg[0U], str16.data(), UTF16ByteCount(str16));
+	UTF8ToUTF16Field(str, proto.msg);
 	return {proto};
 }
 
 STOCMsg STOCMsgFactory::MakePlayerEnter(const Room::Client& c) const
 {
-	const auto& str16 = UTF8ToUTF16(c.Name());
 	STOCMsg::PlayerEnter proto{};
-	std::memcpy(&proto.name, str16.data(), UTF16ByteCount(str16));
+	UTF8ToUTF16Field(c.Name(), proto.name);
 	proto.pos = EncodePosition(c.Position());
 	return {proto};
 }
@@ -119,7 +115,7 @@ STOCMsg STOCMsgFactory::MakeRPSResult(uint8_t t0, uint8_t t1)
 	return {STOCMsg::RPSResult{t0, t1}};
 }
 
-STOCMsg STOCMsgFactory::MakeGameMsg(const std::vector<uint8_t>& msg)
+STOCMsg STOCMsgFactory::MakeGameMsg(const std::pmr::vector<uint8_t>& msg)
 {
 	return STOCMsg{STOCMsg::MsgType::GAME_MSG, msg};
 }
@@ -1,5 +1,8 @@
 #ifndef STOCMSGFACTORY_HPP
 #define STOCMSGFACTORY_HPP
+#include <memory_resource>
+#include <vector>
+
 #include "Room/Client.hpp"
 #include "YGOPro/STOCMsg.hpp"
 
@@ -82,7 +85,7 @@ public:
 	// Creates a message that has both teams RPS face-off result
 	static YGOPro::STOCMsg MakeRPSResult(uint8_t t0, uint8_t t1);
 	// Creates a message that wraps around a core message
-	static YGOPro::STOCMsg MakeGameMsg(const std::vector<uint8_t>& msg);
+	static YGOPro::STOCMsg MakeGameMsg(const std::pmr::vector<uint8_t>& msg);
 	// Creates a message to ask a client if he desires to rematch
 	static YGOPro::STOCMsg MakeAskIfRematch();
 	// Creates a message signaling client to wait for rematch answers
@@ -1,11 +1,18 @@
 #include "BanlistProvider.hpp"
 
-#include <fstream>
-#include <mutex>
+#include <algorithm> // std::min
+#include <atomic>
+#include <optional>
+#include <thread>
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 
 #include "LogHandler.hpp"
-#define LOG_INFO(...) lh.Log(ServiceType::BANLIST_PROVIDER, Level::INFO, __VA_ARGS__)
-#define LOG_ERROR(...) lh.Log(ServiceType::BANLIST_PROVIDER, Level::ERROR, __VA_ARGS__)
+#define LOG_INFO(...) MULTIROLE_LOG_SVC(lh, ServiceType::BANLIST_PROVIDER, Level::INFO, __VA_ARGS__)
+#define LOG_ERROR(...) MULTIROLE_LOG_SVC(lh, ServiceType::BANLIST_PROVIDER, Level::ERROR, __VA_ARGS__)
 #include "../I18N.hpp"
 #define YGOPRO_BANLIST_PARSER_IMPLEMENTATION
 #include "../YGOPro/BanlistParser.hpp"
@@ -13,6 +20,23 @@
 namespace Ignis::Multirole
 {
 
+namespace
+{
+
+// 64-bit FNV-1a.
+uint64_t HashContents(std::string_view contents) noexcept
+{
+	uint64_t hash = 0xCBF29CE484222325U;
+	for(const char c : contents)
+	{
+		hash ^= static_cast<uint8_t>(c);
+		hash *= 0x100000001B3U;
+	}
+	return hash;
+}
+
+} // namespace
+
 Service::BanlistProvider::BanlistProvider(Service::LogHandler& lh, std::string_view fnRegexStr) :
 	lh(lh),
 	fnRegex(fnRegexStr.data())
@@ -28,40 +52,92 @@ YGOPro::BanlistPtr Service::BanlistProvider::GetBanlistByHash(YGOPro::BanlistHas
 
 void Service::BanlistProvider::OnAdd(const std::filesystem::path& path, const PathVector& fileList)
 {
-	LoadBanlists(path, fileList);
+	UpdateBanlists(path, {}, fileList);
 }
 
 void Service::BanlistProvider::OnDiff(const std::filesystem::path& path, const GitDiff& diff)
 {
-	LoadBanlists(path, diff.added);
+	UpdateBanlists(path, diff.removed, diff.added);
 }
 
 // private
 
-void Service::BanlistProvider::LoadBanlists(const std::filesystem::path& path, const PathVector& fileList) noexcept
+void Service::BanlistProvider::UpdateBanlists(const std::filesystem::path& path, const PathVector& removed, const PathVector& added) noexcept
 {
-	YGOPro::BanlistMap tmp;
-	for(const auto& fn : fileList)
+	using namespace boost::interprocess;
+	auto Filter = [&](const PathVector& fileList)
 	{
-		if(!std::regex_match(fn.string(), fnRegex))
-			continue;
-		auto fullPath = (path / fn).lexically_normal();
-		LOG_INFO(I18N::BANLIST_PROVIDER_LOADING_ONE, fullPath.string());
-		try
-		{
-			std::ifstream f(fullPath);
-			YGOPro::ParseForBanlists(f, tmp);
-		}
-		catch(const std::exception& e)
+		std::vector<std::filesystem::path> ret;
+		for(const auto& fn : fileList)
+			if(std::regex_match(fn.string(), fnRegex))
+				ret.emplace_back((path / fn).lexically_normal());
+		return ret;
+	};
+	const auto toRemove = Filter(removed);
+	const auto toLoad = Filter(added);
+	std::scoped_lock lock(mFiles);
+	// NOTE: Modified files are both removed and added, so their previous
+	// contents are only forgotten after seeing if they changed at all.
+	std::vector<std::optional<File>> loaded(toLoad.size());
+	std::atomic<std::size_t> next{0U};
+	auto Worker = [&]()
+	{
+		for(std::size_t i = next++; i < toLoad.size(); i = next++)
 		{
-			LOG_ERROR(I18N::BANLIST_PROVIDER_COULD_NOT_LOAD_ONE, e.what());
+			const auto& fullPath = toLoad[i];
+			try
+			{
+				std::string_view contents;
+				file_mapping mapping;
+				mapped_region region;
+				// NOTE: Empty files can't be mapped.
+				if(std::filesystem::file_size(fullPath) != 0U)
+				{
+					mapping = file_mapping(fullPath.string().data(), read_only);
+					region = mapped_region(mapping, read_only);
+					contents = {static_cast<const char*>(region.get_address()), region.get_size()};
+				}
+				const uint64_t contentHash = HashContents(contents);
+				if(auto search = files.find(fullPath); search != files.end() && search->second.contentHash == contentHash)
+				{
+					loaded[i] = search->second;
+					continue;
+				}
+				LOG_INFO(I18N::BANLIST_PROVIDER_LOADING_ONE, fullPath.string());
+				auto& file = loaded[i].emplace(File{contentHash, {}});
+				YGOPro::ParseForBanlists(contents, file.banlists);
+			}
+			catch(const std::exception& e)
+			{
+				LOG_ERROR(I18N::BANLIST_PROVIDER_COULD_NOT_LOAD_ONE, e.what());
+			}
 		}
+	};
+	const auto threadCount = static_cast<unsigned int>(std::min<std::size_t>(
+		std::max(1U, std::thread::hardware_concurrency()), toLoad.size()));
+	if(threadCount > 1U)
+	{
+		boost::asio::thread_pool threads(threadCount);
+		for(unsigned int i = 0U; i < threadCount; i++)
+			boost::asio::post(threads, Worker);
+		threads.join();
+	}
+	else
+	{
+		Worker();
 	}
-	std::scoped_lock lock(mBanlists);
-	// Delete banlists that have the same hash (`merge` does not replace them)
-	for(const auto& kv : tmp)
-		banlists.erase(kv.first);
-	banlists.merge(tmp);
+	for(const auto& fullPath : toRemove)
+		files.erase(fullPath);
+	for(std::size_t i = 0U; i < toLoad.size(); i++)
+		if(loaded[i].has_value())
+			files.insert_or_assign(toLoad[i], std::move(*loaded[i]));
+	// Banlists with the same hash have the same contents, so keeping any
+	// of them is fine.
+	YGOPro::BanlistMap tmp;
+	for(const auto& [fullPath, file] : files)
+		tmp.insert(file.banlists.cbegin(), file.banlists.cend());
+	std::scoped_lock lock2(mBanlists);
+	banlists.swap(tmp);
 }
 
 } // namespace Ignis::Multirole
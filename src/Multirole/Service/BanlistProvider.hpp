@@ -2,6 +2,8 @@
 #define SERVICE_BANLISTPROVIDER_HPP
 #include "../Service.hpp"
 
+#include <map>
+#include <mutex>
 #include <regex>
 #include <shared_mutex>
 
@@ -22,12 +24,23 @@ public:
 	void OnAdd(const std::filesystem::path& path, const PathVector& fileList) override;
 	void OnDiff(const std::filesystem::path& path, const GitDiff& diff) override;
 private:
+	struct File
+	{
+		uint64_t contentHash;
+		YGOPro::BanlistMap banlists;
+	};
+
 	Service::LogHandler& lh;
 	const std::regex fnRegex;
+	std::map<std::filesystem::path, File> files;
+	std::mutex mFiles;
 	YGOPro::BanlistMap banlists;
 	mutable std::shared_mutex mBanlists;
 
-	void LoadBanlists(const std::filesystem::path& path, const PathVector& fileList) noexcept;
+	// Forgets the banlists of the removed files and (re)loads the added ones
+	// in parallel, skipping files whose contents didn't change, then
+	// replaces all the banlists at once.
+	void UpdateBanlists(const std::filesystem::path& path, const PathVector& removed, const PathVector& added) noexcept;
 };
 
 } // namespace Ignis::Multirole
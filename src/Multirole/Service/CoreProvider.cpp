@@ -1,37 +1,56 @@
 #include "CoreProvider.hpp"
 
+#include <algorithm> // std::max
 #include <filesystem>
 #include <fstream>
 
+#include <boost/asio/strand.hpp>
+#include <boost/asio/thread_pool.hpp>
+
 #include "LogHandler.hpp"
-#define LOG_INFO(...) lh.Log(ServiceType::CORE_PROVIDER, Level::INFO, __VA_ARGS__)
-#define LOG_ERROR(...) lh.Log(ServiceType::CORE_PROVIDER, Level::ERROR, __VA_ARGS__)
+#define LOG_INFO(...) MULTIROLE_LOG_SVC(lh, ServiceType::CORE_PROVIDER, Level::INFO, __VA_ARGS__)
+#define LOG_ERROR(...) MULTIROLE_LOG_SVC(lh, ServiceType::CORE_PROVIDER, Level::ERROR, __VA_ARGS__)
 #include "../I18N.hpp"
 #include "../Core/DLWrapper.hpp"
 #include "../Core/HornetWrapper.hpp"
+#include "CoreProvider/ShadowWrapper.hpp"
 
 namespace Ignis::Multirole
 {
 
-Service::CoreProvider::CoreProvider(Service::LogHandler& lh, std::string_view fnRegexStr, const std::filesystem::path& tmpDir, CoreType type, bool loadPerCall)
+Service::CoreProvider::CoreProvider(Service::LogHandler& lh, std::string_view fnRegexStr, const std::filesystem::path& tmpDir, CoreType type, bool loadPerCall, const CanaryOptions& canaryOpts)
 	:
 	lh(lh),
 	fnRegex(fnRegexStr.data()),
 	tmpDir(tmpDir),
 	type(type),
 	loadPerCall(loadPerCall),
+	canaryOpts(canaryOpts),
 	uniqueId(std::chrono::system_clock::now().time_since_epoch().count()),
 	loadCount(0U),
-	shouldTest(true)
+	shouldTest(true),
+	duelCount(0U),
+	reportHandle(std::make_shared<ReportHandle>())
 {
+	reportHandle->provider = this;
 	if(!exists(tmpDir) && !create_directory(tmpDir))
 		throw std::runtime_error(I18N::CORE_PROVIDER_COULD_NOT_CREATE_TMP_DIR);
 	if(!is_directory(tmpDir))
 		throw std::runtime_error(I18N::CORE_PROVIDER_PATH_IS_FILE_NOT_DIR);
+	if(canaryOpts.enabled)
+		canaryPool = std::make_unique<boost::asio::thread_pool>(canaryOpts.threads);
 }
 
 Service::CoreProvider::~CoreProvider() noexcept
 {
+	// NOTE: Shadowed duels that end from now on (e.g: on rooms still holding
+	// onto their core) have nobody to report to anymore.
+	{
+		std::scoped_lock lock(reportHandle->m);
+		reportHandle->provider = nullptr;
+	}
+	if(canaryPool)
+		canaryPool->join();
 	for(const auto& fn : pLocs)
 		remove(fn);
 }
@@ -40,10 +59,48 @@ Service::CoreProvider::CorePtr Service::CoreProvider::GetCore() const
 {
 	std::shared_lock lock(mCore);
 	if(loadPerCall)
-		return LoadCore();
+		return LoadCore(coreLoc);
 	return core;
 }
 
+Service::CoreProvider::CorePtr Service::CoreProvider::GetCore(std::shared_ptr<Core::IDataSupplier> dataSupplier)
+{
+	std::shared_lock lock(mCore);
+	auto liveCore = loadPerCall ? LoadCore(coreLoc) : core;
+	if(!candidate)
+		return liveCore;
+	// NOTE: Spreads the shadowed duels evenly instead of picking them
+	// randomly, so the rate is met exactly no matter how many duels there are.
+	const std::size_t n = duelCount++;
+	if((n * canaryOpts.sampleRate) / 100U == ((n + 1U) * canaryOpts.sampleRate) / 100U)
+		return liveCore;
+	CorePtr candidateCore;
+	try
+	{
+		candidateCore = loadPerCall ? LoadCore(candidate->loc) : candidate->core;
+	}
+	catch(Core::Exception& e)
+	{
+		LOG_ERROR(I18N::CORE_PROVIDER_ERROR_WHILE_TESTING, candidate->loc.string(), e.what());
+		return liveCore;
+	}
+	return std::make_shared<CoreProviderDetail::ShadowWrapper>(
+		std::move(liveCore),
+		std::move(candidateCore),
+		boost::asio::make_strand(*canaryPool),
+		std::move(dataSupplier),
+		canaryOpts.maxPendingCalls,
+		[h = std::weak_ptr<ReportHandle>(reportHandle), c = candidate](const CoreProviderDetail::ShadowResult& r)
+		{
+			const auto handle = h.lock();
+			if(!handle)
+				return;
+			std::scoped_lock lock(handle->m);
+			if(handle->provider != nullptr)
+				handle->provider->OnShadowDuelEnd(c, r);
+		});
+}
+
 void Service::CoreProvider::OnAdd(const std::filesystem::path& path, const PathVector& fileList)
 {
 	OnGitUpdate(path, fileList);
@@ -56,12 +113,12 @@ void Service::CoreProvider::OnDiff(const std::filesystem::path& path, const GitD
 
 // private
 
-Service::CoreProvider::CorePtr Service::CoreProvider::LoadCore() const
+Service::CoreProvider::CorePtr Service::CoreProvider::LoadCore(const std::filesystem::path& loc) const
 {
 	if(type == CoreType::SHARED)
-		return std::make_shared<Core::DLWrapper>(coreLoc.string());
+		return std::make_shared<Core::DLWrapper>(loc.string());
 	if (type == CoreType::HORNET)
-		return std::make_shared<Core::HornetWrapper>(coreLoc.string());
+		return std::make_shared<Core::HornetWrapper>(loc.string());
 	throw std::runtime_error(I18N::CORE_PROVIDER_WRONG_CORE_TYPE);
 }
 
@@ -91,7 +148,7 @@ void Service::CoreProvider::OnGitUpdate(const std::filesystem::path& path, const
 	}
 	try
 	{
-		auto core = LoadCore();
+		auto core = LoadCore(coreLoc);
 		const auto ver = core->Version();
 		LOG_INFO(I18N::CORE_PROVIDER_VERSION_REPORTED, ver.first, ver.second);
 	}
@@ -103,9 +160,69 @@ void Service::CoreProvider::OnGitUpdate(const std::filesystem::path& path, const
 		coreLoc = oldCoreLoc;
 		return;
 	}
+	// The very first core has nothing to be compared against, so it is always
+	// used directly.
+	if(canaryOpts.enabled && !shouldTest)
+	{
+		if(candidate)
+			LOG_INFO(I18N::CORE_PROVIDER_CANARY_REPLACED, candidate->loc.string());
+		candidate = std::make_shared<Candidate>(Candidate{coreLoc, nullptr, 0U, 0U, {}, {}});
+		if(!loadPerCall)
+			candidate->core = LoadCore(coreLoc);
+		coreLoc = oldCoreLoc;
+		LOG_INFO(I18N::CORE_PROVIDER_CANARY_STARTED, candidate->loc.string(),
+			canaryOpts.sampleRate, canaryOpts.duelsToPromote);
+		return;
+	}
 	shouldTest = false;
 	if(!loadPerCall)
-		core = LoadCore();
+		core = LoadCore(coreLoc);
+}
+
+void Service::CoreProvider::OnShadowDuelEnd(const std::shared_ptr<Candidate>& c, const CoreProviderDetail::ShadowResult& r) noexcept
+{
+	using Verdict = CoreProviderDetail::ShadowResult::Verdict;
+	std::scoped_lock lock(mCore);
+	if(candidate != c) // Already promoted, discarded or replaced.
+		return;
+	switch(r.verdict)
+	{
+	case Verdict::VERDICT_INCONCLUSIVE:
+	{
+		if(r.skippedCalls != 0U)
+			LOG_INFO(I18N::CORE_PROVIDER_CANARY_FELL_BEHIND, c->loc.string(), r.skippedCalls);
+		return;
+	}
+	case Verdict::VERDICT_DIVERGED:
+	{
+		LOG_ERROR(I18N::CORE_PROVIDER_CANARY_DIVERGED, c->loc.string(), r.divergedAt);
+		candidate.reset();
+		return;
+	}
+	case Verdict::VERDICT_CRASHED:
+	{
+		LOG_ERROR(I18N::CORE_PROVIDER_CANARY_CRASHED, c->loc.string(), r.error);
+		candidate.reset();
+		return;
+	}
+	case Verdict::VERDICT_MATCHED:
+		break;
+	}
+	c->processCalls += r.processCalls;
+	c->liveElapsed += r.liveElapsed;
+	c->candidateElapsed += r.candidateElapsed;
+	if(++c->cleanDuels < canaryOpts.duelsToPromote)
+		return;
+	auto AvgUs = [calls = std::max<uint64_t>(c->processCalls, 1U)](std::chrono::steady_clock::duration d)
+	{
+		return std::chrono::duration<double, std::micro>(d).count() / static_cast<double>(calls);
+	};
+	LOG_INFO(I18N::CORE_PROVIDER_CANARY_PROMOTED, c->loc.string(), c->cleanDuels,
+		c->processCalls, AvgUs(c->liveElapsed), AvgUs(c->candidateElapsed));
+	coreLoc = c->loc;
+	if(!loadPerCall)
+		core = c->core;
+	candidate.reset();
 }
 
 } // namespace Ignis::Multirole
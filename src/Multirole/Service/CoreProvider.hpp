@@ -2,24 +2,42 @@
 #define SERVICE_COREPROVIDER_HPP
 #include "../Service.hpp"
 
+#include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <list>
 #include <regex>
 #include <memory>
+#include <mutex>
 #include <shared_mutex>
 
 #include "../IGitRepoObserver.hpp"
 
+namespace boost::asio
+{
+
+class thread_pool;
+
+} // namespace boost::asio
+
 namespace Ignis::Multirole
 {
 
 namespace Core
 {
 
+class IDataSupplier;
 class IWrapper;
 
 } // namespace Core
 
+namespace CoreProviderDetail
+{
+
+struct ShadowResult;
+
+} // namespace CoreProviderDetail
+
 class Service::CoreProvider final : public IGitRepoObserver
 {
 public:
@@ -29,32 +47,77 @@ public:
 		HORNET,
 	};
 
+	// Options for evaluating new cores before they are used by every room.
+	// When enabled, a core found on a repository update is kept as a
+	// candidate instead of replacing the current one, and a fraction of the
+	// duels is also run on it in the background. The candidate replaces the
+	// current core once enough of those duels produced exactly the same
+	// output, and is discarded as soon as one of them does not.
+	struct CanaryOptions
+	{
+		bool enabled;
+		unsigned int sampleRate; // Percentage of duels shadowed.
+		std::size_t duelsToPromote;
+		unsigned int threads;
+		std::size_t maxPendingCalls; // Per shadowed duel.
+	};
+
 	using CorePtr = std::shared_ptr<Core::IWrapper>;
 
-	CoreProvider(Service::LogHandler& lh, std::string_view fnRegexStr, const std::filesystem::path& tmpDir, CoreType type, bool loadPerCall);
+	CoreProvider(Service::LogHandler& lh, std::string_view fnRegexStr, const std::filesystem::path& tmpDir, CoreType type, bool loadPerCall, const CanaryOptions& canaryOpts);
 	~CoreProvider() noexcept;
 
 	// Will return a core instance based on the options set.
 	CorePtr GetCore() const;
 
+	// Same as above, but meant to be used for a single duel, which might get
+	// shadowed by the candidate core if there is one. The data supplier must
+	// be the one the duel is going to use, and is kept alive by the shadow.
+	CorePtr GetCore(std::shared_ptr<Core::IDataSupplier> dataSupplier);
+
 	// IGitRepoObserver overrides
 	void OnAdd(const std::filesystem::path& path, const PathVector& fileList) override;
 	void OnDiff(const std::filesystem::path& path, const GitDiff& diff) override;
 private:
+	struct Candidate
+	{
+		std::filesystem::path loc;
+		CorePtr core; // Only set if loadPerCall is false.
+		std::size_t cleanDuels;
+		uint64_t processCalls;
+		std::chrono::steady_clock::duration liveElapsed;
+		std::chrono::steady_clock::duration candidateElapsed;
+	};
+
+	// Lets shadowed duels report back for as long as the provider exists, as
+	// rooms might still be holding onto a shadowed core once it is gone.
+	struct ReportHandle
+	{
+		std::mutex m;
+		CoreProvider* provider;
+	};
+
 	Service::LogHandler& lh;
 	const std::regex fnRegex;
 	const std::filesystem::path tmpDir;
 	const CoreType type;
 	const bool loadPerCall;
+	const CanaryOptions canaryOpts;
 	const std::chrono::system_clock::rep uniqueId;
 	std::size_t loadCount;
 	bool shouldTest;
 	std::filesystem::path coreLoc;
 	CorePtr core;
 	std::list<std::filesystem::path> pLocs; // Previous locations for core file.
-	mutable std::shared_mutex mCore; // used for both corePath and core.
+	std::shared_ptr<Candidate> candidate;
+	std::atomic<std::size_t> duelCount;
+	std::unique_ptr<boost::asio::thread_pool> canaryPool;
+	std::shared_ptr<ReportHandle> reportHandle;
+	mutable std::shared_mutex mCore; // used for corePath, core and candidate.
+
+	CorePtr LoadCore(const std::filesystem::path& loc) const;
 
-	CorePtr LoadCore() const;
+	void OnShadowDuelEnd(const std::shared_ptr<Candidate>& c, const CoreProviderDetail::ShadowResult& r) noexcept;
 
 	void OnGitUpdate(const std::filesystem::path& path, const PathVector& fileList);
 };
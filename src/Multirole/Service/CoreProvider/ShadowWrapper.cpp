@@ -0,0 +1,223 @@
+#include "ShadowWrapper.hpp"
+
+#include <boost/asio/post.hpp>
+
+#include "../../Metrics.hpp"
+
+namespace Ignis::Multirole::CoreProviderDetail
+{
+
+ShadowWrapper::ShadowWrapper(
+	std::shared_ptr<Core::IWrapper> live,
+	std::shared_ptr<Core::IWrapper> candidate,
+	Executor strand,
+	std::shared_ptr<Core::IDataSupplier> dataSupplier,
+	std::size_t maxPending,
+	ReportFunc report)
+	:
+	live(std::move(live)),
+	candidate(std::move(candidate)),
+	strand(std::move(strand)),
+	dataSupplier(std::move(dataSupplier)),
+	maxPending(maxPending),
+	report(std::move(report))
+{}
+
+ShadowWrapper::~ShadowWrapper() noexcept
+{
+	// NOTE: Every mirrored call holds a reference to the wrapper, so by now
+	// all of them already ran and the strand-only state can be used freely.
+	if(shadowDuel != nullptr && verdict != ShadowResult::Verdict::VERDICT_CRASHED)
+	{
+		try
+		{
+			candidate->DestroyDuel(shadowDuel);
+		}
+		catch(Core::Exception& e)
+		{
+			verdict = ShadowResult::Verdict::VERDICT_CRASHED;
+			error = e.what();
+		}
+	}
+	if(verdict == ShadowResult::Verdict::VERDICT_MATCHED && (!liveDestroyed || fellBehind))
+		verdict = ShadowResult::Verdict::VERDICT_INCONCLUSIVE;
+	report({verdict, error, processCalls, divergedAt, skippedCalls, liveElapsed, candidateElapsed});
+}
+
+std::pair<int, int> ShadowWrapper::Version()
+{
+	return live->Version();
+}
+
+ShadowWrapper::Duel ShadowWrapper::CreateDuel(const DuelOptions& opts)
+{
+	Duel duel = live->CreateDuel(opts);
+	if(liveDuel != nullptr)
+		return duel;
+	liveDuel = duel;
+	// NOTE: The logger is not passed along as script errors are already
+	// reported by the live duel, and the room might be gone by the time the
+	// shadow duel runs.
+	Mirror([&scriptSupplier = opts.scriptSupplier, seed = opts.seed,
+		flags = opts.flags, team1 = opts.team1, team2 = opts.team2](ShadowWrapper& self)
+	{
+		self.shadowDuel = self.candidate->CreateDuel(
+			{*self.dataSupplier, scriptSupplier, nullptr, seed, flags, team1, team2});
+	});
+	return duel;
+}
+
+void ShadowWrapper::DestroyDuel(Duel duel)
+{
+	live->DestroyDuel(duel);
+	if(!IsShadowed(duel))
+		return;
+	liveDestroyed = true;
+	Mirror([](ShadowWrapper& self)
+	{
+		self.candidate->DestroyDuel(self.shadowDuel);
+		self.shadowDuel = nullptr;
+	});
+}
+
+void ShadowWrapper::AddCard(Duel duel, const NewCardInfo& info)
+{
+	live->AddCard(duel, info);
+	if(!IsShadowed(duel))
+		return;
+	Mirror([info](ShadowWrapper& self)
+	{
+		self.candidate->AddCard(self.shadowDuel, info);
+	});
+}
+
+void ShadowWrapper::Start(Duel duel)
+{
+	live->Start(duel);
+	if(!IsShadowed(duel))
+		return;
+	Mirror([](ShadowWrapper& self)
+	{
+		self.candidate->Start(self.shadowDuel);
+	});
+}
+
+ShadowWrapper::DuelStatus ShadowWrapper::Process(Duel duel)
+{
+	const auto start = Clock::now();
+	const auto status = live->Process(duel);
+	if(!IsShadowed(duel))
+		return status;
+	liveElapsed += Clock::now() - start;
+	Mirror([status, call = ++processCalls](ShadowWrapper& self)
+	{
+		const auto start = Clock::now();
+		const auto shadowStatus = self.candidate->Process(self.shadowDuel);
+		self.candidateElapsed += Clock::now() - start;
+		if(shadowStatus == status)
+			return;
+		self.verdict = ShadowResult::Verdict::VERDICT_DIVERGED;
+		self.divergedAt = call;
+	});
+	return status;
+}
+
+ShadowWrapper::Buffer ShadowWrapper::GetMessages(Duel duel)
+{
+	auto buffer = live->GetMessages(duel);
+	if(!IsShadowed(duel))
+		return buffer;
+	Mirror([buffer, call = processCalls](ShadowWrapper& self)
+	{
+		if(self.candidate->GetMessages(self.shadowDuel) == buffer)
+			return;
+		self.verdict = ShadowResult::Verdict::VERDICT_DIVERGED;
+		self.divergedAt = call;
+	});
+	return buffer;
+}
+
+void ShadowWrapper::SetResponse(Duel duel, const Buffer& buffer)
+{
+	live->SetResponse(duel, buffer);
+	if(!IsShadowed(duel))
+		return;
+	Mirror([buffer](ShadowWrapper& self)
+	{
+		self.candidate->SetResponse(self.shadowDuel, buffer);
+	});
+}
+
+int ShadowWrapper::LoadScript(Duel duel, std::string_view name, std::string_view str)
+{
+	const int ret = live->LoadScript(duel, name, str);
+	if(!IsShadowed(duel))
+		return ret;
+	Mirror([name = std::string(name), str = std::string(str)](ShadowWrapper& self)
+	{
+		self.candidate->LoadScript(self.shadowDuel, name, str);
+	});
+	return ret;
+}
+
+std::size_t ShadowWrapper::QueryCount(Duel duel, uint8_t team, uint32_t loc)
+{
+	return live->QueryCount(duel, team, loc);
+}
+
+ShadowWrapper::Buffer ShadowWrapper::Query(Duel duel, const QueryInfo& info)
+{
+	return live->Query(duel, info);
+}
+
+ShadowWrapper::Buffer ShadowWrapper::QueryLocation(Duel duel, const QueryInfo& info)
+{
+	return live->QueryLocation(duel, info);
+}
+
+ShadowWrapper::Buffer ShadowWrapper::QueryField(Duel duel)
+{
+	return live->QueryField(duel);
+}
+
+// private
+
+bool ShadowWrapper::IsShadowed(Duel duel) const noexcept
+{
+	return duel == liveDuel && !liveDestroyed;
+}
+
+template<typename Func>
+void ShadowWrapper::Mirror(Func&& f)
+{
+	// NOTE: A call that is not mirrored leaves the shadow duel in a different
+	// state, so after the first one is skipped every other one is as well.
+	if(!fellBehind && pending.load(std::memory_order_relaxed) >= maxPending)
+		fellBehind = true;
+	if(fellBehind)
+	{
+		skippedCalls++;
+		Metrics::Add(Metrics::Counter::CANARY_CALLS_SKIPPED);
+		return;
+	}
+	pending.fetch_add(1U, std::memory_order_relaxed);
+	boost::asio::post(strand, [self = shared_from_this(), f = std::forward<Func>(f)]()
+	{
+		self->pending.fetch_sub(1U, std::memory_order_relaxed);
+		// NOTE: Once the cores disagree there is nothing left to compare, and
+		// once the candidate fell behind there is no point in catching up.
+		if(self->verdict != ShadowResult::Verdict::VERDICT_MATCHED || self->fellBehind)
+			return;
+		try
+		{
+			f(*self);
+		}
+		catch(Core::Exception& e)
+		{
+			self->verdict = ShadowResult::Verdict::VERDICT_CRASHED;
+			self->error = e.what();
+		}
+	});
+}
+
+} // namespace Ignis::Multirole::CoreProviderDetail
@@ -0,0 +1,115 @@
+#ifndef MULTIROLE_SERVICE_COREPROVIDER_SHADOWWRAPPER_HPP
+#define MULTIROLE_SERVICE_COREPROVIDER_SHADOWWRAPPER_HPP
+#include "../../Core/IWrapper.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include <boost/asio/strand.hpp>
+#include <boost/asio/thread_pool.hpp>
+
+namespace Ignis::Multirole::CoreProviderDetail
+{
+
+struct ShadowResult
+{
+	enum class Verdict
+	{
+		VERDICT_MATCHED,
+		VERDICT_DIVERGED,
+		VERDICT_CRASHED,
+		VERDICT_INCONCLUSIVE, // The live duel did not finish normally, or
+		                      // the candidate fell too far behind it.
+	};
+
+	Verdict verdict;
+	std::string error; // Set when verdict is VERDICT_CRASHED.
+	uint64_t processCalls; // Process calls made on the live duel.
+	uint64_t divergedAt; // Process call where the output first differed.
+	uint64_t skippedCalls; // Calls not mirrored as the candidate fell behind.
+	std::chrono::steady_clock::duration liveElapsed;
+	std::chrono::steady_clock::duration candidateElapsed;
+};
+
+// Forwards every call to the live core, while also mirroring the calls that
+// change the duel state (creation, scripts, cards, responses and processing)
+// on a candidate core asynchronously through the given strand. The status and
+// messages generated by both cores are compared after each Process call, and
+// the result is reported once the wrapper is destroyed.
+// NOTE: At most `maxPending` calls are queued for the candidate, once it
+// falls further behind the shadow duel is given up on and the rest of the
+// calls are only counted, so a slow candidate can't grow memory unbounded.
+// NOTE: Only the first duel created through the wrapper is shadowed, which
+// is fine as rooms get a new core for each duel.
+class ShadowWrapper final : public Core::IWrapper, public std::enable_shared_from_this<ShadowWrapper>
+{
+public:
+	using Executor = boost::asio::strand<boost::asio::thread_pool::executor_type>;
+	using ReportFunc = std::function<void(const ShadowResult&)>;
+
+	ShadowWrapper(
+		std::shared_ptr<Core::IWrapper> live,
+		std::shared_ptr<Core::IWrapper> candidate,
+		Executor strand,
+		std::shared_ptr<Core::IDataSupplier> dataSupplier,
+		std::size_t maxPending,
+		ReportFunc report);
+	~ShadowWrapper() noexcept;
+
+	std::pair<int, int> Version() override;
+
+	Duel CreateDuel(const DuelOptions& opts) override;
+	void DestroyDuel(Duel duel) override;
+	void AddCard(Duel duel, const NewCardInfo& info) override;
+	void Start(Duel duel) override;
+
+	DuelStatus Process(Duel duel) override;
+	Buffer GetMessages(Duel duel) override;
+	void SetResponse(Duel duel, const Buffer& buffer) override;
+	int LoadScript(Duel duel, std::string_view name, std::string_view str) override;
+
+	std::size_t QueryCount(Duel duel, uint8_t team, uint32_t loc) override;
+	Buffer Query(Duel duel, const QueryInfo& info) override;
+	Buffer QueryLocation(Duel duel, const QueryInfo& info) override;
+	Buffer QueryField(Duel duel) override;
+private:
+	using Clock = std::chrono::steady_clock;
+
+	const std::shared_ptr<Core::IWrapper> live;
+	const std::shared_ptr<Core::IWrapper> candidate;
+	Executor strand;
+	const std::shared_ptr<Core::IDataSupplier> dataSupplier;
+	const std::size_t maxPending;
+	const ReportFunc report;
+
+	// Shared between the thread using the wrapper and the strand.
+	std::atomic<std::size_t> pending{0U};
+	std::atomic<bool> fellBehind{false};
+
+	// Only accessed by the thread using the wrapper.
+	Duel liveDuel{nullptr};
+	bool liveDestroyed{false};
+	uint64_t processCalls{0U};
+	Clock::duration liveElapsed{};
+	uint64_t skippedCalls{0U};
+
+	// Only accessed from within the strand.
+	Duel shadowDuel{nullptr};
+	ShadowResult::Verdict verdict{ShadowResult::Verdict::VERDICT_MATCHED};
+	std::string error;
+	uint64_t divergedAt{0U};
+	Clock::duration candidateElapsed{};
+
+	bool IsShadowed(Duel duel) const noexcept;
+
+	template<typename Func>
+	void Mirror(Func&& f);
+};
+
+} // namespace Ignis::Multirole::CoreProviderDetail
+
+#endif // MULTIROLE_SERVICE_COREPROVIDER_SHADOWWRAPPER_HPP
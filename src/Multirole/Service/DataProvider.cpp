@@ -6,10 +6,11 @@
 #include <sqlite3.h>
 
 #include "LogHandler.hpp"
-#define LOG_INFO(...) lh.Log(ServiceType::DATA_PROVIDER, Level::INFO, __VA_ARGS__)
-#define LOG_ERROR(...) lh.Log(ServiceType::DATA_PROVIDER, Level::ERROR, __VA_ARGS__)
+#define LOG_INFO(...) MULTIROLE_LOG_SVC(lh, ServiceType::DATA_PROVIDER, Level::INFO, __VA_ARGS__)
+#define LOG_ERROR(...) MULTIROLE_LOG_SVC(lh, ServiceType::DATA_PROVIDER, Level::ERROR, __VA_ARGS__)
 #include "../I18N.hpp"
 #include "../YGOPro/CardDatabase.hpp"
+#include "../YGOPro/DeckValidator.hpp"
 
 namespace Ignis::Multirole
 {
@@ -19,7 +20,8 @@ namespace Ignis::Multirole
 Service::DataProvider::DataProvider(Service::LogHandler& lh, std::string_view fnRegexStr) :
 	lh(lh),
 	fnRegex(fnRegexStr.data()),
-	db(std::make_shared<YGOPro::CardDatabase>())
+	db(std::make_shared<YGOPro::CardDatabase>()),
+	cards(std::make_shared<const YGOPro::DeckValidator::CardTable>())
 {}
 
 std::shared_ptr<YGOPro::CardDatabase> Service::DataProvider::GetDatabase() const noexcept
@@ -28,6 +30,35 @@ std::shared_ptr<YGOPro::CardDatabase> Service::DataProvider::GetDatabase() const
 	return db;
 }
 
+CardDataSnapshot Service::DataProvider::GetSnapshot(const YGOPro::BanlistPtr& banlist)
+{
+	auto IsValid = [&](const CachedValidator& cv)
+	{
+		return banlist == nullptr || cv.banlist.lock() == banlist;
+	};
+	// NOTE: Both are read under the same lock, otherwise the databases could
+	// be reloaded in between, pairing the validator with a stale database.
+	{
+		std::shared_lock lock(mDb);
+		if(auto search = validators.find(banlist.get()); search != validators.end() && IsValid(search->second))
+			return {db, search->second.validator};
+	}
+	std::scoped_lock lock(mDb);
+	auto& cv = validators[banlist.get()];
+	if(cv.validator != nullptr && IsValid(cv))
+		return {db, cv.validator};
+	cv = {banlist, std::make_shared<const YGOPro::DeckValidator>(cards, banlist.get())};
+	// Drop validators of banlists that are no longer used.
+	for(auto it = validators.begin(); it != validators.end();)
+	{
+		if(it->first != nullptr && it->second.banlist.expired())
+			it = validators.erase(it);
+		else
+			++it;
+	}
+	return {db, cv.validator};
+}
+
 void Service::DataProvider::OnAdd(const std::filesystem::path& path, const PathVector& fileList)
 {
 	// Filter and add to set of dbs
@@ -70,8 +101,20 @@ void Service::DataProvider::ReloadDatabases() noexcept
 		if(!newDb->Merge(path.string()))
 			LOG_ERROR(I18N::DATA_PROVIDER_COULD_NOT_MERGE);
 	}
+	std::shared_ptr<const YGOPro::DeckValidator::CardTable> newCards;
+	try
+	{
+		newCards = std::make_shared<const YGOPro::DeckValidator::CardTable>(newDb->Summaries());
+	}
+	catch(const std::exception& e)
+	{
+		LOG_ERROR(I18N::DATA_PROVIDER_COULD_NOT_SUMMARIZE, e.what());
+		return;
+	}
 	std::scoped_lock lock(mDb);
 	db = newDb;
+	cards = newCards;
+	validators.clear();
 }
 
 } // namespace Ignis::Multirole
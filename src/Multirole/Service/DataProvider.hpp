@@ -2,23 +2,37 @@
 #define SERVICE_DATAPROVIDER_HPP
 #include "../Service.hpp"
 
+#include <map>
 #include <regex>
 #include <memory>
 #include <shared_mutex>
 #include <set>
+#include <vector>
 
 #include "../IGitRepoObserver.hpp"
 
 namespace YGOPro
 {
 
+class Banlist;
+using BanlistPtr = std::shared_ptr<Banlist>;
 class CardDatabase;
+struct CardSummary;
+class DeckValidator;
 
 } // namespace YGOPro
 
 namespace Ignis::Multirole
 {
 
+// The card database along with a deck validator for its cards, taken at the
+// same time so that both always come from the same set of databases.
+struct CardDataSnapshot
+{
+	std::shared_ptr<YGOPro::CardDatabase> db;
+	std::shared_ptr<const YGOPro::DeckValidator> validator;
+};
+
 class Service::DataProvider final : public IGitRepoObserver
 {
 public:
@@ -26,14 +40,28 @@ public:
 
 	std::shared_ptr<YGOPro::CardDatabase> GetDatabase() const noexcept;
 
+	// Returns the current database and its validator for the given banlist,
+	// which is only built the first time it is requested.
+	CardDataSnapshot GetSnapshot(const YGOPro::BanlistPtr& banlist);
+
 	// IGitRepoObserver overrides
 	void OnAdd(const std::filesystem::path& path, const PathVector& fileList) override;
 	void OnDiff(const std::filesystem::path& path, const GitDiff& diff) override;
 private:
+	struct CachedValidator
+	{
+		std::weak_ptr<YGOPro::Banlist> banlist;
+		std::shared_ptr<const YGOPro::DeckValidator> validator;
+	};
+
 	Service::LogHandler& lh;
 	const std::regex fnRegex;
 	std::set<std::filesystem::path> paths;
 	std::shared_ptr<YGOPro::CardDatabase> db;
+	std::shared_ptr<const std::vector<YGOPro::CardSummary>> cards;
+	// NOTE: Keyed by address, so entries are only valid while their banlist
+	// is still alive, as the address could be reused by a newer one.
+	std::map<const YGOPro::Banlist*, CachedValidator> validators;
 	mutable std::shared_mutex mDb;
 
 	void ReloadDatabases() noexcept;
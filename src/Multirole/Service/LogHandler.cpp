@@ -3,9 +3,11 @@
 #include <filesystem>
 
 #include "../I18N.hpp"
+#include "LogHandler/AsyncWriter.hpp"
 #include "LogHandler/ISink.hpp"
 #include "LogHandler/DiscordWebhookSink.hpp"
 #include "LogHandler/FileSink.hpp"
+#include "LogHandler/RoomLogSink.hpp"
 #include "LogHandler/StderrSink.hpp"
 #include "LogHandler/StdoutSink.hpp"
 
@@ -25,11 +27,7 @@ constexpr const char* AsStr(const JsonValue& jv)
 
 } // namespace
 
-Service::LogHandler::LogHandler(boost::asio::io_context& ioCtx, const boost::json::object& cfg) :
-	logRooms(cfg.at("roomLogging").at("enabled").as_bool()),
-	roomLogsDir(AsStr(cfg.at("roomLogging").at("path"))),
-	mStderr(),
-	mStdout()
+Service::LogHandler::LogHandler(boost::asio::io_context& ioCtx, const boost::json::object& cfg)
 {
 	using namespace LogHandlerDetail;
 	constexpr Str SERVICE_SINKS = "serviceSinks";
@@ -47,15 +45,22 @@ Service::LogHandler::LogHandler(boost::asio::io_context& ioCtx, const boost::jso
 				return "\nReplay ID: {0}";
 		}();
 		if(type == "discordWebhook")
-			return std::make_unique<DiscordWebhookSink>(ioCtx, AsStr(props.at("uri")), ridFormat);
+		{
+			// NOTE: Records reach the sink once `writer` is set.
+			auto OnError = [this](std::string_view str)
+			{
+				Log(ServiceType::LOG_HANDLER, Level::ERROR, str);
+			};
+			return std::make_unique<DiscordWebhookSink>(ioCtx, AsStr(props.at("uri")), ridFormat, OnError);
+		}
 		if(type == "file")
 			return std::make_unique<FileSink>(AsStr(props.at("path")));
 		if(type == "stderr")
-			return std::make_unique<StderrSink>(mStderr);
+			return std::make_unique<StderrSink>();
 		if(type == "stdout")
-			return std::make_unique<StdoutSink>(mStdout);
+			return std::make_unique<StdoutSink>();
 		if(type == "null")
-			return std::make_unique<ISink>();
+			return nullptr;
 		throw std::runtime_error("Wrong type of sink!");
 	};
 	serviceSinks =
@@ -77,12 +82,17 @@ Service::LogHandler::LogHandler(boost::asio::io_context& ioCtx, const boost::jso
 		MakeOneSink(EC_SINKS, "rush"),
 		MakeOneSink(EC_SINKS, "other"),
 	};
-	if(!logRooms)
-		return;
-	if(!exists(roomLogsDir) && !create_directory(roomLogsDir))
-		throw std::runtime_error(I18N::LOG_HANDLER_COULD_NOT_CREATE_DIR);
-	if(!is_directory(roomLogsDir))
-		throw std::runtime_error(I18N::LOG_HANDLER_PATH_IS_FILE_NOT_DIR);
+	if(const auto& roomLogging = cfg.at("roomLogging"); roomLogging.at("enabled").as_bool())
+	{
+		const std::filesystem::path roomLogsDir(AsStr(roomLogging.at("path")));
+		if(!exists(roomLogsDir) && !create_directory(roomLogsDir))
+			throw std::runtime_error(I18N::LOG_HANDLER_COULD_NOT_CREATE_DIR);
+		if(!is_directory(roomLogsDir))
+			throw std::runtime_error(I18N::LOG_HANDLER_PATH_IS_FILE_NOT_DIR);
+		roomSink = std::make_unique<RoomLogSink>(roomLogsDir,
+			roomLogging.at("segmentSize").to_number<std::size_t>());
+	}
+	writer = std::make_unique<AsyncWriter>(serviceSinks[static_cast<std::size_t>(ServiceType::LOG_HANDLER)].get());
 }
 
 Service::LogHandler::~LogHandler() = default;
@@ -90,47 +100,40 @@ Service::LogHandler::~LogHandler() = default;
 void Service::LogHandler::Log(ServiceType svc, Level lvl, std::string_view str) const noexcept
 {
 	using namespace LogHandlerDetail;
-	const auto& sink = serviceSinks[static_cast<std::size_t>(svc)];
-	sink->Log(TimestampNow(), SvcLogProps{svc, lvl}, str);
+	if(!IsLevelEnabled(lvl) || !IsEnabled(svc))
+		return;
+	auto& sink = *serviceSinks[static_cast<std::size_t>(svc)];
+	writer->Push({&sink, TimestampNow(), SvcLogProps{svc, lvl}, std::string(str)});
 }
 
 void Service::LogHandler::Log(ErrorCategory cat, uint64_t replayId, uint32_t turnCounter, std::string_view str) const noexcept
 {
 	using namespace LogHandlerDetail;
-	const auto& sink = ecSinks[static_cast<std::size_t>(cat)];
-	sink->Log(TimestampNow(), ECLogProps{cat, replayId, turnCounter}, str);
+	if(!IsLevelEnabled(Level::ERROR) || !IsEnabled(cat))
+		return;
+	auto& sink = *ecSinks[static_cast<std::size_t>(cat)];
+	writer->Push({&sink, TimestampNow(), ECLogProps{cat, replayId, turnCounter}, std::string(str)});
 }
 
 std::unique_ptr<RoomLogger> Service::LogHandler::MakeRoomLogger(uint32_t roomId) const noexcept
 {
-	if(!logRooms)
-		return nullptr;
-	try
-	{
-		const auto cnt = LogHandlerDetail::TimestampNow().time_since_epoch().count();
-		const auto fn = fmt::format("{}-{}.log", cnt, roomId);
-		return std::make_unique<RoomLogger>(roomLogsDir / fn);
-	}
-	catch(const std::exception& e)
-	{
-		Log(ServiceType::LOG_HANDLER, Level::ERROR, I18N::LOG_HANDLER_CANNOT_CREATE_ROOM_LOGGER, e.what());
+	if(!roomSink)
 		return nullptr;
-	}
+	return std::make_unique<RoomLogger>(*writer, *roomSink, roomId);
 }
 
 // RoomLogger
 
-RoomLogger::RoomLogger(const std::filesystem::path& path) :
-	f(path)
-{
-	if(!f.is_open())
-		throw std::runtime_error(I18N::ROOM_LOGGER_FILE_IS_NOT_OPEN);
-}
+RoomLogger::RoomLogger(LogHandlerDetail::AsyncWriter& writer, LogHandlerDetail::ISink& sink, uint32_t roomId) :
+	writer(writer),
+	sink(sink),
+	roomId(roomId)
+{}
 
 void RoomLogger::Log(std::string_view str) noexcept
 {
-	LogHandlerDetail::FmtTimestamp(f, LogHandlerDetail::TimestampNow());
-	f << ' ' << str << '\n';
+	using namespace LogHandlerDetail;
+	writer.Push({&sink, TimestampNow(), RoomLogProps{roomId}, std::string(str)});
 }
 
 } // namespace Ignis::Multirole
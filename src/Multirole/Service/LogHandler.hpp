@@ -3,9 +3,7 @@
 #include <array>
 #include <cstdint>
 #include <filesystem>
-#include <fstream>
 #include <memory>
-#include <mutex>
 #include <string_view>
 
 #include <boost/asio/io_context.hpp>
@@ -14,6 +12,7 @@
 
 #include "../Service.hpp"
 #include "LogHandler/Constants.hpp"
+#include "LogHandler/Filter.hpp"
 
 namespace Ignis::Multirole
 {
@@ -21,12 +20,15 @@ namespace Ignis::Multirole
 namespace LogHandlerDetail
 {
 
+class AsyncWriter;
 class ISink;
 
 } // namespace LogHandlerDetail
 
 class RoomLogger;
 
+// NOTE: Records are handed to their sinks from a background thread, so
+// logging never blocks the caller on I/O.
 class Service::LogHandler
 {
 public:
@@ -35,6 +37,18 @@ public:
 
 	std::unique_ptr<RoomLogger> MakeRoomLogger(uint32_t roomId) const noexcept;
 
+	// Whether or not records of the given service or category end up
+	// somewhere, false if its sink is of "null" type.
+	inline bool IsEnabled(ServiceType svc) const noexcept
+	{
+		return serviceSinks[static_cast<std::size_t>(svc)] != nullptr;
+	}
+
+	inline bool IsEnabled(ErrorCategory cat) const noexcept
+	{
+		return ecSinks[static_cast<std::size_t>(cat)] != nullptr;
+	}
+
 	void Log(ServiceType svc, Level lvl, std::string_view str) const noexcept;
 	void Log(ErrorCategory cat, uint64_t replayId, uint32_t turnCounter, std::string_view str) const noexcept;
 
@@ -42,19 +56,20 @@ public:
 	template<typename... Args>
 	inline void Log(ServiceType svc, Level lvl, std::string_view str, Args&& ...args) const noexcept
 	{
+		if(!IsLevelEnabled(lvl) || !IsEnabled(svc))
+			return;
 		Log(svc, lvl, fmt::format(str, std::forward<Args&&>(args)...));
 	}
 
 	template<typename... Args>
 	inline void Log(ErrorCategory cat, uint64_t replayId, uint32_t turnCounter, std::string_view str, Args&& ...args) const noexcept
 	{
+		if(!IsLevelEnabled(Level::ERROR) || !IsEnabled(cat))
+			return;
 		Log(cat, replayId, turnCounter, fmt::format(str, std::forward<Args&&>(args)...));
 	}
 private:
-	const bool logRooms;
-	const std::filesystem::path roomLogsDir;
-	std::mutex mStderr;
-	std::mutex mStdout;
+	// NOTE: Sinks of "null" type are left empty.
 	std::array<
 		std::unique_ptr<LogHandlerDetail::ISink>,
 		static_cast<std::size_t>(ServiceType::SERVICE_TYPE_COUNT)
@@ -63,12 +78,16 @@ private:
 		std::unique_ptr<LogHandlerDetail::ISink>,
 		static_cast<std::size_t>(ErrorCategory::ERROR_CATEGORY_COUNT)
 	> ecSinks;
+	std::unique_ptr<LogHandlerDetail::ISink> roomSink; // Empty if disabled.
+	// NOTE: Declared last so it is destroyed first, writing the records left
+	// while the sinks are still alive.
+	std::unique_ptr<LogHandlerDetail::AsyncWriter> writer;
 };
 
 class RoomLogger
 {
 public:
-	RoomLogger(const std::filesystem::path& path);
+	RoomLogger(LogHandlerDetail::AsyncWriter& writer, LogHandlerDetail::ISink& sink, uint32_t roomId);
 
 	void Log(std::string_view str) noexcept;
 
@@ -79,7 +98,9 @@ public:
 		Log(fmt::format(str, std::forward<Args&&>(args)...));
 	}
 private:
-	std::ofstream f;
+	LogHandlerDetail::AsyncWriter& writer;
+	LogHandlerDetail::ISink& sink;
+	const uint32_t roomId;
 };
 
 } // namespace Ignis::Multirole
@@ -0,0 +1,165 @@
+#include "AsyncWriter.hpp"
+
+#include <algorithm> // std::find
+
+#include <fmt/format.h>
+
+#include "Filter.hpp"
+#include "ISink.hpp"
+#include "../../I18N.hpp"
+
+namespace Ignis::Multirole::LogHandlerDetail
+{
+
+namespace
+{
+
+constexpr std::size_t RING_CAPACITY = 8192U; // NOTE: Must be a power of 2.
+constexpr std::size_t RING_MASK = RING_CAPACITY - 1U;
+constexpr std::size_t MAX_BATCH_SIZE = 256U;
+
+static_assert((RING_CAPACITY & RING_MASK) == 0U);
+
+} // namespace
+
+AsyncWriter::AsyncWriter(ISink* ownSink) :
+	ownSink(ownSink),
+	slots(std::make_unique<Slot[]>(RING_CAPACITY)),
+	head(0U),
+	dropped(0U),
+	running(true),
+	parked(false),
+	tail(0U)
+{
+	for(std::size_t i = 0U; i < RING_CAPACITY; i++)
+		slots[i].seq.store(i, std::memory_order_relaxed);
+	batch.reserve(MAX_BATCH_SIZE);
+	thread = std::thread(&AsyncWriter::Run, this);
+}
+
+AsyncWriter::~AsyncWriter() noexcept
+{
+	running.store(false, std::memory_order_release);
+	Wake();
+	thread.join();
+}
+
+void AsyncWriter::Push(Record&& record) noexcept
+{
+	// NOTE: Each slot's sequence tells whether it is free for the position
+	// being written (seq == pos) or still holds a record that was not taken
+	// by the writer thread yet (seq < pos), in which case the ring is full.
+	std::size_t pos = head.load(std::memory_order_relaxed);
+	for(;;)
+	{
+		Slot& slot = slots[pos & RING_MASK];
+		const std::size_t seq = slot.seq.load(std::memory_order_acquire);
+		const auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+		if(diff == 0)
+		{
+			if(head.compare_exchange_weak(pos, pos + 1U, std::memory_order_relaxed))
+			{
+				slot.record = std::move(record);
+				slot.seq.store(pos + 1U, std::memory_order_release);
+				// NOTE: Pairs with the fence in Park, so either the writer
+				// sees this record before sleeping or it is seen asleep here.
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				if(parked.load(std::memory_order_relaxed) && parked.exchange(false, std::memory_order_relaxed))
+					Wake();
+				return;
+			}
+		}
+		else if(diff < 0)
+		{
+			dropped.fetch_add(1U, std::memory_order_relaxed);
+			return;
+		}
+		else
+		{
+			pos = head.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+// private
+
+bool AsyncWriter::Ready() const noexcept
+{
+	return slots[tail & RING_MASK].seq.load(std::memory_order_acquire) == tail + 1U;
+}
+
+bool AsyncWriter::Pop(Record& record) noexcept
+{
+	if(!Ready())
+		return false;
+	Slot& slot = slots[tail & RING_MASK];
+	record = std::move(slot.record);
+	slot.seq.store(tail + RING_CAPACITY, std::memory_order_release);
+	tail++;
+	return true;
+}
+
+bool AsyncWriter::Drain() noexcept
+{
+	for(Record record; batch.size() < MAX_BATCH_SIZE && Pop(record);)
+		batch.emplace_back(std::move(record));
+	if(batch.empty())
+		return false;
+	std::vector<ISink*> touched;
+	for(const auto& r : batch)
+	{
+		r.sink->Log(r.ts, r.props, r.str);
+		if(std::find(touched.cbegin(), touched.cend(), r.sink) == touched.cend())
+			touched.emplace_back(r.sink);
+	}
+	for(auto* sink : touched)
+		sink->Flush();
+	batch.clear();
+	const auto n = dropped.exchange(0U, std::memory_order_relaxed);
+	if(n != 0U && ownSink != nullptr && IsLevelEnabled(Level::WARN))
+	{
+		const SvcLogProps props{ServiceType::LOG_HANDLER, Level::WARN};
+		ownSink->Log(TimestampNow(), props, fmt::format(I18N::LOG_HANDLER_RECORDS_DROPPED, n));
+		ownSink->Flush();
+	}
+	return true;
+}
+
+void AsyncWriter::Park() noexcept
+{
+	std::unique_lock lock(mPark);
+	parked.store(true, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	// NOTE: Records pushed before the flag was visible are caught here, the
+	// ones pushed after it wake this thread up.
+	if(!Ready())
+	{
+		cvPark.wait(lock, [this]()
+		{
+			return !parked.load(std::memory_order_relaxed) ||
+				!running.load(std::memory_order_acquire);
+		});
+	}
+	parked.store(false, std::memory_order_relaxed);
+}
+
+void AsyncWriter::Wake() noexcept
+{
+	// NOTE: Taking the lock makes sure the writer thread is either already
+	// waiting or has yet to check whether it should.
+	{
+		std::scoped_lock lock(mPark);
+	}
+	cvPark.notify_one();
+}
+
+void AsyncWriter::Run() noexcept
+{
+	while(running.load(std::memory_order_acquire))
+		if(!Drain())
+			Park();
+	// Write whatever was pushed before stopping.
+	while(Drain());
+}
+
+} // namespace Ignis::Multirole::LogHandlerDetail
@@ -0,0 +1,71 @@
+#ifndef MULTIROLE_SERVICE_LOGHANDLER_ASYNCWRITER_HPP
+#define MULTIROLE_SERVICE_LOGHANDLER_ASYNCWRITER_HPP
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SinkArgs.hpp"
+#include "Timestamp.hpp"
+
+namespace Ignis::Multirole::LogHandlerDetail
+{
+
+class ISink;
+
+struct Record
+{
+	ISink* sink;
+	Timestamp ts;
+	SinkLogProps props;
+	std::string str;
+};
+
+// Takes log records from any thread through a bounded lock-free ring and
+// hands them to their sinks from a single background thread, in batches,
+// flushing each sink once per batch. Producers never block: if the ring is
+// full the record is dropped and the amount of dropped records is reported
+// through the given sink (if any) once there is room again. While the ring
+// is empty the background thread sleeps until a record is pushed.
+class AsyncWriter final
+{
+public:
+	AsyncWriter(ISink* ownSink);
+	~AsyncWriter() noexcept;
+
+	void Push(Record&& record) noexcept;
+private:
+	struct Slot
+	{
+		std::atomic<std::size_t> seq;
+		Record record;
+	};
+
+	ISink* const ownSink;
+	const std::unique_ptr<Slot[]> slots;
+	alignas(64) std::atomic<std::size_t> head;
+	alignas(64) std::atomic<std::size_t> dropped;
+	std::atomic<bool> running;
+	std::atomic<bool> parked; // Set while the writer thread waits for records.
+	std::mutex mPark;
+	std::condition_variable cvPark;
+	// Only accessed by the writer thread.
+	std::size_t tail;
+	std::vector<Record> batch;
+	std::thread thread;
+
+	bool Ready() const noexcept;
+	bool Pop(Record& record) noexcept;
+	void Park() noexcept;
+	void Wake() noexcept;
+	bool Drain() noexcept;
+	void Run() noexcept;
+};
+
+} // namespace Ignis::Multirole::LogHandlerDetail
+
+#endif // MULTIROLE_SERVICE_LOGHANDLER_ASYNCWRITER_HPP
@@ -1,5 +1,14 @@
 #include "DiscordWebhookSink.hpp"
 
+#include <algorithm> // std::equal, std::find_if, std::min_element
+#include <cctype> // std::tolower
+#include <chrono>
+#include <cstdlib> // std::strtod
+#include <deque>
+#include <map>
+#include <optional>
+#include <utility> // std::exchange
+
 #include <boost/json.hpp>
 #include <fmt/format.h>
 
@@ -8,53 +17,365 @@
 namespace Ignis::Multirole::LogHandlerDetail
 {
 
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::size_t MAX_EMBEDS_PER_REQUEST = 10U;
+constexpr std::size_t MAX_CHARS_PER_REQUEST = 6000U;
+constexpr auto DEDUP_WINDOW = std::chrono::seconds(60);
+constexpr auto FAILURE_BACKOFF = std::chrono::seconds(5);
+constexpr auto TICK_INTERVAL = std::chrono::seconds(1);
+// NOTE: Past these, the oldest queued records are dropped and the records
+// sent the longest ago stop being deduplicated, so a webhook that can't keep
+// up doesn't make memory grow without bounds.
+constexpr std::size_t MAX_QUEUED_EMBEDS = 500U;
+constexpr std::size_t MAX_RECENT_EMBEDS = 500U;
+
+constexpr const char* const HTTP_HEADER_FORMAT_STRING =
+"POST {:s} HTTP/1.1\r\n"
+"Host: {:s}\r\n"
+"User-Agent: DyXel-Multirole/1.0\r\n"
+"Connection: keep-alive\r\n"
+"Content-Length: {:d}\r\n"
+"Content-Type: application/json\r\n\r\n";
+
+// Returns the value of the given header field, if present.
+std::optional<std::string_view> FindHeader(std::string_view headers, std::string_view name) noexcept
+{
+	auto IEquals = [](std::string_view a, std::string_view b) -> bool
+	{
+		return a.size() == b.size() && std::equal(a.cbegin(), a.cend(), b.cbegin(), [](char c1, char c2)
+		{
+			return std::tolower(static_cast<unsigned char>(c1)) == std::tolower(static_cast<unsigned char>(c2));
+		});
+	};
+	for(std::size_t pos = headers.find("\r\n"); pos != std::string_view::npos;)
+	{
+		const auto begin = pos + 2U;
+		const auto end = headers.find("\r\n", begin);
+		const auto line = headers.substr(begin, end - begin);
+		pos = end;
+		const auto colon = line.find(':');
+		if(colon == std::string_view::npos || !IEquals(line.substr(0U, colon), name))
+			continue;
+		auto value = line.substr(colon + 1U);
+		value.remove_prefix(std::min(value.find_first_not_of(' '), value.size()));
+		return value;
+	}
+	return std::nullopt;
+}
+
+// Seconds given on a header field, which might have a fractional part.
+std::optional<Clock::duration> HeaderSeconds(std::string_view headers, std::string_view name) noexcept
+{
+	const auto value = FindHeader(headers, name);
+	if(!value)
+		return std::nullopt;
+	const double secs = std::strtod(std::string(*value).data(), nullptr);
+	if(secs <= 0.0)
+		return std::nullopt;
+	return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(secs));
+}
+
+// Characters counted by Discord towards the limit for all embeds of a message.
+std::size_t EmbedChars(const boost::json::object& obj) noexcept
+{
+	std::size_t chars = 0U;
+	if(const auto* s = obj.if_contains("title"); s != nullptr)
+		chars += s->as_string().size();
+	if(const auto* s = obj.if_contains("description"); s != nullptr)
+		chars += s->as_string().size();
+	if(const auto* f = obj.if_contains("footer"); f != nullptr)
+		chars += f->as_object().at("text").as_string().size();
+	return chars;
+}
+
+} // namespace
+
 class DiscordWebhookSink::Connection final : public std::enable_shared_from_this<Connection>
 {
 public:
-	using Endpoints = boost::asio::ip::tcp::resolver::results_type;
-
-	Connection(
-		boost::asio::io_context& ioCtx,
-		boost::asio::ssl::context& sslCtx,
-		const Endpoints& endpoints,
-		std::string payload,
-		const std::string& host)
-		:
-		socket(ioCtx, sslCtx),
-		endpoints(endpoints),
-		payload(std::move(payload))
+	Connection(boost::asio::io_context& ioCtx, std::string_view uri, ErrorHandler onError) :
+		onError(std::move(onError)),
+		strand(boost::asio::make_strand(ioCtx)),
+		sslCtx(boost::asio::ssl::context::sslv23),
+		timer(strand)
 	{
-		using namespace boost::asio::ssl;
-		socket.set_verify_mode(verify_peer);
-		socket.set_verify_callback(host_name_verification(host));
+		sslCtx.set_default_verify_paths();
+		const auto scpos = uri.find(':'); // scheme colon position
+		if(scpos == std::string_view::npos)
+			throw std::invalid_argument(I18N::DWH_URI_COLON_NOT_FOUND);
+		const auto tspos = scpos + 1U + std::string_view::traits_type::length("//"); // two slashes position
+		if(tspos > uri.length())
+			throw std::invalid_argument(I18N::DWH_URI_TOO_SHORT);
+		const auto pspos = uri.find('/', tspos); // path slash position
+		if(pspos == std::string_view::npos)
+			throw std::invalid_argument(I18N::DWH_URI_NO_PATH);
+		scheme = std::string(uri.substr(0U, scpos));
+		host   = std::string(uri.substr(tspos, pspos - tspos));
+		path   = std::string(uri.substr(pspos));
+		endpoints = boost::asio::ip::tcp::resolver(ioCtx).resolve(host, scheme);
+		if(endpoints.empty())
+			throw std::runtime_error(I18N::DWH_ERROR_RESOLVING_HOST);
+	}
+
+	void Enqueue(std::vector<Embed>&& embeds) noexcept
+	{
+		auto self(shared_from_this());
+		boost::asio::post(strand, [this, self, embeds = std::move(embeds)]() mutable
+		{
+			Prune(Clock::now());
+			for(auto& e : embeds)
+			{
+				if(auto it = FindQueued(e.key); it != queue.end())
+				{
+					it->count += e.count;
+					continue;
+				}
+				if(auto i = FindInFlight(e.key); i < inFlight.size())
+				{
+					inFlightRepeats[i] += e.count;
+					continue;
+				}
+				if(auto it = recent.find(e.key); it != recent.end())
+				{
+					it->second.repeats += e.count;
+					continue;
+				}
+				queue.emplace_back(std::move(e));
+			}
+			Trim();
+			Kick();
+		});
+	}
+private:
+	using Socket = boost::asio::ssl::stream<boost::asio::ip::tcp::socket>;
+
+	// Records sent not long ago, further identical records are only counted
+	// and sent once the window closes.
+	struct Recent
+	{
+		Clock::time_point until;
+		uint32_t repeats;
+		boost::json::object obj;
+	};
+
+	const ErrorHandler onError;
+	boost::asio::strand<boost::asio::io_context::executor_type> strand;
+	boost::asio::ssl::context sslCtx;
+	boost::asio::steady_timer timer;
+	std::string scheme;
+	std::string host;
+	std::string path;
+	boost::asio::ip::tcp::resolver::results_type endpoints;
+
+	// Only accessed from within the strand.
+	std::deque<Embed> queue;
+	std::map<std::string, Recent> recent;
+	std::vector<Embed> inFlight;
+	// Identical records counted while each one in flight was being sent.
+	std::vector<uint32_t> inFlightRepeats;
+	uint64_t dropped{0U}; // Records dropped since the last notice was sent.
+	uint64_t droppedInFlight{0U};
+	std::optional<Socket> socket;
+	std::string request;
+	std::string response;
+	Clock::time_point retryAt;
+	bool busy{false};
+	bool ticking{false};
+	bool reused{false};
+
+	std::deque<Embed>::iterator FindQueued(const std::string& key) noexcept
+	{
+		return std::find_if(queue.begin(), queue.end(), [&](const Embed& e)
+		{
+			return e.key == key;
+		});
+	}
+
+	std::size_t FindInFlight(const std::string& key) const noexcept
+	{
+		std::size_t i = 0U;
+		while(i < inFlight.size() && inFlight[i].key != key)
+			i++;
+		return i;
+	}
+
+	// Stops deduplicating the record, queueing it again if it was repeated.
+	std::map<std::string, Recent>::iterator Expire(std::map<std::string, Recent>::iterator it) noexcept
+	{
+		if(it->second.repeats != 0U)
+			queue.push_back({it->first, std::move(it->second.obj), it->second.repeats});
+		return recent.erase(it);
+	}
+
+	void Prune(Clock::time_point now) noexcept
+	{
+		for(auto it = recent.begin(); it != recent.end();)
+		{
+			if(now < it->second.until)
+				++it;
+			else
+				it = Expire(it);
+		}
+		while(recent.size() > MAX_RECENT_EMBEDS)
+		{
+			Expire(std::min_element(recent.begin(), recent.end(), [](const auto& a, const auto& b)
+			{
+				return a.second.until < b.second.until;
+			}));
+		}
+		Trim();
+	}
+
+	void Trim() noexcept
+	{
+		while(queue.size() > MAX_QUEUED_EMBEDS)
+		{
+			dropped += queue.front().count;
+			queue.pop_front();
+		}
+	}
+
+	// Puts the records in flight back in front of the queue, along with the
+	// repeats counted for them in the meantime.
+	void Requeue() noexcept
+	{
+		for(std::size_t i = inFlight.size(); i-- != 0U;)
+		{
+			inFlight[i].count += inFlightRepeats[i];
+			queue.emplace_front(std::move(inFlight[i]));
+		}
+		inFlight.clear();
+		inFlightRepeats.clear();
+		dropped += std::exchange(droppedInFlight, 0U);
+		Trim();
+	}
+
+	// Remembers the records in flight as delivered, holding back identical
+	// ones for a while.
+	void Delivered(Clock::time_point now) noexcept
+	{
+		for(std::size_t i = 0U; i < inFlight.size(); i++)
+			recent.insert_or_assign(inFlight[i].key, Recent{now + DEDUP_WINDOW, inFlightRepeats[i], std::move(inFlight[i].obj)});
+		inFlight.clear();
+		inFlightRepeats.clear();
+		droppedInFlight = 0U;
+	}
+
+	// Forgets the records in flight, returning how many were given up on.
+	uint64_t Discard() noexcept
+	{
+		uint64_t count = std::exchange(droppedInFlight, 0U);
+		for(std::size_t i = 0U; i < inFlight.size(); i++)
+			count += inFlight[i].count + inFlightRepeats[i];
+		inFlight.clear();
+		inFlightRepeats.clear();
+		return count;
+	}
+
+	void Kick() noexcept
+	{
+		const auto now = Clock::now();
+		Prune(now);
+		if(!busy && !queue.empty() && now >= retryAt)
+			Send();
+		if(ticking || (queue.empty() && recent.empty()))
+			return;
+		ticking = true;
+		timer.expires_after(TICK_INTERVAL);
+		timer.async_wait([this, self = shared_from_this()](boost::system::error_code ec)
+		{
+			ticking = false;
+			if(!ec)
+				Kick();
+		});
+	}
+
+	void Send() noexcept
+	{
+		// NOTE: Dropped records are reported first, on an embed of their own.
+		boost::json::object droppedObj;
+		if(dropped != 0U)
+		{
+			droppedObj.emplace("title", I18N::DWH_SERVICE_MESSAGE_TITLE);
+			droppedObj.emplace("description", fmt::format(I18N::DWH_RECORDS_DROPPED, dropped));
+			droppedObj.emplace("color", 0xFFFF00U);
+		}
+		droppedInFlight = std::exchange(dropped, 0U);
+		const std::size_t reserved = (droppedInFlight != 0U) ? 1U : 0U;
+		std::size_t chars = EmbedChars(droppedObj);
+		while(!queue.empty() && reserved + inFlight.size() < MAX_EMBEDS_PER_REQUEST)
+		{
+			const auto c = EmbedChars(queue.front().obj);
+			if(reserved + inFlight.size() != 0U && chars + c > MAX_CHARS_PER_REQUEST)
+				break;
+			chars += c;
+			inFlight.emplace_back(std::move(queue.front()));
+			queue.pop_front();
+		}
+		boost::json::object j;
+		auto& embeds = j.emplace("embeds", boost::json::array()).first->value().as_array();
+		if(reserved != 0U)
+			embeds.emplace_back(std::move(droppedObj));
+		for(const auto& e : inFlight)
+		{
+			auto& obj = embeds.emplace_back(e.obj).as_object();
+			if(e.count > 1U)
+			{
+				const auto text = fmt::format(I18N::DWH_OCCURRENCES, e.count);
+				if(auto* f = obj.if_contains("footer"); f != nullptr)
+				{
+					auto& footerText = f->as_object()["text"].as_string();
+					footerText.append(" | ");
+					footerText.append(text);
+				}
+				else
+				{
+					auto& footer = *obj.emplace("footer", boost::json::object(1U)).first->value().if_object();
+					footer.emplace("text", text);
+				}
+			}
+		}
+		inFlightRepeats.assign(inFlight.size(), 0U);
+		const auto strJ = boost::json::serialize(j); // DUMP EET
+		request = fmt::format(HTTP_HEADER_FORMAT_STRING, path, host, strJ.size());
+		request += strJ;
+		busy = true;
+		reused = socket.has_value();
+		if(reused)
+			DoWrite();
+		else
+			DoConnect();
 	}
 
 	void DoConnect() noexcept
 	{
-		using Endpoint = Endpoints::endpoint_type;
+		using namespace boost::asio::ssl;
+		using Endpoint = boost::asio::ip::tcp::endpoint;
+		socket.emplace(strand, sslCtx);
+		socket->set_verify_mode(verify_peer);
+		socket->set_verify_callback(host_name_verification(host));
 		auto self(shared_from_this());
-		boost::asio::async_connect(socket.lowest_layer(), endpoints,
+		boost::asio::async_connect(socket->lowest_layer(), endpoints,
 		[this, self](boost::system::error_code ec, const Endpoint& /*unused*/)
 		{
 			if(ec)
-				return;
+				return OnFailure();
 			DoHandshake();
 		});
 	}
-private:
-	boost::asio::ssl::stream<boost::asio::ip::tcp::socket> socket;
-	const Endpoints& endpoints;
-	const std::string payload;
-	std::string read_buffer;
 
 	void DoHandshake() noexcept
 	{
 		auto self(shared_from_this());
-		socket.async_handshake(decltype(socket)::client,
+		socket->async_handshake(Socket::client,
 		[this, self](boost::system::error_code ec)
 		{
 			if(ec)
-				return;
+				return OnFailure();
 			DoWrite();
 		});
 	}
@@ -62,58 +383,121 @@ private:
 	void DoWrite() noexcept
 	{
 		auto self(shared_from_this());
-		boost::asio::async_write(socket, boost::asio::buffer(payload),
+		boost::asio::async_write(*socket, boost::asio::buffer(request),
 		[this, self](boost::system::error_code ec, std::size_t /*unused*/)
 		{
 			if(ec)
-				return;
-			DoRead();
+				return OnFailure();
+			DoReadHeaders();
 		});
 	}
 
-	void DoRead() noexcept
+	void DoReadHeaders() noexcept
 	{
+		response.clear();
 		auto self(shared_from_this());
-		boost::asio::async_read_until(socket, boost::asio::dynamic_buffer(read_buffer), "\r\n\r\n",
-		[this, self](boost::system::error_code ec, std::size_t /*unused*/)
+		boost::asio::async_read_until(*socket, boost::asio::dynamic_buffer(response), "\r\n\r\n",
+		[this, self](boost::system::error_code ec, std::size_t headersSize)
 		{
 			if(ec)
+				return OnFailure();
+			const std::string_view headers(response.data(), headersSize);
+			// NOTE: "HTTP/1.1 XXX ..."
+			const int status = (headers.size() > 12U) ? std::atoi(response.data() + 9U) : 0;
+			auto wait = HeaderSeconds(headers, "Retry-After");
+			if(!wait && FindHeader(headers, "X-RateLimit-Remaining") == std::string_view("0"))
+				wait = HeaderSeconds(headers, "X-RateLimit-Reset-After");
+			const bool close = FindHeader(headers, "Connection") == std::string_view("close");
+			// The body is not used, but must be read for the connection to be
+			// reused.
+			auto Done = [this, self, status, wait, close](boost::system::error_code ec, std::size_t /*unused*/)
+			{
+				if(ec)
+					return OnFailure();
+				OnResponse(status, wait, close);
+			};
+			if(FindHeader(headers, "Transfer-Encoding") == std::string_view("chunked"))
+			{
+				response.erase(0U, headersSize);
+				boost::asio::async_read_until(*socket, boost::asio::dynamic_buffer(response), "0\r\n\r\n", Done);
 				return;
-			DoShutdown();
+			}
+			const auto length = FindHeader(headers, "Content-Length");
+			const auto total = length ? std::strtoull(std::string(*length).data(), nullptr, 10) : 0U;
+			const auto buffered = response.size() - headersSize;
+			if(total <= buffered)
+				return Done({}, 0U);
+			boost::asio::async_read(*socket, boost::asio::dynamic_buffer(response),
+				boost::asio::transfer_exactly(total - buffered), Done);
 		});
 	}
 
-	void DoShutdown() noexcept
+	void OnResponse(int status, std::optional<Clock::duration> wait, bool close) noexcept
 	{
-		auto self(shared_from_this());
-		socket.async_shutdown([this, self](boost::system::error_code ec){
-			socket.lowest_layer().shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
-		});
+		const auto now = Clock::now();
+		if(wait)
+			retryAt = now + *wait;
+		if(status >= 200 && status < 300)
+		{
+			Delivered(now);
+		}
+		else if(status == 429 || status >= 500)
+		{
+			// NOTE: Rate limited requests and server errors are sent again
+			// once allowed, or after backing off.
+			if(status != 429)
+				onError(fmt::format(I18N::DWH_REQUEST_RETRIED, status));
+			Requeue();
+			if(!wait)
+				retryAt = now + FAILURE_BACKOFF;
+		}
+		else
+		{
+			// NOTE: Anything else would be rejected again as it is, so the
+			// records are given up on. Backing off keeps a webhook that no
+			// longer exists from being hammered.
+			onError(fmt::format(I18N::DWH_REQUEST_REJECTED, status, Discard()));
+			if(!wait)
+				retryAt = now + FAILURE_BACKOFF;
+		}
+		busy = false;
+		if(close)
+			Close();
+		Kick();
+	}
+
+	void OnFailure() noexcept
+	{
+		Close();
+		// NOTE: Idle connections might have been closed by the other end in
+		// the meantime, so a new one is tried right away once.
+		if(reused)
+		{
+			reused = false;
+			return DoConnect();
+		}
+		// NOTE: Sent again after backing off, otherwise identical records
+		// would keep being held back as if these had been delivered.
+		Requeue();
+		busy = false;
+		retryAt = Clock::now() + FAILURE_BACKOFF;
+		Kick();
+	}
+
+	void Close() noexcept
+	{
+		if(!socket)
+			return;
+		boost::system::error_code ignored;
+		socket->lowest_layer().close(ignored);
+		socket.reset();
 	}
 };
 
-DiscordWebhookSink::DiscordWebhookSink(boost::asio::io_context& ioCtx, std::string_view uri, std::string_view ridFormat) :
-	ioCtx(ioCtx),
-	sslCtx(boost::asio::ssl::context::sslv23),
-	ridFormat(ridFormat)
-{
-	sslCtx.set_default_verify_paths();
-	const auto scpos = uri.find(':'); // scheme colon position
-	if(scpos == std::string_view::npos)
-		throw std::invalid_argument(I18N::DWH_URI_COLON_NOT_FOUND);
-	const auto tspos = scpos + 1U + std::string_view::traits_type::length("//"); // two slashes position
-	if(tspos > uri.length())
-		throw std::invalid_argument(I18N::DWH_URI_TOO_SHORT);
-	const auto pspos = uri.find('/', tspos); // path slash position
-	if(pspos == std::string_view::npos)
-		throw std::invalid_argument(I18N::DWH_URI_NO_PATH);
-	scheme = std::string(uri.substr(0U, scpos));
-	host   = std::string(uri.substr(tspos, pspos - tspos));
-	path   = std::string(uri.substr(pspos));
-	endpoints = boost::asio::ip::tcp::resolver(ioCtx).resolve(host, scheme);
-	if(endpoints.empty())
-		throw std::runtime_error(I18N::DWH_ERROR_RESOLVING_HOST);
-}
+DiscordWebhookSink::DiscordWebhookSink(boost::asio::io_context& ioCtx, std::string_view uri, std::string_view ridFormat, ErrorHandler onError) :
+	ridFormat(ridFormat),
+	conn(std::make_shared<Connection>(ioCtx, uri, std::move(onError)))
+{}
 
 DiscordWebhookSink::~DiscordWebhookSink() noexcept = default;
 
@@ -147,31 +531,26 @@ constexpr std::size_t AsSizeT(T v)
 	return static_cast<std::size_t>(v);
 }
 
-constexpr const char* const HTTP_HEADER_FORMAT_STRING =
-"POST {:s} HTTP/1.1\r\n"
-"Host: {:s}\r\n"
-"User-Agent: DyXel-Multirole/1.0\r\n"
-"Content-Length: {:d}\r\n"
-"Content-Type: application/json\r\n\r\n";
-
 void DiscordWebhookSink::Log(const Timestamp& /*ts*/, const SinkLogProps& props, std::string_view str) noexcept
 {
-	boost::json::monotonic_resource mr;
-	boost::json::object j(&mr);
-	auto& embeds = *j.emplace("embeds", boost::json::array(&mr)).first->value().if_array();
-	auto& embed = *embeds.emplace_back(boost::json::object(4U, &mr)).if_object();
+	Embed e{{}, boost::json::object(4U), 1U};
+	auto& embed = e.obj;
 	if(std::holds_alternative<SvcLogProps>(props))
 	{
 		const auto& svcLogProps = std::get<0>(props);
+		e.key = fmt::format("S{}{} {}", AsSizeT(svcLogProps.first), AsSizeT(svcLogProps.second), str);
 		embed.emplace("title", I18N::DWH_SERVICE_MESSAGE_TITLE);
 		embed.emplace("description", str);
 		embed.emplace("color", LEVEL_COLORS[AsSizeT(svcLogProps.second)]);
-		auto& footer = *embed.emplace("footer", boost::json::object(1U, &mr)).first->value().if_object();
+		auto& footer = *embed.emplace("footer", boost::json::object(1U)).first->value().if_object();
 		footer.emplace("text", SVC_NAMES[AsSizeT(svcLogProps.first)]);
 	}
 	else // std::holds_alternative<ECLogProps>(props)
 	{
 		const auto& ecLogProps = std::get<1>(props);
+		// NOTE: The same error is likely to happen on different duels, so
+		// where it happened is not taken into account to tell them apart.
+		e.key = fmt::format("E{} {}", AsSizeT(std::get<0>(ecLogProps)), str);
 		embed.emplace("title", EC_TITLES[AsSizeT(std::get<0>(ecLogProps))]);
 		embed.emplace("color", 0xFF0000U);
 		auto& desc = *embed.emplace("description", "```\n").first->value().if_string();
@@ -187,15 +566,15 @@ void DiscordWebhookSink::Log(const Timestamp& /*ts*/, const SinkLogProps& props,
 			desc.append(I18N::DWH_RIDFORMAT_ERROR);
 		}
 	}
-	const auto strJ = boost::json::serialize(j); // DUMP EET
-	auto payload = fmt::format(HTTP_HEADER_FORMAT_STRING, path, host, strJ.size());
-	payload += strJ;
-	std::make_shared<Connection>(
-		ioCtx,
-		sslCtx,
-		endpoints,
-		std::move(payload),
-		host)->DoConnect();
+	batch.emplace_back(std::move(e));
+}
+
+void DiscordWebhookSink::Flush() noexcept
+{
+	if(batch.empty())
+		return;
+	conn->Enqueue(std::move(batch));
+	batch.clear();
 }
 
 } // namespace Ignis::Multirole::LogHandlerDetail
@@ -2,30 +2,48 @@
 #define MULTIROLE_SERVICE_LOGHANDLER_DISCORDWEBHOOKSINK_HPP
 #include "ISink.hpp"
 
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include <boost/asio.hpp>
 #include <boost/asio/ssl.hpp>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/json/object.hpp>
 
 namespace Ignis::Multirole::LogHandlerDetail
 {
 
+// Delivers records as embeds through a single keep-alive connection. Records
+// of a batch are queued together, up to 10 queued embeds are sent on each
+// request, identical records are counted instead of being sent again for a
+// while and rate limits reported by Discord are waited out. Requests Discord
+// does not accept are reported through `onError`, which is called from the
+// threads running the io_context.
 class DiscordWebhookSink final : public ISink
 {
 public:
-	DiscordWebhookSink(boost::asio::io_context& ioCtx, std::string_view uri, std::string_view ridFormat);
+	using ErrorHandler = std::function<void(std::string_view)>;
+
+	DiscordWebhookSink(boost::asio::io_context& ioCtx, std::string_view uri, std::string_view ridFormat, ErrorHandler onError);
 	~DiscordWebhookSink() noexcept;
 
 	void Log(const Timestamp& ts, const SinkLogProps& props, std::string_view str) noexcept override;
+	void Flush() noexcept override;
 private:
 	class Connection;
 
-	boost::asio::io_context& ioCtx;
-	boost::asio::ssl::context sslCtx;
+	struct Embed
+	{
+		std::string key; // Identifies repeated records.
+		boost::json::object obj;
+		uint32_t count;
+	};
+
 	const std::string ridFormat;
-	std::string scheme;
-	std::string host;
-	std::string path;
-	boost::asio::ip::tcp::resolver::results_type endpoints;
+	std::shared_ptr<Connection> conn;
+	std::vector<Embed> batch;
 };
 
 } // namespace Ignis::Multirole::LogHandlerDetail
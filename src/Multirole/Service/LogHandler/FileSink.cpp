@@ -1,7 +1,5 @@
 #include "FileSink.hpp"
 
-#include <iostream>
-
 #include "StreamFormat.hpp"
 
 namespace Ignis::Multirole::LogHandlerDetail
@@ -15,7 +13,13 @@ FileSink::~FileSink() noexcept = default;
 
 void FileSink::Log(const Timestamp& ts, const SinkLogProps& props, std::string_view str) noexcept
 {
-	StreamFormat(f, ts, props, str);
+	StreamFormat(buf, ts, props, str);
+}
+
+void FileSink::Flush() noexcept
+{
+	f.write(buf.data(), static_cast<std::streamsize>(buf.size())).flush();
+	buf.clear();
 }
 
 } // namespace Ignis::Multirole::LogHandlerDetail
@@ -5,6 +5,8 @@
 #include <filesystem>
 #include <fstream>
 
+#include <fmt/format.h>
+
 namespace Ignis::Multirole::LogHandlerDetail
 {
 
@@ -14,8 +16,10 @@ public:
 	FileSink(const std::filesystem::path& p);
 	~FileSink() noexcept;
 	void Log(const Timestamp& ts, const SinkLogProps& props, std::string_view str) noexcept override;
+	void Flush() noexcept override;
 private:
 	std::ofstream f;
+	fmt::memory_buffer buf;
 };
 
 } // namespace Ignis::Multirole::LogHandlerDetail
@@ -0,0 +1,39 @@
+#ifndef MULTIROLE_SERVICE_LOGHANDLER_FILTER_HPP
+#define MULTIROLE_SERVICE_LOGHANDLER_FILTER_HPP
+#include "Constants.hpp"
+
+// Set through the `min_log_level` build option, 0 (info) by default.
+#ifndef MULTIROLE_MIN_LOG_LEVEL
+#define MULTIROLE_MIN_LOG_LEVEL 0
+#endif // MULTIROLE_MIN_LOG_LEVEL
+
+namespace Ignis::Multirole
+{
+
+// Records below this level are discarded at compile time. Records of an
+// error category count as errors. Level::LEVEL_COUNT discards everything.
+constexpr Level MIN_LOG_LEVEL = static_cast<Level>(MULTIROLE_MIN_LOG_LEVEL);
+
+constexpr bool IsLevelEnabled(Level lvl) noexcept
+{
+	return lvl >= MIN_LOG_LEVEL;
+}
+
+} // namespace Ignis::Multirole
+
+// Used to define the logging macros of each file. Arguments are only evaluated
+// if the record would be written, that is, if its level is enabled and its
+// service or category does not use a "null" sink.
+#define MULTIROLE_LOG_SVC(lh, svc, lvl, ...) \
+	do { \
+		if(::Ignis::Multirole::IsLevelEnabled(lvl) && (lh).IsEnabled(svc)) \
+			(lh).Log(svc, lvl, __VA_ARGS__); \
+	} while(0)
+
+#define MULTIROLE_LOG_EC(lh, cat, replayId, turnCounter, ...) \
+	do { \
+		if(::Ignis::Multirole::IsLevelEnabled(::Ignis::Multirole::Level::ERROR) && (lh).IsEnabled(cat)) \
+			(lh).Log(cat, replayId, turnCounter, __VA_ARGS__); \
+	} while(0)
+
+#endif // MULTIROLE_SERVICE_LOGHANDLER_FILTER_HPP
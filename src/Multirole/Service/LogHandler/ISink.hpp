@@ -13,6 +13,9 @@ public:
 	                 [[maybe_unused]] const SinkLogProps& props,
 	                 [[maybe_unused]] std::string_view str) noexcept
 	{};
+	// Called after a batch of records was given to the sink.
+	virtual void Flush() noexcept
+	{};
 	virtual ~ISink() noexcept = default;
 };
 
@@ -0,0 +1,80 @@
+#ifndef MULTIROLE_SERVICE_LOGHANDLER_ROOMLOGFORMAT_HPP
+#define MULTIROLE_SERVICE_LOGHANDLER_ROOMLOGFORMAT_HPP
+#include <array>
+#include <cstdint>
+#include <cstring> // std::memcpy
+#include <string_view>
+
+#include <fmt/format.h>
+
+namespace Ignis::Multirole::LogHandlerDetail
+{
+
+// Room logs are written to segment files shared by all rooms. Each segment
+// starts with ROOM_LOG_MAGIC and ROOM_LOG_VERSION, followed by records:
+//   uint64_t timestamp (milliseconds since epoch)
+//   uint32_t roomId
+//   uint32_t length
+//   char text[length]
+// NOTE: Integers are written in host byte order, same as replays.
+constexpr std::array<char, 4U> ROOM_LOG_MAGIC = {'M', 'R', 'L', 'G'};
+constexpr uint8_t ROOM_LOG_VERSION = 1U;
+constexpr std::size_t ROOM_LOG_SEGMENT_HEADER_SIZE = ROOM_LOG_MAGIC.size() + sizeof(ROOM_LOG_VERSION);
+constexpr std::size_t ROOM_LOG_RECORD_HEADER_SIZE = sizeof(uint64_t) + sizeof(uint32_t) * 2U;
+constexpr const char* const ROOM_LOG_EXTENSION = ".mrl";
+
+struct RoomLogRecord
+{
+	uint64_t timestamp;
+	uint32_t roomId;
+	std::string_view text;
+};
+
+inline void WriteRoomLogSegmentHeader(fmt::memory_buffer& out) noexcept
+{
+	out.append(ROOM_LOG_MAGIC.data(), ROOM_LOG_MAGIC.data() + ROOM_LOG_MAGIC.size());
+	out.push_back(static_cast<char>(ROOM_LOG_VERSION));
+}
+
+inline void WriteRoomLogRecord(fmt::memory_buffer& out, const RoomLogRecord& record) noexcept
+{
+	std::array<char, ROOM_LOG_RECORD_HEADER_SIZE> header{};
+	const auto length = static_cast<uint32_t>(record.text.size());
+	std::memcpy(header.data(), &record.timestamp, sizeof(uint64_t));
+	std::memcpy(header.data() + sizeof(uint64_t), &record.roomId, sizeof(uint32_t));
+	std::memcpy(header.data() + sizeof(uint64_t) + sizeof(uint32_t), &length, sizeof(uint32_t));
+	out.append(header.data(), header.data() + header.size());
+	out.append(record.text.data(), record.text.data() + record.text.size());
+}
+
+// Checks that the data starts with a segment header and skips it.
+inline bool ReadRoomLogSegmentHeader(std::string_view& data) noexcept
+{
+	if(data.size() < ROOM_LOG_SEGMENT_HEADER_SIZE ||
+	   data.substr(0U, ROOM_LOG_MAGIC.size()) != std::string_view(ROOM_LOG_MAGIC.data(), ROOM_LOG_MAGIC.size()) ||
+	   static_cast<uint8_t>(data[ROOM_LOG_MAGIC.size()]) != ROOM_LOG_VERSION)
+		return false;
+	data.remove_prefix(ROOM_LOG_SEGMENT_HEADER_SIZE);
+	return true;
+}
+
+// Reads the record at the start of the data and skips it. Returns false if
+// the data is too short to hold a whole record.
+inline bool ReadRoomLogRecord(std::string_view& data, RoomLogRecord& record) noexcept
+{
+	if(data.size() < ROOM_LOG_RECORD_HEADER_SIZE)
+		return false;
+	uint32_t length = 0U;
+	std::memcpy(&record.timestamp, data.data(), sizeof(uint64_t));
+	std::memcpy(&record.roomId, data.data() + sizeof(uint64_t), sizeof(uint32_t));
+	std::memcpy(&length, data.data() + sizeof(uint64_t) + sizeof(uint32_t), sizeof(uint32_t));
+	if(data.size() - ROOM_LOG_RECORD_HEADER_SIZE < length)
+		return false;
+	record.text = data.substr(ROOM_LOG_RECORD_HEADER_SIZE, length);
+	data.remove_prefix(ROOM_LOG_RECORD_HEADER_SIZE + length);
+	return true;
+}
+
+} // namespace Ignis::Multirole::LogHandlerDetail
+
+#endif // MULTIROLE_SERVICE_LOGHANDLER_ROOMLOGFORMAT_HPP
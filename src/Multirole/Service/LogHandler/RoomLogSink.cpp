@@ -0,0 +1,81 @@
+#include "RoomLogSink.hpp"
+
+#include "RoomLogFormat.hpp"
+#include "../../I18N.hpp"
+
+namespace Ignis::Multirole::LogHandlerDetail
+{
+
+namespace
+{
+
+inline uint64_t Millis(const Timestamp& ts) noexcept
+{
+	using namespace std::chrono;
+	return static_cast<uint64_t>(duration_cast<milliseconds>(ts.time_since_epoch()).count());
+}
+
+} // namespace
+
+RoomLogSink::RoomLogSink(const std::filesystem::path& dir, std::size_t segmentSize) :
+	dir(dir),
+	segmentSize(segmentSize),
+	written(0U),
+	sequence(0U)
+{
+	if(!NewSegment())
+		throw std::runtime_error(I18N::LOG_HANDLER_CANNOT_OPEN_ROOM_LOG);
+}
+
+RoomLogSink::~RoomLogSink() noexcept = default;
+
+void RoomLogSink::Log(const Timestamp& ts, const SinkLogProps& props, std::string_view str) noexcept
+{
+	WriteRoomLogRecord(buf, {Millis(ts), std::get<RoomLogProps>(props).roomId, str});
+}
+
+void RoomLogSink::Flush() noexcept
+{
+	// NOTE: If a new segment can't be opened the records are discarded, and
+	// opening one is tried again on the next batch.
+	if((!f.is_open() || written + buf.size() > segmentSize) && !NewSegment())
+	{
+		buf.clear();
+		return;
+	}
+	f.write(buf.data(), static_cast<std::streamsize>(buf.size())).flush();
+	written += buf.size();
+	buf.clear();
+}
+
+// private
+
+bool RoomLogSink::NewSegment() noexcept
+{
+	// NOTE: Avoids starting segments without records one after another.
+	if(f.is_open() && written == ROOM_LOG_SEGMENT_HEADER_SIZE)
+		return true;
+	f.close();
+	// NOTE: Names already taken (e.g: by segments written before a restart
+	// on the same millisecond) are skipped, so no segment is truncated.
+	const auto millis = Millis(TimestampNow());
+	std::filesystem::path path;
+	std::error_code ec;
+	do
+	{
+		path = dir / fmt::format("{}-{}{}", millis, sequence++, ROOM_LOG_EXTENSION);
+	}
+	while(std::filesystem::exists(path, ec));
+	if(ec)
+		return false;
+	f.open(path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+	if(!f.is_open())
+		return false;
+	fmt::memory_buffer header;
+	WriteRoomLogSegmentHeader(header);
+	f.write(header.data(), static_cast<std::streamsize>(header.size()));
+	written = header.size();
+	return true;
+}
+
+} // namespace Ignis::Multirole::LogHandlerDetail
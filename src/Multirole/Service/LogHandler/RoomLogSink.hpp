@@ -0,0 +1,37 @@
+#ifndef MULTIROLE_SERVICE_LOGHANDLER_ROOMLOGSINK_HPP
+#define MULTIROLE_SERVICE_LOGHANDLER_ROOMLOGSINK_HPP
+#include "ISink.hpp"
+
+#include <filesystem>
+#include <fstream>
+
+#include <fmt/format.h>
+
+namespace Ignis::Multirole::LogHandlerDetail
+{
+
+// Appends the records of every room to the current segment of the room log
+// (see RoomLogFormat.hpp), starting a new segment once it would grow past
+// the given size. Segments are never overwritten. Only accepts records with
+// RoomLogProps.
+class RoomLogSink final : public ISink
+{
+public:
+	RoomLogSink(const std::filesystem::path& dir, std::size_t segmentSize);
+	~RoomLogSink() noexcept;
+	void Log(const Timestamp& ts, const SinkLogProps& props, std::string_view str) noexcept override;
+	void Flush() noexcept override;
+private:
+	const std::filesystem::path dir;
+	const std::size_t segmentSize;
+	std::ofstream f;
+	std::size_t written;
+	uint32_t sequence; // Tells apart segments started on the same millisecond.
+	fmt::memory_buffer buf;
+
+	bool NewSegment() noexcept;
+};
+
+} // namespace Ignis::Multirole::LogHandlerDetail
+
+#endif // MULTIROLE_SERVICE_LOGHANDLER_ROOMLOGSINK_HPP
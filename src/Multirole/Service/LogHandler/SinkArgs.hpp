@@ -10,7 +10,12 @@ namespace Ignis::Multirole::LogHandlerDetail
 
 using SvcLogProps = std::pair<ServiceType, Level>;
 using ECLogProps = std::tuple<ErrorCategory, uint64_t /*replayId*/, uint32_t /*turnCounter*/>;
-using SinkLogProps = std::variant<SvcLogProps, ECLogProps>;
+// NOTE: Only given to the room log sink.
+struct RoomLogProps
+{
+	uint32_t roomId;
+};
+using SinkLogProps = std::variant<SvcLogProps, ECLogProps, RoomLogProps>;
 
 } // namespace Ignis::Multirole::LogHandlerDetail
 
@@ -7,16 +7,19 @@
 namespace Ignis::Multirole::LogHandlerDetail
 {
 
-StderrSink::StderrSink(std::mutex& mtx) :
-	mtx(mtx)
-{}
+StderrSink::StderrSink() = default;
 
 StderrSink::~StderrSink() noexcept = default;
 
 void StderrSink::Log(const Timestamp& ts, const SinkLogProps& props, std::string_view str) noexcept
 {
-	std::scoped_lock lock(mtx);
-	StreamFormat(std::cerr, ts, props, str);
+	StreamFormat(buf, ts, props, str);
+}
+
+void StderrSink::Flush() noexcept
+{
+	std::cerr.write(buf.data(), static_cast<std::streamsize>(buf.size())).flush();
+	buf.clear();
 }
 
 } // namespace Ignis::Multirole::LogHandlerDetail
@@ -2,7 +2,7 @@
 #define MULTIROLE_SERVICE_LOGHANDLER_STDERRSINK_HPP
 #include "ISink.hpp"
 
-#include <mutex>
+#include <fmt/format.h>
 
 namespace Ignis::Multirole::LogHandlerDetail
 {
@@ -10,11 +10,12 @@ namespace Ignis::Multirole::LogHandlerDetail
 class StderrSink final : public ISink
 {
 public:
-	StderrSink(std::mutex& mtx);
+	StderrSink();
 	~StderrSink() noexcept;
 	void Log(const Timestamp& ts, const SinkLogProps& props, std::string_view str) noexcept override;
+	void Flush() noexcept override;
 private:
-	std::mutex& mtx;
+	fmt::memory_buffer buf;
 };
 
 } // namespace Ignis::Multirole::LogHandlerDetail
@@ -7,16 +7,19 @@
 namespace Ignis::Multirole::LogHandlerDetail
 {
 
-StdoutSink::StdoutSink(std::mutex& mtx) :
-	mtx(mtx)
-{}
+StdoutSink::StdoutSink() = default;
 
 StdoutSink::~StdoutSink() noexcept = default;
 
 void StdoutSink::Log(const Timestamp& ts, const SinkLogProps& props, std::string_view str) noexcept
 {
-	std::scoped_lock lock(mtx);
-	StreamFormat(std::cout, ts, props, str);
+	StreamFormat(buf, ts, props, str);
+}
+
+void StdoutSink::Flush() noexcept
+{
+	std::cout.write(buf.data(), static_cast<std::streamsize>(buf.size())).flush();
+	buf.clear();
 }
 
 } // namespace Ignis::Multirole::LogHandlerDetail
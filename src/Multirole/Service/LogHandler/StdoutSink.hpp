@@ -2,7 +2,7 @@
 #define MULTIROLE_SERVICE_LOGHANDLER_STDOUTSINK_HPP
 #include "ISink.hpp"
 
-#include <mutex>
+#include <fmt/format.h>
 
 namespace Ignis::Multirole::LogHandlerDetail
 {
@@ -10,11 +10,12 @@ namespace Ignis::Multirole::LogHandlerDetail
 class StdoutSink final : public ISink
 {
 public:
-	StdoutSink(std::mutex& mtx);
+	StdoutSink();
 	~StdoutSink() noexcept;
 	void Log(const Timestamp& ts, const SinkLogProps& props, std::string_view str) noexcept override;
+	void Flush() noexcept override;
 private:
-	std::mutex& mtx;
+	fmt::memory_buffer buf;
 };
 
 } // namespace Ignis::Multirole::LogHandlerDetail
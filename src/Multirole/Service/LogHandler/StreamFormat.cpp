@@ -1,6 +1,7 @@
 #include "StreamFormat.hpp"
 
 #include <array>
+#include <iterator> // std::back_inserter
 
 namespace Ignis::Multirole::LogHandlerDetail
 {
@@ -40,23 +41,27 @@ constexpr std::size_t AsSizeT(T v)
 
 } // namespace
 
-void StreamFormat(std::ostream& os, const Timestamp& ts, const SinkLogProps& props, std::string_view str) noexcept
+void StreamFormat(fmt::memory_buffer& out, const Timestamp& ts, const SinkLogProps& props, std::string_view str) noexcept
 {
-	FmtTimestamp(os, ts);
+	FmtTimestamp(out, ts);
 	if(std::holds_alternative<SvcLogProps>(props))
 	{
 		const auto& svcLogProps = std::get<0>(props);
-		os << " [Service:" << SVC_NAMES[AsSizeT(svcLogProps.first)] << ']'
-		   << " [Level:" << LEVEL_NAMES[AsSizeT(svcLogProps.second)] << ']';
+		fmt::format_to(std::back_inserter(out), " [Service:{}] [Level:{}]",
+			SVC_NAMES[AsSizeT(svcLogProps.first)],
+			LEVEL_NAMES[AsSizeT(svcLogProps.second)]);
 	}
 	else // std::holds_alternative<ECLogProps>(props)
 	{
 		const auto& ecLogProps = std::get<1>(props);
-		os << " [EC:" << EC_NAMES[AsSizeT(std::get<0>(ecLogProps))] << ']'
-		   << " [ReplayID:" << std::get<1>(ecLogProps) << ']'
-		   << " [Turn:" << std::get<2>(ecLogProps) << ']';
+		fmt::format_to(std::back_inserter(out), " [EC:{}] [ReplayID:{}] [Turn:{}]",
+			EC_NAMES[AsSizeT(std::get<0>(ecLogProps))],
+			std::get<1>(ecLogProps),
+			std::get<2>(ecLogProps));
 	}
-	os << ' ' << str << '\n';
+	out.push_back(' ');
+	out.append(str.data(), str.data() + str.size());
+	out.push_back('\n');
 }
 
 } // namespace Ignis::Multirole::LogHandlerDetail
@@ -1,8 +1,9 @@
 #ifndef MULTIROLE_SERVICE_LOGHANDLER_STREAMFORMAT_HPP
 #define MULTIROLE_SERVICE_LOGHANDLER_STREAMFORMAT_HPP
-#include <ostream>
 #include <string_view>
 
+#include <fmt/format.h>
+
 #include "SinkArgs.hpp"
 #include "Timestamp.hpp"
 
@@ -15,7 +16,7 @@ namespace Ignis::Multirole::LogHandlerDetail
 // Example log:
 // [2021-03-18 15:50:44] [Service:ReplayManager] [Level:Error] lastId cannot be opened for reading.
 // [2021-03-18 15:50:45] [EC:Core] [ReplayID:2746210] Core exception at processing: Process is not running.
-void StreamFormat(std::ostream& os, const Timestamp& ts, const SinkLogProps& props, std::string_view str) noexcept;
+void StreamFormat(fmt::memory_buffer& out, const Timestamp& ts, const SinkLogProps& props, std::string_view str) noexcept;
 
 } // namespace Ignis::Multirole::LogHandlerDetail
 
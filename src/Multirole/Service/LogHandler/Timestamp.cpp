@@ -2,6 +2,7 @@
 
 #include <array>
 #include <ctime>
+#include <iterator> // std::back_inserter
 
 namespace Ignis::Multirole::LogHandlerDetail
 {
@@ -11,17 +12,22 @@ Timestamp TimestampNow() noexcept
 	return std::chrono::system_clock::now();
 }
 
-void FmtTimestamp(std::ostream& os, const Timestamp& timestamp) noexcept
+void FmtTimestamp(fmt::memory_buffer& out, const Timestamp& timestamp) noexcept
 {
 	using namespace std::chrono;
+	thread_local std::time_t cachedTt = -1;
+	thread_local std::array<char, 32U> tBuf{};
+	thread_local std::size_t sz = 0U;
 	const auto tt = system_clock::to_time_t(timestamp);
-	const auto* lt = std::localtime(&tt);
-	std::array<char, 32U> tBuf{};
-	const auto sz1 = std::strftime(tBuf.data(), tBuf.size(), "%Y-%m-%d %H:%M:%S", lt);
-	std::array<char, 4U> msBuf{};
+	if(tt != cachedTt)
+	{
+		cachedTt = tt;
+		sz = std::strftime(tBuf.data(), tBuf.size(), "%Y-%m-%d %H:%M:%S", std::localtime(&tt));
+	}
 	const auto ms = static_cast<unsigned>(duration_cast<milliseconds>(timestamp.time_since_epoch()).count() % 1000U);
-	const auto sz2 = std::snprintf(msBuf.data(), msBuf.size(), "%03u", ms);
-	os.put('[').write(tBuf.data(), sz1).put('.').write(msBuf.data(), sz2).put(']');
+	out.push_back('[');
+	out.append(tBuf.data(), tBuf.data() + sz);
+	fmt::format_to(std::back_inserter(out), ".{:03}]", ms);
 }
 
 } // namespace Ignis::Multirole::LogHandlerDetail
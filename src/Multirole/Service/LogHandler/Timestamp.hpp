@@ -1,7 +1,8 @@
 #ifndef MULTIROLE_SERVICE_LOGHANDLER_TIMESTAMP_HPP
 #define MULTIROLE_SERVICE_LOGHANDLER_TIMESTAMP_HPP
 #include <chrono>
-#include <ostream>
+
+#include <fmt/format.h>
 
 namespace Ignis::Multirole::LogHandlerDetail
 {
@@ -9,7 +10,9 @@ namespace Ignis::Multirole::LogHandlerDetail
 using Timestamp = std::chrono::time_point<std::chrono::system_clock>;
 
 Timestamp TimestampNow() noexcept;
-void FmtTimestamp(std::ostream& os, const Timestamp& timestamp) noexcept;
+// NOTE: The date and time are only formatted again when the second changes,
+// the cache is kept per thread.
+void FmtTimestamp(fmt::memory_buffer& out, const Timestamp& timestamp) noexcept;
 
 } // namespace Ignis::Multirole::LogHandlerDetail
 
@@ -1,13 +1,14 @@
 #include "ReplayManager.hpp"
 
 #include <filesystem>
+#include <fstream>
 
 #include <boost/interprocess/sync/scoped_lock.hpp>
 
 #include "LogHandler.hpp"
-#define LOG_INFO(...) lh.Log(ServiceType::REPLAY_MANAGER, Level::INFO, __VA_ARGS__)
-#define LOG_WARN(...) lh.Log(ServiceType::REPLAY_MANAGER, Level::WARN, __VA_ARGS__)
-#define LOG_ERROR(...) lh.Log(ServiceType::REPLAY_MANAGER, Level::ERROR, __VA_ARGS__)
+#define LOG_INFO(...) MULTIROLE_LOG_SVC(lh, ServiceType::REPLAY_MANAGER, Level::INFO, __VA_ARGS__)
+#define LOG_WARN(...) MULTIROLE_LOG_SVC(lh, ServiceType::REPLAY_MANAGER, Level::WARN, __VA_ARGS__)
+#define LOG_ERROR(...) MULTIROLE_LOG_SVC(lh, ServiceType::REPLAY_MANAGER, Level::ERROR, __VA_ARGS__)
 #include "../I18N.hpp"
 #include "../YGOPro/Replay.hpp"
 
@@ -6,8 +6,8 @@
 #include <stdexcept> // std::runtime_error
 
 #include "LogHandler.hpp"
-#define LOG_INFO(...) lh.Log(ServiceType::SCRIPT_PROVIDER, Level::INFO, __VA_ARGS__)
-#define LOG_ERROR(...) lh.Log(ServiceType::SCRIPT_PROVIDER, Level::ERROR, __VA_ARGS__)
+#define LOG_INFO(...) MULTIROLE_LOG_SVC(lh, ServiceType::SCRIPT_PROVIDER, Level::INFO, __VA_ARGS__)
+#define LOG_ERROR(...) MULTIROLE_LOG_SVC(lh, ServiceType::SCRIPT_PROVIDER, Level::ERROR, __VA_ARGS__)
 #include "../I18N.hpp"
 
 namespace Ignis::Multirole
@@ -0,0 +1,185 @@
+#include "TimerWheel.hpp"
+
+#include <algorithm> // std::max
+#include <array>
+#include <mutex>
+
+#include <boost/asio/steady_timer.hpp>
+
+namespace Ignis::Multirole
+{
+
+struct TimerWheel::State final : std::enable_shared_from_this<State>
+{
+	// NOTE: Each slot of the coarse level spans a whole turn of the fine one.
+	static constexpr std::size_t FINE_SLOTS = 256U;
+	static constexpr std::size_t COARSE_SLOTS = 64U;
+	static constexpr std::size_t UNLINKED = FINE_SLOTS + COARSE_SLOTS;
+
+	boost::asio::steady_timer timer;
+	const Clock::duration tick;
+	std::array<Handle*, FINE_SLOTS + COARSE_SLOTS> slots; // Fine level first.
+	uint64_t now; // Ticks elapsed.
+	std::size_t armed; // Handles linked on either level.
+	std::function<bool()> idle;
+	bool stopped;
+	std::mutex m;
+
+	State(boost::asio::io_context& ioCtx, Clock::duration tick) :
+		timer(ioCtx),
+		tick(std::max<Clock::duration>(tick, std::chrono::milliseconds(1))),
+		slots(),
+		now(0U),
+		armed(0U),
+		stopped(false)
+	{}
+
+	// NOTE: Everything below is called with the mutex held.
+
+	void Arm(Handle& h, Clock::duration d) noexcept
+	{
+		// NOTE: Rounded up and one more tick added, as the current tick is
+		// already partially elapsed, so a deadline never expires early.
+		const auto count = std::max<Clock::rep>(d.count(), 0);
+		h.expiry = now + static_cast<uint64_t>((count + tick.count() - 1) / tick.count()) + 1U;
+		Link(h);
+		armed++;
+	}
+
+	// Puts the handle on the fine level if it expires within its current
+	// turn, otherwise on the coarse slot where that turn starts. A deadline
+	// further than a whole turn of the coarse level simply gets linked to
+	// the coarse level again once its slot comes around.
+	void Link(Handle& h) noexcept
+	{
+		if(h.expiry - now < FINE_SLOTS)
+			h.slot = h.expiry % FINE_SLOTS;
+		else
+			h.slot = FINE_SLOTS + (h.expiry / FINE_SLOTS) % COARSE_SLOTS;
+		h.prev = nullptr;
+		h.next = slots[h.slot];
+		if(h.next != nullptr)
+			h.next->prev = &h;
+		slots[h.slot] = &h;
+	}
+
+	void Unlink(Handle& h) noexcept
+	{
+		if(h.slot == UNLINKED)
+			return;
+		if(h.prev != nullptr)
+			h.prev->next = h.next;
+		else
+			slots[h.slot] = h.next;
+		if(h.next != nullptr)
+			h.next->prev = h.prev;
+		h.slot = UNLINKED;
+		armed--;
+	}
+
+	void DoWait() noexcept
+	{
+		timer.expires_at(timer.expiry() + tick);
+		timer.async_wait([self = shared_from_this()](boost::system::error_code ec)
+		{
+			if(ec)
+				return;
+			std::scoped_lock lock(self->m);
+			if(self->stopped)
+				return;
+			self->Advance();
+			if(self->idle && self->armed == 0U && self->idle())
+			{
+				self->stopped = true;
+				return;
+			}
+			self->DoWait();
+		});
+	}
+
+	void Advance() noexcept
+	{
+		now++;
+		if(now % FINE_SLOTS == 0U)
+		{
+			const std::size_t coarse = FINE_SLOTS + (now / FINE_SLOTS) % COARSE_SLOTS;
+			Handle* h = slots[coarse];
+			slots[coarse] = nullptr;
+			while(h != nullptr)
+			{
+				Handle* next = h->next;
+				Link(*h);
+				h = next;
+			}
+		}
+		// NOTE: Every handle on the current fine slot expires right now.
+		const std::size_t fine = now % FINE_SLOTS;
+		Handle* h = slots[fine];
+		slots[fine] = nullptr;
+		while(h != nullptr)
+		{
+			Handle* next = h->next;
+			h->slot = UNLINKED;
+			armed--;
+			h->onExpire();
+			h = next;
+		}
+	}
+};
+
+// public
+
+TimerWheel::TimerWheel(boost::asio::io_context& ioCtx, Clock::duration tick) :
+	state(std::make_shared<State>(ioCtx, tick))
+{
+	std::scoped_lock lock(state->m);
+	state->timer.expires_after(Clock::duration::zero());
+	state->DoWait();
+}
+
+TimerWheel::~TimerWheel() noexcept
+{
+	Stop();
+}
+
+void TimerWheel::Stop() noexcept
+{
+	std::scoped_lock lock(state->m);
+	state->stopped = true;
+	state->timer.cancel();
+}
+
+void TimerWheel::StopWhenIdle(std::function<bool()> idle) noexcept
+{
+	std::scoped_lock lock(state->m);
+	state->idle = std::move(idle);
+}
+
+TimerWheel::Handle::Handle(TimerWheel& wheel, std::function<void()> onExpire) :
+	state(wheel.state),
+	onExpire(std::move(onExpire)),
+	prev(nullptr),
+	next(nullptr),
+	slot(State::UNLINKED),
+	expiry(0U)
+{}
+
+TimerWheel::Handle::~Handle() noexcept
+{
+	Cancel();
+}
+
+void TimerWheel::Handle::Arm(Clock::duration d) noexcept
+{
+	std::scoped_lock lock(state->m);
+	state->Unlink(*this);
+	state->Arm(*this, d);
+}
+
+void TimerWheel::Handle::Cancel() noexcept
+{
+	std::scoped_lock lock(state->m);
+	state->Unlink(*this);
+}
+
+} // namespace Ignis::Multirole
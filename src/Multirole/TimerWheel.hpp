@@ -0,0 +1,71 @@
+#ifndef MULTIROLE_TIMERWHEEL_HPP
+#define MULTIROLE_TIMERWHEEL_HPP
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include <boost/asio/io_context.hpp>
+
+namespace Ignis::Multirole
+{
+
+// Coarse deadlines for many objects driven by a single timer. Deadlines are
+// kept on a two level hierarchical wheel of intrusive lists, so arming and
+// cancelling one is O(1), each tick only visits the deadlines that expire on
+// it, and no timer object is needed per deadline. Far away deadlines sit on
+// the coarser level and move down to the finer one as they approach.
+// Deadlines expire at tick granularity, up to two ticks late.
+class TimerWheel final
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	class Handle;
+
+	TimerWheel(boost::asio::io_context& ioCtx, Clock::duration tick);
+	~TimerWheel() noexcept;
+
+	// Stops ticking, armed deadlines won't expire anymore.
+	void Stop() noexcept;
+
+	// Keeps ticking until no deadline is armed and `idle` returns true, then
+	// stops. `idle` is called from the wheel with it locked on every tick.
+	void StopWhenIdle(std::function<bool()> idle) noexcept;
+private:
+	struct State;
+
+	const std::shared_ptr<State> state;
+};
+
+// A single deadline on a wheel, cancelled when destroyed.
+class TimerWheel::Handle final
+{
+public:
+	// NOTE: `onExpire` is called from the wheel with it locked, so it must
+	// not arm or cancel any handle, only hand work off (e.g: to a strand).
+	// Once Cancel returns, or the handle is destroyed, it won't be called.
+	Handle(TimerWheel& wheel, std::function<void()> onExpire);
+	~Handle() noexcept;
+
+	Handle(const Handle&) = delete;
+	Handle& operator=(const Handle&) = delete;
+
+	// Sets the deadline relative to now, replacing any previous one.
+	void Arm(Clock::duration d) noexcept;
+
+	void Cancel() noexcept;
+private:
+	friend struct TimerWheel::State;
+
+	const std::shared_ptr<State> state;
+	const std::function<void()> onExpire;
+	Handle* prev;
+	Handle* next;
+	std::size_t slot;
+	uint64_t expiry; // Tick on which the deadline expires.
+};
+
+} // namespace Ignis::Multirole
+
+#endif // MULTIROLE_TIMERWHEEL_HPP
@@ -0,0 +1,185 @@
+#include "Tracing.hpp"
+
+#include <algorithm> // std::min, std::remove_if
+#include <fstream>
+#include <iterator> // std::back_inserter
+#include <memory>
+#include <mutex>
+#include <stdexcept> // std::runtime_error
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "I18N.hpp"
+
+namespace Ignis::Multirole::Tracing
+{
+
+namespace
+{
+
+// NOTE: Every field is atomic as a slot might be overwritten by its thread
+// while being dumped, see Ring::Collect for how those slots are discarded.
+struct Slot
+{
+	std::atomic<const char*> name;
+	std::atomic<uint32_t> roomId;
+	std::atomic<uint64_t> start;
+	std::atomic<uint64_t> end;
+};
+
+struct SpanData
+{
+	const char* name;
+	uint32_t roomId;
+	uint64_t start;
+	uint64_t end;
+};
+
+class Ring final
+{
+public:
+	Ring(std::size_t tid, std::size_t capacity) :
+		tid(tid),
+		capacity(capacity),
+		slots(std::make_unique<Slot[]>(capacity)),
+		head(0U)
+	{}
+
+	std::size_t Tid() const noexcept
+	{
+		return tid;
+	}
+
+	// NOTE: Only called by the thread that owns the ring.
+	void Push(const SpanData& span) noexcept
+	{
+		const uint64_t h = head.load(std::memory_order_relaxed);
+		auto& slot = slots[h % capacity];
+		// Orders the previous head update before the writes to the slot.
+		std::atomic_thread_fence(std::memory_order_release);
+		slot.name.store(span.name, std::memory_order_relaxed);
+		slot.roomId.store(span.roomId, std::memory_order_relaxed);
+		slot.start.store(span.start, std::memory_order_relaxed);
+		slot.end.store(span.end, std::memory_order_relaxed);
+		head.store(h + 1U, std::memory_order_release);
+	}
+
+	void Collect(std::vector<SpanData>& out, uint64_t since) const
+	{
+		const uint64_t last = head.load(std::memory_order_acquire);
+		const uint64_t first = (last > capacity) ? last - capacity : 0U;
+		const std::size_t prevSize = out.size();
+		for(uint64_t i = first; i < last; i++)
+		{
+			const auto& slot = slots[i % capacity];
+			out.push_back(
+			{
+				slot.name.load(std::memory_order_relaxed),
+				slot.roomId.load(std::memory_order_relaxed),
+				slot.start.load(std::memory_order_relaxed),
+				slot.end.load(std::memory_order_relaxed)
+			});
+		}
+		// Any slot that the owner thread started overwriting while they were
+		// being read might be torn, those are the oldest ones, so they can be
+		// discarded by checking how far the head moved in the meanwhile.
+		std::atomic_thread_fence(std::memory_order_acquire);
+		const uint64_t now = head.load(std::memory_order_relaxed);
+		const uint64_t torn = (now >= first + capacity) ? now - capacity + 1U - first : 0U;
+		auto begin = out.begin() + prevSize;
+		begin = out.erase(begin, begin + std::min<std::size_t>(torn, out.end() - begin));
+		out.erase(std::remove_if(begin, out.end(), [&](const SpanData& s)
+		{
+			return s.end < since;
+		}), out.end());
+	}
+private:
+	const std::size_t tid;
+	const std::size_t capacity;
+	const std::unique_ptr<Slot[]> slots;
+	std::atomic<uint64_t> head;
+};
+
+const auto EPOCH = std::chrono::steady_clock::now();
+std::atomic<std::size_t> spansPerThread{0U};
+std::vector<std::unique_ptr<Ring>> rings;
+std::mutex mRings;
+
+Ring* LocalRing() noexcept
+{
+	thread_local Ring* ring = nullptr;
+	if(ring != nullptr)
+		return ring;
+	try
+	{
+		std::scoped_lock lock(mRings);
+		ring = rings.emplace_back(std::make_unique<Ring>(rings.size() + 1U,
+			spansPerThread.load(std::memory_order_relaxed))).get();
+	}
+	catch(const std::bad_alloc&)
+	{}
+	return ring;
+}
+
+} // namespace
+
+namespace Detail
+{
+
+std::atomic<bool> enabled{false};
+
+uint64_t Now() noexcept
+{
+	// NOTE: Offset by 1 so a valid timestamp is never 0.
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - EPOCH).count()) + 1U;
+}
+
+void Record(const char* name, uint32_t roomId, uint64_t start, uint64_t end) noexcept
+{
+	if(Ring* ring = LocalRing(); ring != nullptr)
+		ring->Push({name, roomId, start, end});
+}
+
+} // namespace Detail
+
+void Enable(std::size_t count) noexcept
+{
+	spansPerThread.store(std::max<std::size_t>(count, 1U), std::memory_order_relaxed);
+	Detail::enabled.store(true, std::memory_order_relaxed);
+}
+
+std::size_t Dump(const std::filesystem::path& file, std::chrono::seconds window)
+{
+	const uint64_t windowNs = std::chrono::duration_cast<std::chrono::nanoseconds>(window).count();
+	const uint64_t now = Detail::Now();
+	const uint64_t since = (now > windowNs) ? now - windowNs : 0U;
+	fmt::memory_buffer out;
+	fmt::format_to(std::back_inserter(out), "{{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	std::size_t count = 0U;
+	std::vector<SpanData> spans;
+	std::scoped_lock lock(mRings);
+	for(const auto& ring : rings)
+	{
+		spans.clear();
+		ring->Collect(spans, since);
+		for(const auto& s : spans)
+		{
+			fmt::format_to(std::back_inserter(out),
+				"{}{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}",
+				(count++ == 0U) ? "" : ",", s.name, ring->Tid(),
+				static_cast<double>(s.start) / 1e3, static_cast<double>(s.end - s.start) / 1e3);
+			if(s.roomId != 0U)
+				fmt::format_to(std::back_inserter(out), ",\"args\":{{\"room\":{}}}", s.roomId);
+			out.push_back('}');
+		}
+	}
+	fmt::format_to(std::back_inserter(out), "]}}\n");
+	std::ofstream f(file, std::ofstream::binary);
+	if(!f.is_open() || !f.write(out.data(), static_cast<std::streamsize>(out.size())))
+		throw std::runtime_error(I18N::TRACING_CANNOT_WRITE_DUMP);
+	return count;
+}
+
+} // namespace Ignis::Multirole::Tracing
@@ -0,0 +1,64 @@
+#ifndef MULTIROLE_TRACING_HPP
+#define MULTIROLE_TRACING_HPP
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace Ignis::Multirole::Tracing
+{
+
+// Opt-in recording of timed spans along the hot paths. Each thread records
+// on its own ring buffer, keeping only its most recent spans, which can then
+// be dumped as a Chrome trace (viewable with Perfetto or chrome://tracing).
+// While disabled, a span costs a single relaxed atomic load.
+
+// Starts recording, each thread that records a span allocates a ring buffer
+// that holds up to `spansPerThread` spans the first time it does so.
+void Enable(std::size_t spansPerThread) noexcept;
+
+// Writes the spans that ended within the last `window` to the given file.
+// Returns the number of spans written. Throws std::runtime_error if the file
+// couldn't be written.
+std::size_t Dump(const std::filesystem::path& file, std::chrono::seconds window);
+
+namespace Detail
+{
+
+extern std::atomic<bool> enabled;
+
+uint64_t Now() noexcept;
+void Record(const char* name, uint32_t roomId, uint64_t start, uint64_t end) noexcept;
+
+} // namespace Detail
+
+// Records the time elapsed between its construction and its destruction.
+// NOTE: `name` must outlive the program (e.g: a string literal). A room ID of
+// 0 means the span is not related to any room.
+class Span final
+{
+public:
+	Span(const char* name, uint32_t roomId = 0U) noexcept :
+		name(name),
+		roomId(roomId),
+		start(Detail::enabled.load(std::memory_order_relaxed) ? Detail::Now() : 0U)
+	{}
+
+	~Span() noexcept
+	{
+		if(start != 0U)
+			Detail::Record(name, roomId, start, Detail::Now());
+	}
+
+	Span(const Span&) = delete;
+	Span& operator=(const Span&) = delete;
+private:
+	const char* const name;
+	const uint32_t roomId;
+	const uint64_t start;
+};
+
+} // namespace Ignis::Multirole::Tracing
+
+#endif // MULTIROLE_TRACING_HPP
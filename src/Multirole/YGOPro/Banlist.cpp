@@ -1,21 +1,51 @@
 #include "Banlist.hpp"
 
+#include <algorithm> // std::sort
+#include <utility> // std::pair
+
 namespace YGOPro
 {
 
-Banlist::Banlist(bool whitelist, DictType dict) noexcept :
+Banlist::Banlist(bool whitelist, const DictType& dict) :
 	whitelist(whitelist),
-	dict(std::move(dict))
-{}
+	codes(dict.size() + 1U),
+	counts(dict.size() + 1U)
+{
+	std::vector<std::pair<uint32_t, int32_t>> sorted(dict.cbegin(), dict.cend());
+	std::sort(sorted.begin(), sorted.end());
+	// Going through the implicit tree in order visits the codes sorted.
+	std::size_t i = 0U;
+	auto Fill = [&](auto& self, std::size_t k) -> void
+	{
+		if(k >= codes.size())
+			return;
+		self(self, 2U * k);
+		codes[k] = sorted[i].first;
+		counts[k] = sorted[i].second;
+		i++;
+		self(self, 2U * k + 1U);
+	};
+	Fill(Fill, 1U);
+}
 
 bool Banlist::IsWhitelist() const noexcept
 {
 	return whitelist;
 }
 
-const Banlist::DictType& Banlist::Dict() const noexcept
+const int32_t* Banlist::Find(uint32_t code) const noexcept
 {
-	return dict;
+	std::size_t k = 1U;
+	while(k < codes.size())
+		k = 2U * k + static_cast<std::size_t>(codes[k] < code);
+	// Undo the right turns taken after the last left one, which lands on
+	// the smallest code that is not less than the searched one, if any.
+	while((k & 1U) != 0U)
+		k >>= 1U;
+	k >>= 1U;
+	if(k == 0U || codes[k] != code)
+		return nullptr;
+	return &counts[k];
 }
 
 } // namespace YGOPro
@@ -3,22 +3,31 @@
 #include <cstdint>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 namespace YGOPro
 {
 
+// Banlists never change once loaded, so the codes are kept on a flat array
+// in Eytzinger (breadth-first) order, with a parallel array for the counts,
+// which makes searching them branchless and cache friendly, as the first
+// levels of the implicit tree share the same few cache lines.
 class Banlist final
 {
 public:
 	using DictType = std::unordered_map<uint32_t /*code*/, int32_t /*count*/>;
 
-	Banlist(bool whitelist, DictType dict) noexcept;
+	Banlist(bool whitelist, const DictType& dict);
 
 	bool IsWhitelist() const noexcept;
-	const DictType& Dict() const noexcept;
+
+	// Returns the amount of copies allowed of the card, or nullptr if it is
+	// not on the banlist.
+	const int32_t* Find(uint32_t code) const noexcept;
 private:
 	const bool whitelist;
-	DictType dict;
+	std::vector<uint32_t> codes; // 1-based, index 0 is unused.
+	std::vector<int32_t> counts; // Same indices as `codes`.
 };
 
 using BanlistPtr = std::shared_ptr<Banlist>;
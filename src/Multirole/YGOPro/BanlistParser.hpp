@@ -17,7 +17,10 @@ using BanlistMap = std::unordered_map<BanlistHash, BanlistPtr>;
 #ifdef YGOPRO_BANLIST_PARSER_IMPLEMENTATION
 #ifndef YGOPRO_BANLIST_PARSER_IMPL_HPP
 #define YGOPRO_BANLIST_PARSER_IMPL_HPP
+#include <algorithm> // std::min
 #include <charconv>
+#include <cstring> // std::memchr
+#include <string_view>
 #include <fmt/format.h>
 
 namespace YGOPro
@@ -40,8 +43,9 @@ constexpr BanlistHash Salt(BanlistHash hash, uint32_t code, int32_t count) noexc
 
 } // namespace Detail
 
-template<typename Stream>
-void ParseForBanlists(Stream& stream, BanlistMap& banlists)
+// NOTE: Banlists that were completely parsed are added to `banlists` even if
+// an exception is thrown later on.
+inline void ParseForBanlists(std::string_view contents, BanlistMap& banlists)
 {
 	BanlistHash hash = Detail::BANLIST_HASH_MAGIC;
 	bool whitelist = false;
@@ -50,23 +54,34 @@ void ParseForBanlists(Stream& stream, BanlistMap& banlists)
 	{
 		if(hash == Detail::BANLIST_HASH_MAGIC)
 			return;
-		auto banlist = std::make_shared<Banlist>(whitelist, std::move(dict));
+		auto banlist = std::make_shared<Banlist>(whitelist, dict);
 		banlists.emplace(std::piecewise_construct,
 			std::forward_as_tuple(hash),
 			std::forward_as_tuple(std::move(banlist))
 		);
 	};
-	std::string l;
+	std::string_view l;
 	std::size_t lc = 0U;
 	auto MakeException = [&lc](std::string_view str)
 	{
 		return std::runtime_error(fmt::format("line {:d}: {:s}", lc, str));
 	};
-	while(++lc, std::getline(stream, l))
+	// Splits the next line off the contents, returns false if there's none.
+	auto NextLine = [&contents, &l]() -> bool
+	{
+		if(contents.empty())
+			return false;
+		const auto* nl = static_cast<const char*>(std::memchr(contents.data(), '\n', contents.size()));
+		const std::size_t size = (nl != nullptr) ? static_cast<std::size_t>(nl - contents.data()) : contents.size();
+		l = contents.substr(0U, size);
+		contents.remove_prefix(std::min(size + 1U, contents.size()));
+		return true;
+	};
+	while(++lc, NextLine())
 	{
 		if(l.empty())
 			continue;
-		if(l.find("$whitelist") != std::string::npos)
+		if(l.find("$whitelist") != std::string_view::npos)
 		{
 			whitelist = true;
 			continue;
@@ -89,7 +104,7 @@ void ParseForBanlists(Stream& stream, BanlistMap& banlists)
 			int32_t count;
 
 			const auto separator = l.find(' ');
-			if(separator == std::string::npos)
+			if(separator == std::string_view::npos)
 				throw MakeException("Card code separator not found");
 
 			{
@@ -105,10 +120,10 @@ void ParseForBanlists(Stream& stream, BanlistMap& banlists)
 			{
 				static constexpr auto INT_CHARS = "-0123456789";
 				const auto begin = l.find_first_of(INT_CHARS, separator);
-				if(begin == std::string::npos)
+				if(begin == std::string_view::npos)
 					throw MakeException("Could not find count begin");
 				auto end = l.find_first_not_of(INT_CHARS, begin);
-				if(end == std::string::npos)
+				if(end == std::string_view::npos)
 					end = l.size();
 				const auto [_, error]
 				{
@@ -7,10 +7,13 @@
 #include <sqlite3.h>
 
 #include "Constants.hpp"
+#include "../Metrics.hpp"
 
 namespace YGOPro
 {
 
+namespace Metrics = Ignis::Multirole::Metrics;
+
 static constexpr const char* DB_SCHEMAS =
 R"(
 CREATE TABLE "datas" (
@@ -83,6 +86,12 @@ SELECT ot,category
 FROM datas WHERE datas.id = ?;
 )";
 
+static constexpr const char* SUMMARIES_STMT =
+R"(
+SELECT id,alias,type,ot
+FROM datas ORDER BY datas.id;
+)";
+
 CardDatabase::CardDatabase() : CardDatabase(":memory:")
 {}
 
@@ -150,7 +159,11 @@ const OCG_CardData& CardDatabase::DataFromCode(uint32_t code) const noexcept
 {
 	std::scoped_lock lock(mDataCache);
 	if(auto search = dataCache.find(code); search != dataCache.end())
+	{
+		Metrics::Add(Metrics::Counter::CARD_DATA_CACHE_HITS);
 		return search->second;
+	}
+	Metrics::Add(Metrics::Counter::CARD_DATA_CACHE_MISSES);
 	std::scoped_lock lock2(mDb);
 	auto AllocSetcodes = [&](uint64_t dbVal) -> uint16_t*
 	{
@@ -195,7 +208,11 @@ const CardExtraData& CardDatabase::ExtraFromCode(uint32_t code) const noexcept
 {
 	std::scoped_lock lock(mExtraCache);
 	if(auto search = extraCache.find(code); search != extraCache.end())
+	{
+		Metrics::Add(Metrics::Counter::CARD_EXTRA_CACHE_HITS);
 		return search->second;
+	}
+	Metrics::Add(Metrics::Counter::CARD_EXTRA_CACHE_MISSES);
 	std::scoped_lock lock2(mDb);
 	auto& ced = extraCache.emplace(code, CardExtraData{}).first->second;
 	sqlite3_reset(s2Stmt);
@@ -208,4 +225,25 @@ const CardExtraData& CardDatabase::ExtraFromCode(uint32_t code) const noexcept
 	return ced;
 }
 
+std::vector<CardSummary> CardDatabase::Summaries() const
+{
+	std::scoped_lock lock(mDb);
+	sqlite3_stmt* stmt = nullptr;
+	if(sqlite3_prepare_v2(db, SUMMARIES_STMT, -1, &stmt, nullptr) != SQLITE_OK)
+		throw std::runtime_error(sqlite3_errmsg(db));
+	std::vector<CardSummary> summaries;
+	while(sqlite3_step(stmt) == SQLITE_ROW)
+	{
+		summaries.push_back(
+		{
+			static_cast<uint32_t>(sqlite3_column_int(stmt, 0)),
+			static_cast<uint32_t>(sqlite3_column_int(stmt, 1)),
+			static_cast<uint32_t>(sqlite3_column_int(stmt, 2)),
+			static_cast<uint32_t>(sqlite3_column_int(stmt, 3))
+		});
+	}
+	sqlite3_finalize(stmt);
+	return summaries;
+}
+
 } // namespace YGOPro
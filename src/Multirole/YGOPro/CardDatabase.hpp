@@ -4,6 +4,7 @@
 #include <memory>
 #include <mutex>
 #include <unordered_map>
+#include <vector>
 
 #include "../Core/IDataSupplier.hpp"
 
@@ -19,6 +20,14 @@ struct CardExtraData
 	uint32_t category;
 };
 
+struct CardSummary
+{
+	uint32_t code;
+	uint32_t alias;
+	uint32_t type;
+	uint32_t scope;
+};
+
 class CardDatabase final : public Ignis::Multirole::Core::IDataSupplier
 {
 public:
@@ -40,6 +49,9 @@ public:
 
 	// Query extra data
 	const CardExtraData& ExtraFromCode(uint32_t code) const noexcept;
+
+	// Reads every card of the amalgamation at once, sorted by code.
+	std::vector<CardSummary> Summaries() const;
 private:
 	sqlite3* db{};
 	sqlite3_stmt* aStmt{};
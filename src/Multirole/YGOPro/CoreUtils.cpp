@@ -1,5 +1,6 @@
 #include "CoreUtils.hpp"
 
+#include <array>
 #include <cstring> // std::memcpy
 #include <stdexcept> // std::out_of_range
 
@@ -23,38 +24,222 @@ constexpr LocInfo Read(const uint8_t*& ptr) noexcept
 	};
 }
 
+/*** Message descriptors ***/
+
+// Broad refreshes that can be requested around a message.
+enum class Refresh : uint8_t
+{
+	REFRESH_NONE,
+	REFRESH_DECKS,
+	REFRESH_HANDS,
+	REFRESH_MZONES,
+	REFRESH_SZONES,
+};
+
+// Refreshes to request, in order.
+using RefreshList = std::array<Refresh, 4U>;
+
+enum MsgFlags : uint8_t
+{
+	MSG_FLAG_REQUIRES_ANSWER = 0x1U,
+	MSG_FLAG_NOT_RECORDED    = 0x2U,
+	// Clients keep their cards as they were when receiving the message.
+	MSG_FLAG_KEEPS_CARDS     = 0x4U,
+	// The contents of the message must be looked at to know its
+	// distribution type or if it should be recorded.
+	MSG_FLAG_INSPECT_DIST    = 0x8U,
+	// The contents of the message must be looked at to know which specific
+	// cards or locations should be queried, besides its broad refreshes.
+	MSG_FLAG_INSPECT_PRE     = 0x10U,
+	MSG_FLAG_INSPECT_POST    = 0x20U,
+	// Clients only change the card whose code and location start the
+	// message (e.g: revealing it), keeping every other card as it was.
+	MSG_FLAG_CHANGES_ONE_CARD = 0x40U,
+};
+
+struct MsgDescriptor
+{
+	uint8_t flags;
+	MsgDistType distType;
+	RefreshList preRefresh;
+	RefreshList postRefresh;
+};
+
+// Everything known about each message type without looking at its contents,
+// so that classifying a message is a single lookup. Types not listed here
+// are sent to everyone, recorded and don't request any query.
+constexpr std::array<MsgDescriptor, 256U> MSG_DESCRIPTORS = []() constexpr
+{
+	using D = MsgDistType;
+	using R = Refresh;
+	// NOTE: Only messages that clients can't act upon other than by showing
+	// them keep their cards: requests, which only list the choices, hints,
+	// which are text, and phase changes, which only move the phase marker.
+	// Every other message might have clients update cards on their own, so
+	// the refreshes following it are always sent. multirole-bench checks the
+	// refreshes skipped on replays against this same assumption.
+	constexpr uint8_t REQUEST =
+		MSG_FLAG_REQUIRES_ANSWER | MSG_FLAG_NOT_RECORDED | MSG_FLAG_KEEPS_CARDS;
+	constexpr uint8_t KEEPS = MSG_FLAG_KEEPS_CARDS;
+	// NOTE: Summoning and chaining carry the code and location of the card
+	// being summoned or activated, which is the only card clients change,
+	// setting its code and position to the ones on the message.
+	constexpr uint8_t CHANGES_ONE = MSG_FLAG_CHANGES_ONE_CARD;
+	constexpr RefreshList NONE = {};
+	constexpr RefreshList FIELD = {R::REFRESH_MZONES, R::REFRESH_SZONES};
+	constexpr RefreshList FIELD_AND_HANDS =
+		{R::REFRESH_MZONES, R::REFRESH_SZONES, R::REFRESH_HANDS};
+	std::array<MsgDescriptor, 256U> t{};
+	for(auto& d : t)
+		d = {0U, D::MSG_DIST_TYPE_EVERYONE, NONE, NONE};
+	auto Set = [&t](uint8_t type, uint8_t flags, D distType,
+		const RefreshList& pre, const RefreshList& post) constexpr
+	{
+		t[type] = {flags, distType, pre, post};
+	};
+	Set(MSG_SELECT_CARD, REQUEST, D::MSG_DIST_TYPE_SPECIFIC_TEAM_DUELIST_STRIPPED, NONE, NONE);
+	Set(MSG_SELECT_TRIBUTE, REQUEST, D::MSG_DIST_TYPE_SPECIFIC_TEAM_DUELIST_STRIPPED, NONE, NONE);
+	Set(MSG_SELECT_UNSELECT_CARD, REQUEST, D::MSG_DIST_TYPE_SPECIFIC_TEAM_DUELIST_STRIPPED, NONE, NONE);
+	Set(MSG_SELECT_BATTLECMD, REQUEST, D::MSG_DIST_TYPE_SPECIFIC_TEAM_DUELIST,
+		{R::REFRESH_HANDS, R::REFRESH_MZONES, R::REFRESH_SZONES}, NONE);
+	Set(MSG_SELECT_IDLECMD, REQUEST, D::MSG_DIST_TYPE_SPECIFIC_TEAM_DUELIST,
+		{R::REFRESH_HANDS, R::REFRESH_MZONES, R::REFRESH_SZONES}, NONE);
+	Set(MSG_SELECT_EFFECTYN, REQUEST, D::MSG_DIST_TYPE_SPECIFIC_TEAM_DUELIST, NONE, NONE);
+	Set(MSG_SELECT_YESNO, REQUEST, D::MSG_DIST_TYPE_SPECIFIC_TEAM_DUELIST, NONE, NONE);
+	Set(MSG_SELECT_OPTION, REQUEST, D::MSG_DIST_TYPE_SPECIFIC_TEAM_DUELIST, NONE, NONE);
+	Set(MSG_SELECT_CHAIN, REQUEST, D::MSG_DIST_TYPE_SPECIFIC_TEAM_DUELIST, FIELD, NONE);
+	Set(MSG_SELECT_PLACE, REQUEST, D::MSG_DIST_TYPE_SPECIFIC_TEAM_DUELIST, NONE, NONE);
+	Set(MSG_SELECT_DISFIELD, REQUEST, D::MSG_DIST_TYPE_SPECIFIC_TEAM_DUELIST, NONE, NONE);
+	Set(MSG_SELECT_POSITION, REQUEST, D::MSG_DIST_TYPE_SPECIFIC_TEAM_DUELIST, NONE, NONE);
+	Set(MSG_SORT_CARD, REQUEST, D::MSG_DIST_TYPE_SPECIFIC_TEAM_DUELIST, NONE, NONE);
+	Set(MSG_SORT_CHAIN, REQUEST, D::MSG_DIST_TYPE_SPECIFIC_TEAM_DUELIST, NONE, NONE);
+	Set(MSG_SELECT_COUNTER, REQUEST, D::MSG_DIST_TYPE_SPECIFIC_TEAM_DUELIST, NONE, NONE);
+	Set(MSG_SELECT_SUM, REQUEST, D::MSG_DIST_TYPE_SPECIFIC_TEAM_DUELIST, NONE, NONE);
+	Set(MSG_ROCK_PAPER_SCISSORS, REQUEST, D::MSG_DIST_TYPE_SPECIFIC_TEAM_DUELIST, NONE, NONE);
+	Set(MSG_ANNOUNCE_RACE, REQUEST, D::MSG_DIST_TYPE_SPECIFIC_TEAM_DUELIST, NONE, NONE);
+	Set(MSG_ANNOUNCE_ATTRIB, REQUEST, D::MSG_DIST_TYPE_SPECIFIC_TEAM_DUELIST, NONE, NONE);
+	Set(MSG_ANNOUNCE_CARD, REQUEST, D::MSG_DIST_TYPE_SPECIFIC_TEAM_DUELIST, NONE, NONE);
+	Set(MSG_ANNOUNCE_NUMBER, REQUEST, D::MSG_DIST_TYPE_SPECIFIC_TEAM_DUELIST, NONE, NONE);
+	// NOTE: Unlike the other requests, this one always made it to replays,
+	// so it keeps being recorded for them to stay the same.
+	Set(MSG_ANNOUNCE_CARD_FILTER, REQUEST & ~MSG_FLAG_NOT_RECORDED,
+		D::MSG_DIST_TYPE_SPECIFIC_TEAM_DUELIST, NONE, NONE);
+	Set(MSG_MISSED_EFFECT, 0U, D::MSG_DIST_TYPE_SPECIFIC_TEAM_DUELIST, NONE, NONE);
+	Set(MSG_HINT, KEEPS | MSG_FLAG_INSPECT_DIST, D::MSG_DIST_TYPE_EVERYONE, NONE, NONE);
+	Set(MSG_CONFIRM_CARDS, MSG_FLAG_INSPECT_DIST, D::MSG_DIST_TYPE_EVERYONE, NONE, NONE);
+	Set(MSG_SHUFFLE_HAND, MSG_FLAG_INSPECT_POST, D::MSG_DIST_TYPE_EVERYONE_STRIPPED, NONE, NONE);
+	Set(MSG_SHUFFLE_EXTRA, MSG_FLAG_INSPECT_POST, D::MSG_DIST_TYPE_EVERYONE_STRIPPED, NONE, NONE);
+	Set(MSG_SET, 0U, D::MSG_DIST_TYPE_EVERYONE_STRIPPED, NONE, NONE);
+	Set(MSG_MOVE, MSG_FLAG_INSPECT_POST, D::MSG_DIST_TYPE_EVERYONE_STRIPPED, NONE, NONE);
+	Set(MSG_SPSUMMONING, CHANGES_ONE, D::MSG_DIST_TYPE_EVERYONE_STRIPPED, NONE, NONE);
+	Set(MSG_DRAW, MSG_FLAG_INSPECT_POST, D::MSG_DIST_TYPE_EVERYONE_STRIPPED, NONE, NONE);
+	Set(MSG_TAG_SWAP, MSG_FLAG_INSPECT_POST, D::MSG_DIST_TYPE_EVERYONE_STRIPPED, NONE, NONE);
+	Set(MSG_NEW_TURN, 0U, D::MSG_DIST_TYPE_EVERYONE, FIELD, NONE);
+	Set(MSG_NEW_PHASE, KEEPS, D::MSG_DIST_TYPE_EVERYONE, NONE, FIELD_AND_HANDS);
+	Set(MSG_FLIPSUMMONING, CHANGES_ONE | MSG_FLAG_INSPECT_PRE, D::MSG_DIST_TYPE_EVERYONE, NONE, NONE);
+	Set(MSG_SWAP_GRAVE_DECK, MSG_FLAG_INSPECT_POST, D::MSG_DIST_TYPE_EVERYONE, NONE, NONE);
+	Set(MSG_REVERSE_DECK, 0U, D::MSG_DIST_TYPE_EVERYONE, NONE, {R::REFRESH_DECKS});
+	Set(MSG_SHUFFLE_SET_CARD, MSG_FLAG_INSPECT_POST, D::MSG_DIST_TYPE_EVERYONE, NONE, NONE);
+	Set(MSG_DAMAGE_STEP_START, 0U, D::MSG_DIST_TYPE_EVERYONE, NONE, {R::REFRESH_MZONES});
+	Set(MSG_DAMAGE_STEP_END, 0U, D::MSG_DIST_TYPE_EVERYONE, NONE, {R::REFRESH_MZONES});
+	Set(MSG_SUMMONING, CHANGES_ONE, D::MSG_DIST_TYPE_EVERYONE, NONE, NONE);
+	Set(MSG_SUMMONED, 0U, D::MSG_DIST_TYPE_EVERYONE, NONE, FIELD);
+	Set(MSG_SPSUMMONED, 0U, D::MSG_DIST_TYPE_EVERYONE, NONE, FIELD);
+	Set(MSG_FLIPSUMMONED, 0U, D::MSG_DIST_TYPE_EVERYONE, NONE, FIELD);
+	Set(MSG_CHAINING, CHANGES_ONE, D::MSG_DIST_TYPE_EVERYONE, NONE, NONE);
+	Set(MSG_CHAINED, 0U, D::MSG_DIST_TYPE_EVERYONE, NONE, FIELD_AND_HANDS);
+	Set(MSG_CHAIN_END, 0U, D::MSG_DIST_TYPE_EVERYONE, NONE,
+		{R::REFRESH_DECKS, R::REFRESH_MZONES, R::REFRESH_SZONES, R::REFRESH_HANDS});
+	Set(MSG_CHAIN_SOLVING, 0U, D::MSG_DIST_TYPE_EVERYONE, NONE, NONE);
+	Set(MSG_CHAIN_SOLVED, 0U, D::MSG_DIST_TYPE_EVERYONE, NONE, NONE);
+	Set(MSG_POS_CHANGE, MSG_FLAG_INSPECT_POST, D::MSG_DIST_TYPE_EVERYONE, NONE, NONE);
+	Set(MSG_SWAP, MSG_FLAG_INSPECT_POST, D::MSG_DIST_TYPE_EVERYONE, NONE, NONE);
+	Set(MSG_RELOAD_FIELD, MSG_FLAG_INSPECT_POST, D::MSG_DIST_TYPE_EVERYONE, NONE, NONE);
+	return t;
+}();
+
+// Hints that are only meant for the duelist that has to answer a request.
+constexpr bool IsHintForDuelist(uint8_t hintType) noexcept
+{
+	switch(hintType)
+	{
+	case 1U: case 2U: case 3U: case 5U:
+	{
+		return true;
+	}
+	default:
+	{
+		return false;
+	}
+	}
+}
+
 /*** Query utility functions ***/
 
-inline void AddRefreshAllDecks(std::vector<QueryRequest>& qreqs) noexcept
+inline void AddRefreshAllDecks(QueryRequestVector& qreqs) noexcept
 {
 	qreqs.emplace_back(QueryLocationRequest{0U, LOCATION_DECK, 0x1181FFF});
 	qreqs.emplace_back(QueryLocationRequest{1U, LOCATION_DECK, 0x1181FFF});
 }
 
-inline void AddRefreshAllHands(std::vector<QueryRequest>& qreqs) noexcept
+inline void AddRefreshAllHands(QueryRequestVector& qreqs) noexcept
 {
 	qreqs.emplace_back(QueryLocationRequest{0U, LOCATION_HAND, 0x3781FFF});
 	qreqs.emplace_back(QueryLocationRequest{1U, LOCATION_HAND, 0x3781FFF});
 }
 
-inline void AddRefreshAllMZones(std::vector<QueryRequest>& qreqs) noexcept
+inline void AddRefreshAllMZones(QueryRequestVector& qreqs) noexcept
 {
 	qreqs.emplace_back(QueryLocationRequest{0U, LOCATION_MZONE, 0x3981FFF});
 	qreqs.emplace_back(QueryLocationRequest{1U, LOCATION_MZONE, 0x3981FFF});
 }
 
-inline void AddRefreshAllSZones(std::vector<QueryRequest>& qreqs) noexcept
+inline void AddRefreshAllSZones(QueryRequestVector& qreqs) noexcept
 {
 	qreqs.emplace_back(QueryLocationRequest{0U, LOCATION_SZONE, 0x3F81FFF});
 	qreqs.emplace_back(QueryLocationRequest{1U, LOCATION_SZONE, 0x3F81FFF});
 }
 
-inline QueryOpt DeserializeOneQuery(const uint8_t*& ptr) noexcept
+inline void AddRefreshes(QueryRequestVector& qreqs, const RefreshList& refreshes) noexcept
+{
+	for(const auto r : refreshes)
+	{
+		switch(r)
+		{
+		case Refresh::REFRESH_NONE:
+		{
+			return;
+		}
+		case Refresh::REFRESH_DECKS:
+		{
+			AddRefreshAllDecks(qreqs);
+			break;
+		}
+		case Refresh::REFRESH_HANDS:
+		{
+			AddRefreshAllHands(qreqs);
+			break;
+		}
+		case Refresh::REFRESH_MZONES:
+		{
+			AddRefreshAllMZones(qreqs);
+			break;
+		}
+		case Refresh::REFRESH_SZONES:
+		{
+			AddRefreshAllSZones(qreqs);
+			break;
+		}
+		}
+	}
+}
+
+inline QueryOpt DeserializeOneQuery(const uint8_t*& ptr, MemRes* mr) noexcept
 {
 	if(Read<uint16_t>(ptr) == 0U)
 		return std::nullopt;
 	ptr -= sizeof(uint16_t);
-	for(QueryOpt q = Query{};;)
+	for(QueryOpt q(std::in_place, mr);;)
 	{
 		auto size = Read<uint16_t>(ptr);
 		auto flag = Read<uint32_t>(ptr);
@@ -116,13 +301,210 @@ inline QueryOpt DeserializeOneQuery(const uint8_t*& ptr) noexcept
 	}
 }
 
+// Tells if the information of a query is known by everyone regardless of the
+// card being face-up or not.
+constexpr bool IsQueryAlwaysPublic(uint64_t flag) noexcept
+{
+	switch(flag)
+	{
+		case QUERY_CODE:
+		case QUERY_ALIAS:
+		case QUERY_TYPE:
+		case QUERY_LEVEL:
+		case QUERY_RANK:
+		case QUERY_ATTRIBUTE:
+		case QUERY_RACE:
+		case QUERY_ATTACK:
+		case QUERY_DEFENSE:
+		case QUERY_BASE_ATTACK:
+		case QUERY_BASE_DEFENSE:
+		case QUERY_STATUS:
+		case QUERY_LSCALE:
+		case QUERY_RSCALE:
+		case QUERY_LINK:
+		{
+			return false;
+		}
+		default:
+		{
+			return true;
+		}
+	}
+}
+
+// Size of the data of a query that can be copied as it is while rewriting,
+// or 0 if the query has to go through the whole deserialization instead.
+constexpr std::size_t RewritableQuerySize(uint32_t flag) noexcept
+{
+	switch(flag)
+	{
+		case QUERY_OWNER:
+		case QUERY_IS_PUBLIC:
+		case QUERY_IS_HIDDEN:
+		{
+			return sizeof(uint8_t);
+		}
+		case QUERY_CODE:
+		case QUERY_POSITION:
+		case QUERY_ALIAS:
+		case QUERY_TYPE:
+		case QUERY_LEVEL:
+		case QUERY_RANK:
+		case QUERY_ATTRIBUTE:
+		case QUERY_ATTACK:
+		case QUERY_DEFENSE:
+		case QUERY_BASE_ATTACK:
+		case QUERY_BASE_DEFENSE:
+		case QUERY_REASON:
+		case QUERY_STATUS:
+		case QUERY_LSCALE:
+		case QUERY_RSCALE:
+		case QUERY_COVER:
+		{
+			return sizeof(uint32_t);
+		}
+		case QUERY_RACE:
+		case QUERY_LINK:
+		{
+			return sizeof(uint64_t);
+		}
+		case QUERY_REASON_CARD:
+		case QUERY_EQUIP_CARD:
+		{
+			return LocInfo::SIZE;
+		}
+		// NOTE: Lists are serialized back with a different layout, and
+		// unknown queries are kept without their data, so neither of them
+		// can be copied.
+		default:
+		{
+			return 0U;
+		}
+	}
+}
+
+// Rewrites the query of a single card from a raw buffer into the owner and
+// stripped buffers. The card is first scanned to find what it reveals, and
+// then each query is copied to the buffers that should see it. Returns false
+// without consuming anything if the card has queries that can't be copied
+// or that are not in the order they would be serialized with.
+inline bool RewriteOneQuery(const uint8_t*& ptr, QueryBufferPair& qbp) noexcept
+{
+	struct Field
+	{
+		uint32_t flag;
+		const uint8_t* data;
+		std::size_t size;
+	};
+	const auto* p = ptr;
+	if(Read<uint16_t>(p) == 0U)
+	{
+		qbp.owner.resize(qbp.owner.size() + sizeof(uint16_t), uint8_t{0U});
+		qbp.stripped.resize(qbp.stripped.size() + sizeof(uint16_t), uint8_t{0U});
+		ptr = p;
+		return true;
+	}
+	p -= sizeof(uint16_t);
+	// NOTE: Flags are unique bits and must be strictly increasing, so there
+	// can't be more fields than bits.
+	std::array<Field, 32U> fields;
+	std::size_t count = 0U;
+	uint32_t flags = 0U;
+	uint32_t pos = 0U;
+	uint8_t isPublic = 0U;
+	uint8_t isHidden = 0U;
+	for(uint32_t flag = 0U; flag != QUERY_END; )
+	{
+		p += sizeof(uint16_t); // Size ignored, same as DeserializeOneQuery.
+		const auto next = Read<uint32_t>(p);
+		if(next <= flag)
+			return false;
+		flag = next;
+		std::size_t size = 0U;
+		if(flag != QUERY_END && (size = RewritableQuerySize(flag)) == 0U)
+			return false;
+		if(flag == QUERY_POSITION)
+			std::memcpy(&pos, p, sizeof(pos));
+		else if(flag == QUERY_IS_PUBLIC)
+			isPublic = *p;
+		else if(flag == QUERY_IS_HIDDEN)
+			isHidden = *p;
+		flags |= flag;
+		// NOTE: Same as SerializeSingleQuery, a location of 0 means that
+		// there is no card to refer to.
+		if((flag != QUERY_REASON_CARD && flag != QUERY_EQUIP_CARD) || p[1U] != 0U)
+			fields[count++] = {flag, p, size};
+		p += size;
+	}
+	const bool revealed = ((flags & QUERY_IS_PUBLIC) && isPublic) ||
+	                      ((flags & QUERY_POSITION) && (pos & POS_FACEUP));
+	const bool hidden = (flags & QUERY_IS_HIDDEN) && isHidden;
+	auto Append = [](QueryBuffer& qb, const Field& f)
+	{
+		const auto offset = qb.size();
+		qb.resize(offset + sizeof(uint16_t) + sizeof(uint32_t) + f.size);
+		auto* w = qb.data() + offset;
+		Write(w, static_cast<uint16_t>(f.size + sizeof(uint32_t)));
+		Write(w, f.flag);
+		std::memcpy(w, f.data, f.size);
+	};
+	for(std::size_t i = 0U; i < count; i++)
+	{
+		const auto& f = fields[i];
+		const bool isFieldPublic = revealed || IsQueryAlwaysPublic(f.flag);
+		if(hidden && !isFieldPublic)
+			continue;
+		Append(qbp.owner, f);
+		if(isFieldPublic)
+			Append(qbp.stripped, f);
+	}
+	ptr = p;
+	return true;
+}
+
+// Rewrites a single card, deserializing and serializing it again if it can't
+// be copied directly.
+inline void RewriteOneQuery(const uint8_t*& ptr, QueryBufferPair& qbp, MemRes* mr) noexcept
+{
+	if(RewriteOneQuery(ptr, qbp))
+		return;
+	const auto q = DeserializeOneQuery(ptr, mr);
+	const auto owner = SerializeSingleQuery(q, false, mr);
+	const auto stripped = SerializeSingleQuery(q, true, mr);
+	qbp.owner.insert(qbp.owner.end(), owner.cbegin(), owner.cend());
+	qbp.stripped.insert(qbp.stripped.end(), stripped.cbegin(), stripped.cend());
+}
+
+inline Msg MakeUpdateCardMsg(uint8_t con, uint32_t loc, uint32_t seq, const uint8_t* qb, std::size_t size, MemRes* mr) noexcept
+{
+	Msg msg(1U + 1U + 1U + 1U + size, mr);
+	auto* ptr = msg.data();
+	Write<uint8_t>(ptr, MSG_UPDATE_CARD);
+	Write<uint8_t>(ptr, con);
+	Write(ptr, static_cast<uint8_t>(loc));
+	Write(ptr, static_cast<uint8_t>(seq));
+	std::memcpy(ptr, qb, size);
+	return msg;
+}
+
+inline Msg MakeUpdateDataMsg(uint8_t con, uint32_t loc, const uint8_t* qb, std::size_t size, MemRes* mr) noexcept
+{
+	Msg msg(1U + 1U + 1U + size, mr);
+	auto* ptr = msg.data();
+	Write<uint8_t>(ptr, MSG_UPDATE_DATA);
+	Write<uint8_t>(ptr, con);
+	Write(ptr, static_cast<uint8_t>(loc));
+	std::memcpy(ptr, qb, size);
+	return msg;
+}
+
 /*** Header implementations ***/
 
-std::vector<Msg> SplitToMsgs(const Buffer& buffer) noexcept
+std::pmr::vector<Msg> SplitToMsgs(const Buffer& buffer, MemRes* mr) noexcept
 {
 	using length_t = uint32_t;
 	static constexpr std::size_t sizeOfLength = sizeof(length_t);
-	std::vector<Msg> msgs;
+	std::pmr::vector<Msg> msgs(mr);
 	if(buffer.empty())
 		return msgs;
 	const std::size_t bufSize = buffer.size();
@@ -148,81 +530,22 @@ uint8_t GetMessageType(const Msg& msg) noexcept
 
 bool DoesMessageRequireAnswer(uint8_t msgType) noexcept
 {
-	switch(msgType)
-	{
-	case MSG_SELECT_CARD:
-	case MSG_SELECT_TRIBUTE:
-	case MSG_SELECT_UNSELECT_CARD:
-	case MSG_SELECT_BATTLECMD:
-	case MSG_SELECT_IDLECMD:
-	case MSG_SELECT_EFFECTYN:
-	case MSG_SELECT_YESNO:
-	case MSG_SELECT_OPTION:
-	case MSG_SELECT_CHAIN:
-	case MSG_SELECT_PLACE:
-	case MSG_SELECT_DISFIELD:
-	case MSG_SELECT_POSITION:
-	case MSG_SORT_CARD:
-	case MSG_SORT_CHAIN:
-	case MSG_SELECT_COUNTER:
-	case MSG_SELECT_SUM:
-	case MSG_ROCK_PAPER_SCISSORS:
-	case MSG_ANNOUNCE_RACE:
-	case MSG_ANNOUNCE_ATTRIB:
-	case MSG_ANNOUNCE_CARD:
-	case MSG_ANNOUNCE_NUMBER:
-	case MSG_ANNOUNCE_CARD_FILTER:
-	{
-		return true;
-	}
-	default:
-	{
-		return false;
-	}
-	}
+	return (MSG_DESCRIPTORS[msgType].flags & MSG_FLAG_REQUIRES_ANSWER) != 0U;
 }
 
 MsgDistType GetMessageDistributionType(const Msg& msg) noexcept
 {
+	const auto& d = MSG_DESCRIPTORS[GetMessageType(msg)];
+	if((d.flags & MSG_FLAG_INSPECT_DIST) == 0U)
+		return d.distType;
 	switch(GetMessageType(msg))
 	{
-	case MSG_SELECT_CARD:
-	case MSG_SELECT_TRIBUTE:
-	case MSG_SELECT_UNSELECT_CARD:
-	{
-		return MsgDistType::MSG_DIST_TYPE_SPECIFIC_TEAM_DUELIST_STRIPPED;
-	}
-	case MSG_SELECT_BATTLECMD:
-	case MSG_SELECT_IDLECMD:
-	case MSG_SELECT_EFFECTYN:
-	case MSG_SELECT_YESNO:
-	case MSG_SELECT_OPTION:
-	case MSG_SELECT_CHAIN:
-	case MSG_SELECT_PLACE:
-	case MSG_SELECT_DISFIELD:
-	case MSG_SELECT_POSITION:
-	case MSG_SORT_CARD:
-	case MSG_SORT_CHAIN:
-	case MSG_SELECT_COUNTER:
-	case MSG_SELECT_SUM:
-	case MSG_ROCK_PAPER_SCISSORS:
-	case MSG_ANNOUNCE_RACE:
-	case MSG_ANNOUNCE_ATTRIB:
-	case MSG_ANNOUNCE_CARD:
-	case MSG_ANNOUNCE_NUMBER:
-	case MSG_ANNOUNCE_CARD_FILTER:
-	case MSG_MISSED_EFFECT:
-	{
-		return MsgDistType::MSG_DIST_TYPE_SPECIFIC_TEAM_DUELIST;
-	}
 	case MSG_HINT:
 	{
+		if(IsHintForDuelist(msg[1U]))
+			return MsgDistType::MSG_DIST_TYPE_SPECIFIC_TEAM_DUELIST;
 		switch(msg[1U])
 		{
-		case 1U: case 2U: case 3U: case 5U:
-		{
-			return MsgDistType::MSG_DIST_TYPE_SPECIFIC_TEAM_DUELIST;
-		}
 		case 200U:
 		{
 			return MsgDistType::MSG_DIST_TYPE_SPECIFIC_TEAM;
@@ -250,23 +573,36 @@ MsgDistType GetMessageDistributionType(const Msg& msg) noexcept
 		}
 		return MsgDistType::MSG_DIST_TYPE_EVERYONE;
 	}
-	case MSG_SHUFFLE_HAND:
-	case MSG_SHUFFLE_EXTRA:
-	case MSG_SET:
-	case MSG_MOVE:
-	case MSG_SPSUMMONING:
-	case MSG_DRAW:
-	case MSG_TAG_SWAP:
-	{
-		return MsgDistType::MSG_DIST_TYPE_EVERYONE_STRIPPED;
-	}
 	default:
 	{
-		return MsgDistType::MSG_DIST_TYPE_EVERYONE;
+		return d.distType;
 	}
 	}
 }
 
+bool IsMessageRecorded(const Msg& msg) noexcept
+{
+	const uint8_t msgType = GetMessageType(msg);
+	if(msgType == MSG_HINT)
+		return !IsHintForDuelist(msg[1U]);
+	return (MSG_DESCRIPTORS[msgType].flags & MSG_FLAG_NOT_RECORDED) == 0U;
+}
+
+bool DoesMessageKeepCards(uint8_t msgType) noexcept
+{
+	return (MSG_DESCRIPTORS[msgType].flags & MSG_FLAG_KEEPS_CARDS) != 0U;
+}
+
+std::optional<LocInfo> GetMessageChangedCard(const Msg& msg) noexcept
+{
+	if((MSG_DESCRIPTORS[GetMessageType(msg)].flags & MSG_FLAG_CHANGES_ONE_CARD) == 0U)
+		return std::nullopt;
+	const auto* ptr = msg.data();
+	ptr++; // type ignored
+	ptr += 4U; // Card code
+	return Read<LocInfo>(ptr);
+}
+
 uint8_t GetMessageReceivingTeam(const Msg& msg) noexcept
 {
 	switch(GetMessageType(msg))
@@ -282,8 +618,9 @@ uint8_t GetMessageReceivingTeam(const Msg& msg) noexcept
 	}
 }
 
-Msg StripMessageForTeam(uint8_t team, Msg msg) noexcept
+Msg StripMessageForTeam(uint8_t team, const Msg& original, MemRes* mr) noexcept
 {
+	Msg msg(original, mr);
 	auto IsLocInfoPublic = [](const LocInfo& info)
 	{
 		if(info.loc & (LOCATION_GRAVE | LOCATION_OVERLAY) &&
@@ -421,9 +758,9 @@ Msg StripMessageForTeam(uint8_t team, Msg msg) noexcept
 	return msg;
 }
 
-Msg MakeStartMsg(const MsgStartCreateInfo& info) noexcept
+Msg MakeStartMsg(const MsgStartCreateInfo& info, MemRes* mr) noexcept
 {
-	Msg msg(18U);
+	Msg msg(18U, mr);
 	auto* ptr = msg.data();
 	Write<uint8_t>(ptr, MSG_START);
 	Write<uint8_t>(ptr, 0U);
@@ -436,26 +773,15 @@ Msg MakeStartMsg(const MsgStartCreateInfo& info) noexcept
 	return msg;
 }
 
-std::vector<QueryRequest> GetPreDistQueryRequests(const Msg& msg) noexcept
+QueryRequestVector GetPreDistQueryRequests(const Msg& msg, MemRes* mr) noexcept
 {
-	std::vector<QueryRequest> qreqs;
+	QueryRequestVector qreqs(mr);
+	const auto& d = MSG_DESCRIPTORS[GetMessageType(msg)];
+	AddRefreshes(qreqs, d.preRefresh);
+	if((d.flags & MSG_FLAG_INSPECT_PRE) == 0U)
+		return qreqs;
 	switch(GetMessageType(msg))
 	{
-	case MSG_SELECT_BATTLECMD:
-	case MSG_SELECT_IDLECMD:
-	{
-		AddRefreshAllHands(qreqs);
-		AddRefreshAllMZones(qreqs);
-		AddRefreshAllSZones(qreqs);
-		break;
-	}
-	case MSG_SELECT_CHAIN:
-	case MSG_NEW_TURN:
-	{
-		AddRefreshAllMZones(qreqs);
-		AddRefreshAllSZones(qreqs);
-		break;
-	}
 	case MSG_FLIPSUMMONING:
 	{
 		const auto* ptr = msg.data();
@@ -469,11 +795,15 @@ std::vector<QueryRequest> GetPreDistQueryRequests(const Msg& msg) noexcept
 	return qreqs;
 }
 
-std::vector<QueryRequest> GetPostDistQueryRequests(const Msg& msg) noexcept
+QueryRequestVector GetPostDistQueryRequests(const Msg& msg, MemRes* mr) noexcept
 {
+	QueryRequestVector qreqs(mr);
+	const auto& d = MSG_DESCRIPTORS[GetMessageType(msg)];
+	AddRefreshes(qreqs, d.postRefresh);
+	if((d.flags & MSG_FLAG_INSPECT_POST) == 0U)
+		return qreqs;
 	const auto* ptr = msg.data();
 	ptr++; // type ignored
-	std::vector<QueryRequest> qreqs;
 	switch(GetMessageType(msg))
 	{
 	case MSG_SHUFFLE_HAND:
@@ -495,11 +825,6 @@ std::vector<QueryRequest> GetPostDistQueryRequests(const Msg& msg) noexcept
 		qreqs.emplace_back(QueryLocationRequest{player, LOCATION_GRAVE, 0x381FFF});
 		break;
 	}
-	case MSG_REVERSE_DECK:
-	{
-		AddRefreshAllDecks(qreqs);
-		break;
-	}
 	case MSG_SHUFFLE_SET_CARD:
 	{
 		auto loc = Read<uint8_t>(ptr);
@@ -507,36 +832,6 @@ std::vector<QueryRequest> GetPostDistQueryRequests(const Msg& msg) noexcept
 		qreqs.emplace_back(QueryLocationRequest{1U, loc, 0x3181FFF});
 		break;
 	}
-	case MSG_DAMAGE_STEP_START:
-	case MSG_DAMAGE_STEP_END:
-	{
-		AddRefreshAllMZones(qreqs);
-		break;
-	}
-	case MSG_SUMMONED:
-	case MSG_SPSUMMONED:
-	case MSG_FLIPSUMMONED:
-	{
-		AddRefreshAllMZones(qreqs);
-		AddRefreshAllSZones(qreqs);
-		break;
-	}
-	case MSG_NEW_PHASE:
-	case MSG_CHAINED:
-	{
-		AddRefreshAllMZones(qreqs);
-		AddRefreshAllSZones(qreqs);
-		AddRefreshAllHands(qreqs);
-		break;
-	}
-	case MSG_CHAIN_END:
-	{
-		AddRefreshAllDecks(qreqs);
-		AddRefreshAllMZones(qreqs);
-		AddRefreshAllSZones(qreqs);
-		AddRefreshAllHands(qreqs);
-		break;
-	}
 	case MSG_MOVE:
 	{
 		ptr += 4U; // Card code
@@ -598,48 +893,45 @@ std::vector<QueryRequest> GetPostDistQueryRequests(const Msg& msg) noexcept
 	return qreqs;
 }
 
-Msg MakeUpdateCardMsg(uint8_t con, uint32_t loc, uint32_t seq, const QueryBuffer& qb) noexcept
+Msg MakeUpdateCardMsg(uint8_t con, uint32_t loc, uint32_t seq, const Buffer& qb, MemRes* mr) noexcept
 {
-	Msg msg(1U + 1U + 1U + 1U + qb.size());
-	auto* ptr = msg.data();
-	Write<uint8_t>(ptr, MSG_UPDATE_CARD);
-	Write<uint8_t>(ptr, con);
-	Write(ptr, static_cast<uint8_t>(loc));
-	Write(ptr, static_cast<uint8_t>(seq));
-	std::memcpy(ptr, qb.data(), qb.size());
-	return msg;
+	return MakeUpdateCardMsg(con, loc, seq, qb.data(), qb.size(), mr);
 }
 
-Msg MakeUpdateDataMsg(uint8_t con, uint32_t loc, const QueryBuffer& qb) noexcept
+Msg MakeUpdateCardMsg(uint8_t con, uint32_t loc, uint32_t seq, const QueryBuffer& qb, MemRes* mr) noexcept
 {
-	Msg msg(1U + 1U + 1U + qb.size());
-	auto* ptr = msg.data();
-	Write<uint8_t>(ptr, MSG_UPDATE_DATA);
-	Write<uint8_t>(ptr, con);
-	Write(ptr, static_cast<uint8_t>(loc));
-	std::memcpy(ptr, qb.data(), qb.size());
-	return msg;
+	return MakeUpdateCardMsg(con, loc, seq, qb.data(), qb.size(), mr);
+}
+
+Msg MakeUpdateDataMsg(uint8_t con, uint32_t loc, const Buffer& qb, MemRes* mr) noexcept
+{
+	return MakeUpdateDataMsg(con, loc, qb.data(), qb.size(), mr);
 }
 
-QueryOpt DeserializeSingleQueryBuffer(const QueryBuffer& qb) noexcept
+Msg MakeUpdateDataMsg(uint8_t con, uint32_t loc, const QueryBuffer& qb, MemRes* mr) noexcept
+{
+	return MakeUpdateDataMsg(con, loc, qb.data(), qb.size(), mr);
+}
+
+QueryOpt DeserializeSingleQueryBuffer(const Buffer& qb, MemRes* mr) noexcept
 {
 	const auto* ptr = qb.data();
-	return DeserializeOneQuery(ptr);
+	return DeserializeOneQuery(ptr, mr);
 }
 
-QueryOptVector DeserializeLocationQueryBuffer(const QueryBuffer& qb) noexcept
+QueryOptVector DeserializeLocationQueryBuffer(const Buffer& qb, MemRes* mr) noexcept
 {
 	const auto* ptr = qb.data();
 	const auto* const ptrMax = ptr + Read<uint32_t>(ptr);
-	QueryOptVector ret;
+	QueryOptVector ret(mr);
 	while(ptr < ptrMax)
-		ret.emplace_back(DeserializeOneQuery(ptr));
+		ret.emplace_back(DeserializeOneQuery(ptr, mr));
 	return ret;
 }
 
-QueryBuffer SerializeSingleQuery(const QueryOpt& qOpt, bool isPublic) noexcept
+QueryBuffer SerializeSingleQuery(const QueryOpt& qOpt, bool isPublic, MemRes* mr) noexcept
 {
-	QueryBuffer qb;
+	QueryBuffer qb(mr);
 	if(!qOpt.has_value()) // Nothing to serialize.
 	{
 		qb.resize(sizeof(uint16_t), uint8_t{0U});
@@ -654,31 +946,7 @@ QueryBuffer SerializeSingleQuery(const QueryOpt& qOpt, bool isPublic) noexcept
 			return true;
 		if((q.flags & QUERY_POSITION) && (q.pos & POS_FACEUP))
 			return true;
-		switch(flag)
-		{
-			case QUERY_CODE:
-			case QUERY_ALIAS:
-			case QUERY_TYPE:
-			case QUERY_LEVEL:
-			case QUERY_RANK:
-			case QUERY_ATTRIBUTE:
-			case QUERY_RACE:
-			case QUERY_ATTACK:
-			case QUERY_DEFENSE:
-			case QUERY_BASE_ATTACK:
-			case QUERY_BASE_DEFENSE:
-			case QUERY_STATUS:
-			case QUERY_LSCALE:
-			case QUERY_RSCALE:
-			case QUERY_LINK:
-			{
-				return false;
-			}
-			default:
-			{
-				return true;
-			}
-		}
+		return IsQueryAlwaysPublic(flag);
 	};
 	auto ComputeQuerySize = [&q](uint64_t flag) constexpr -> std::size_t
 	{
@@ -841,13 +1109,13 @@ QueryBuffer SerializeSingleQuery(const QueryOpt& qOpt, bool isPublic) noexcept
 	return qb;
 }
 
-QueryBuffer SerializeLocationQuery(const QueryOptVector& qs, bool isPublic) noexcept
+QueryBuffer SerializeLocationQuery(const QueryOptVector& qs, bool isPublic, MemRes* mr) noexcept
 {
 	uint32_t totalSize = 0U;
-	QueryBuffer qb(sizeof(decltype(totalSize)));
+	QueryBuffer qb(sizeof(decltype(totalSize)), mr);
 	for(const auto& q : qs)
 	{
-		const auto singleQb = SerializeSingleQuery(q, isPublic);
+		const auto singleQb = SerializeSingleQuery(q, isPublic, mr);
 		totalSize += static_cast<uint32_t>(singleQb.size());
 		qb.insert(qb.end(), singleQb.begin(), singleQb.end());
 	}
@@ -855,4 +1123,34 @@ QueryBuffer SerializeLocationQuery(const QueryOptVector& qs, bool isPublic) noex
 	return qb;
 }
 
+QueryBufferPair RewriteSingleQueryBuffer(const Buffer& qb, MemRes* mr) noexcept
+{
+	QueryBufferPair qbp{QueryBuffer(mr), QueryBuffer(mr)};
+	// NOTE: Stripping only ever removes data, so the buffers can't grow past
+	// the size of the original one.
+	qbp.owner.reserve(qb.size());
+	qbp.stripped.reserve(qb.size());
+	const auto* ptr = qb.data();
+	RewriteOneQuery(ptr, qbp, mr);
+	return qbp;
+}
+
+QueryBufferPair RewriteLocationQueryBuffer(const Buffer& qb, MemRes* mr) noexcept
+{
+	using length_t = uint32_t;
+	QueryBufferPair qbp{QueryBuffer(sizeof(length_t), mr), QueryBuffer(sizeof(length_t), mr)};
+	qbp.owner.reserve(qb.size());
+	qbp.stripped.reserve(qb.size());
+	const auto* ptr = qb.data();
+	const auto* const ptrMax = ptr + Read<uint32_t>(ptr);
+	while(ptr < ptrMax)
+		RewriteOneQuery(ptr, qbp, mr);
+	for(auto* b : {&qbp.owner, &qbp.stripped})
+	{
+		const auto totalSize = static_cast<length_t>(b->size() - sizeof(length_t));
+		std::memcpy(b->data(), &totalSize, sizeof(length_t));
+	}
+	return qbp;
+}
+
 } // namespace YGOPro::CoreUtils
@@ -1,6 +1,7 @@
 #ifndef YGOPRO_COREUTILS_HPP
 #define YGOPRO_COREUTILS_HPP
 #include <cstdint>
+#include <memory_resource>
 #include <optional>
 #include <variant>
 #include <vector>
@@ -53,48 +54,68 @@ struct QueryLocationRequest
 
 struct Query
 {
-	uint32_t flags;
-	uint32_t code;
-	uint32_t pos;
-	uint32_t alias;
-	uint32_t type;
-	uint32_t level;
-	uint32_t rank;
-	uint32_t link;
-	uint32_t attribute;
-	uint64_t race;
-	int32_t attack;
-	int32_t defense;
-	int32_t bAttack;
-	int32_t bDefense;
-	uint32_t reason;
-	uint8_t owner;
-	uint32_t status;
-	uint8_t isPublic;
-	uint32_t lscale;
-	uint32_t rscale;
-	uint32_t linkMarker;
-	LocInfo reasonCard;
-	LocInfo equipCard;
-	uint8_t isHidden;
-	uint32_t cover;
-	std::vector<LocInfo> targets;
-	std::vector<uint32_t> overlays;
-	std::vector<uint32_t> counters;
+	uint32_t flags{};
+	uint32_t code{};
+	uint32_t pos{};
+	uint32_t alias{};
+	uint32_t type{};
+	uint32_t level{};
+	uint32_t rank{};
+	uint32_t link{};
+	uint32_t attribute{};
+	uint64_t race{};
+	int32_t attack{};
+	int32_t defense{};
+	int32_t bAttack{};
+	int32_t bDefense{};
+	uint32_t reason{};
+	uint8_t owner{};
+	uint32_t status{};
+	uint8_t isPublic{};
+	uint32_t lscale{};
+	uint32_t rscale{};
+	uint32_t linkMarker{};
+	LocInfo reasonCard{};
+	LocInfo equipCard{};
+	uint8_t isHidden{};
+	uint32_t cover{};
+	std::pmr::vector<LocInfo> targets;
+	std::pmr::vector<uint32_t> overlays;
+	std::pmr::vector<uint32_t> counters;
+
+	Query() noexcept = default;
+
+	explicit Query(std::pmr::memory_resource* mr) noexcept :
+		targets(mr),
+		overlays(mr),
+		counters(mr)
+	{}
 };
 
-using Buffer = std::vector<uint8_t>;
-using Msg = std::vector<uint8_t>;
-using QueryBuffer = std::vector<uint8_t>;
+// NOTE: Every function that allocates takes the memory resource to use for
+// what it returns, so callers can keep short-lived data in a scratch arena.
+using MemRes = std::pmr::memory_resource;
+
+using Buffer = std::vector<uint8_t>; // As returned by the core.
+using Msg = std::pmr::vector<uint8_t>;
+using QueryBuffer = std::pmr::vector<uint8_t>;
 using QueryRequest = std::variant<QuerySingleRequest, QueryLocationRequest>;
+using QueryRequestVector = std::pmr::vector<QueryRequest>;
 using QueryOpt = std::optional<Query>;
-using QueryOptVector = std::vector<QueryOpt>;
+using QueryOptVector = std::pmr::vector<QueryOpt>;
+
+// Query buffers as sent to the controller of the cards and to everyone else.
+struct QueryBufferPair
+{
+	QueryBuffer owner;
+	QueryBuffer stripped;
+};
 
 // Takes the buffer you would get from OCG_DuelGetMessage and splits it
 // into individual core messages (which are still just buffers).
 // This operation also removes the length bytes (first 2 bytes) as that
 // can be retrieved back from Msg's size() method.
-std::vector<Msg> SplitToMsgs(const Buffer& buffer) noexcept;
+std::pmr::vector<Msg> SplitToMsgs(const Buffer& buffer, MemRes* mr = std::pmr::get_default_resource()) noexcept;
 
 // Takes any core message, reads and returns its type (1st byte)
 uint8_t GetMessageType(const Msg& msg) noexcept;
@@ -107,46 +128,65 @@ bool DoesMessageRequireAnswer(uint8_t msgType) noexcept;
 // distributed to clients and if it should have knowledge stripped.
 MsgDistType GetMessageDistributionType(const Msg& msg) noexcept;
 
+// Tells if the message should be stored on replays.
+bool IsMessageRecorded(const Msg& msg) noexcept;
+
+// Tells if clients keep the cards as they were after receiving a message of
+// this type, meaning that the data previously queried is still current.
+bool DoesMessageKeepCards(uint8_t msgType) noexcept;
+
+// Tells where the only card changed on clients by the message is, if the
+// message is known to change a single card and keep every other one.
+std::optional<LocInfo> GetMessageChangedCard(const Msg& msg) noexcept;
+
 // Tells which team should receive this message.
 // The behavior is undefined if the message is not for a specific team.
 uint8_t GetMessageReceivingTeam(const Msg& msg) noexcept;
 
 // Removes knowledge from a message if it shouldn't be known
 // by the argument `team`, returns a new copy of the message, modified.
-Msg StripMessageForTeam(uint8_t team, Msg msg) noexcept;
+Msg StripMessageForTeam(uint8_t team, const Msg& msg, MemRes* mr = std::pmr::get_default_resource()) noexcept;
 
 // Creates MSG_START, which is the first message recorded onto the replay
 // and the first one sent to clients, it setups the piles with the correct
 // amount of cards and sets the LP to the correct amount.
-Msg MakeStartMsg(const MsgStartCreateInfo& info) noexcept;
+Msg MakeStartMsg(const MsgStartCreateInfo& info, MemRes* mr = std::pmr::get_default_resource()) noexcept;
 
 // The following functions process the message and acquires the query requests
 // that are necessary either before distribution or after, respectively.
-std::vector<QueryRequest> GetPreDistQueryRequests(const Msg& msg) noexcept;
-std::vector<QueryRequest> GetPostDistQueryRequests(const Msg& msg) noexcept;
+QueryRequestVector GetPreDistQueryRequests(const Msg& msg, MemRes* mr = std::pmr::get_default_resource()) noexcept;
+QueryRequestVector GetPostDistQueryRequests(const Msg& msg, MemRes* mr = std::pmr::get_default_resource()) noexcept;
 
 // Creates MSG_UPDATE_CARD, which is a message that wraps around a single card
-// query from a duel.
-Msg MakeUpdateCardMsg(uint8_t con, uint32_t loc, uint32_t seq, const QueryBuffer& qb) noexcept;
+// query from a duel, either straight from the core or re-serialized.
+Msg MakeUpdateCardMsg(uint8_t con, uint32_t loc, uint32_t seq, const Buffer& qb, MemRes* mr = std::pmr::get_default_resource()) noexcept;
+Msg MakeUpdateCardMsg(uint8_t con, uint32_t loc, uint32_t seq, const QueryBuffer& qb, MemRes* mr = std::pmr::get_default_resource()) noexcept;
 
 // Creates MSG_UPDATE_DATA, which is a message that wraps around queries
-// from a duel.
-Msg MakeUpdateDataMsg(uint8_t con, uint32_t loc, const QueryBuffer& qb) noexcept;
+// from a duel, either straight from the core or re-serialized.
+Msg MakeUpdateDataMsg(uint8_t con, uint32_t loc, const Buffer& qb, MemRes* mr = std::pmr::get_default_resource()) noexcept;
+Msg MakeUpdateDataMsg(uint8_t con, uint32_t loc, const QueryBuffer& qb, MemRes* mr = std::pmr::get_default_resource()) noexcept;
 
 // Creates a query object which is populated with the information from the
-// passed QueryBuffer.
-QueryOpt DeserializeSingleQueryBuffer(const QueryBuffer& qb) noexcept;
+// passed query buffer, as returned by the core.
+QueryOpt DeserializeSingleQueryBuffer(const Buffer& qb, MemRes* mr = std::pmr::get_default_resource()) noexcept;
 
 // Creates a vector with multiple query objects which are populated with
-// the information from the passed QueryBuffer.
-QueryOptVector DeserializeLocationQueryBuffer(const QueryBuffer& qb) noexcept;
+// the information from the passed query buffer, as returned by the core.
+QueryOptVector DeserializeLocationQueryBuffer(const Buffer& qb, MemRes* mr = std::pmr::get_default_resource()) noexcept;
 
 // Creates a QueryBuffer which might have information stripped if it had the
 // hidden flag set, aditionally, that flag can be overriden with isPublic.
-QueryBuffer SerializeSingleQuery(const QueryOpt& qOpt, bool isPublic) noexcept;
+QueryBuffer SerializeSingleQuery(const QueryOpt& qOpt, bool isPublic, MemRes* mr = std::pmr::get_default_resource()) noexcept;
 
 // Same as the above function, but for all the queries in the vector.
-QueryBuffer SerializeLocationQuery(const QueryOptVector& qs, bool isPublic) noexcept;
+QueryBuffer SerializeLocationQuery(const QueryOptVector& qs, bool isPublic, MemRes* mr = std::pmr::get_default_resource()) noexcept;
+
+// Produces the same buffers as deserializing the query buffer and then
+// serializing it both privately and publicly, but in a single pass over the
+// raw buffer, without building query objects for most cards.
+QueryBufferPair RewriteSingleQueryBuffer(const Buffer& qb, MemRes* mr = std::pmr::get_default_resource()) noexcept;
+QueryBufferPair RewriteLocationQueryBuffer(const Buffer& qb, MemRes* mr = std::pmr::get_default_resource()) noexcept;
 
 } // namespace YGOPro::CoreUtils
 
@@ -0,0 +1,380 @@
+#include "DeckValidator.hpp"
+
+#include <algorithm> // std::lower_bound, std::sort
+#include <array>
+#include <limits>
+#include <memory_resource>
+#include <random>
+
+#include "Banlist.hpp"
+#include "Constants.hpp"
+#include "MsgCommon.hpp"
+#include "../Metrics.hpp"
+
+namespace YGOPro
+{
+
+namespace Metrics = Ignis::Multirole::Metrics;
+
+namespace
+{
+
+constexpr int32_t NO_LIMIT = std::numeric_limits<int32_t>::max();
+constexpr uint64_t DUEL_EXTRA_DECK_RITUAL = 0x800000000ULL;
+
+// Alternate artworks are aliased to a code close to their own, unlike cards
+// that are merely treated as another card.
+constexpr bool IsInArtworkRange(uint32_t code, uint32_t alias) noexcept
+{
+	constexpr uint32_t ID_MAX_DISTANCE_HALF = 10U;
+	if(alias == 0U)
+		return false;
+	return (alias - code < ID_MAX_DISTANCE_HALF) ||
+	       (code - alias < ID_MAX_DISTANCE_HALF);
+}
+
+// Maximum amount of copies of the card allowed by the banlist. Cards not on
+// it are looked up through their alias, unless the banlist is a whitelist and
+// they are not alternate artworks, and if still not found they are either
+// not allowed at all (whitelist) or not limited (blacklist).
+int32_t LimitOf(const CardSummary& card, const Banlist& bl) noexcept
+{
+	const int32_t* count = bl.Find(card.code);
+	if(count == nullptr && card.alias != 0U && (!bl.IsWhitelist() || IsInArtworkRange(card.code, card.alias)))
+		count = bl.Find(card.alias);
+	if(count != nullptr)
+		return *count;
+	return bl.IsWhitelist() ? -1 : NO_LIMIT;
+}
+
+//	true if card scope is unnofficial and not allowed.
+constexpr bool CheckUnofficial(uint32_t scope, uint8_t allowed) noexcept
+{
+	switch(allowed)
+	{
+	case ALLOWED_CARDS_OCG_ONLY:
+	case ALLOWED_CARDS_TCG_ONLY:
+	case ALLOWED_CARDS_OCG_TCG:
+		return scope > SCOPE_OCG_TCG;
+	case ALLOWED_CARDS_WITH_PRERELEASE:
+		return (scope & (~SCOPE_OFFICIAL)) != 0U;
+	default:
+		return false;
+	}
+}
+
+//	true if card scope is prerelease and they are not allowed.
+constexpr bool CheckPrelease(uint32_t scope, uint8_t allowed) noexcept
+{
+	return allowed == ALLOWED_CARDS_WITH_PRERELEASE &&
+	       ((scope & SCOPE_OFFICIAL) == 0U);
+}
+
+//	true if only ocg are allowed and scope is not ocg (its tcg).
+constexpr bool CheckOCG(uint32_t scope, uint8_t allowed) noexcept
+{
+	return allowed == ALLOWED_CARDS_OCG_ONLY && ((scope & SCOPE_OCG) == 0U);
+}
+
+//	true if only tcg are allowed and scope is not tcg (its ocg).
+constexpr bool CheckTCG(uint32_t scope, uint8_t allowed) noexcept
+{
+	return allowed == ALLOWED_CARDS_TCG_ONLY && ((scope & SCOPE_TCG) == 0U);
+}
+
+// Fibonacci hashing, the top bits of the product are well mixed even for
+// codes that are close to each other.
+constexpr std::size_t Hash(uint32_t code, uint32_t shift) noexcept
+{
+	return (shift == 32U) ? 0U : (code * 0x9E3779B1U) >> shift;
+}
+
+// Finalizer of SplitMix64.
+constexpr uint64_t Mix(uint64_t z) noexcept
+{
+	z = (z ^ (z >> 30U)) * 0xBF58476D1CE4E5B9U;
+	z = (z ^ (z >> 27U)) * 0x94D049BB133111EBU;
+	return z ^ (z >> 31U);
+}
+
+uint64_t RandomSeed()
+{
+	std::random_device rd;
+	return (static_cast<uint64_t>(rd()) << 32U) | rd();
+}
+
+} // namespace
+
+DeckValidator::DeckValidator(std::shared_ptr<const CardTable> cards, const Banlist* banlist) :
+	cards(std::move(cards)),
+	shift(32U),
+	seed(RandomSeed()),
+	cache()
+{
+	const auto& table = *this->cards;
+	limits.reserve(table.size());
+	for(const auto& card : table)
+		limits.push_back((banlist != nullptr) ? LimitOf(card, *banlist) : NO_LIMIT);
+	// NOTE: Kept at most half full so probe sequences stay short.
+	std::size_t capacity = 1U;
+	for(; capacity < table.size() * 2U; capacity *= 2U)
+		shift--;
+	slots.resize(capacity);
+	for(std::size_t i = 0U; i < table.size(); i++)
+	{
+		auto slot = Hash(table[i].code, shift);
+		while(slots[slot] != 0U)
+			slot = (slot + 1U) & (capacity - 1U);
+		slots[slot] = static_cast<uint32_t>(i + 1U);
+	}
+}
+
+Deck DeckValidator::Load(const CodeVector& main, const CodeVector& side, uint64_t duelFlags) const
+{
+	auto IsExtraDeckCardType = [&](uint32_t type) constexpr -> bool
+	{
+		if((type & (TYPE_FUSION | TYPE_SYNCHRO | TYPE_XYZ)) != 0U)
+			return true;
+		// NOTE: Link Spells exist.
+		if(((type & TYPE_LINK) != 0U) && ((type & TYPE_MONSTER) != 0U))
+			return true;
+		// In Rush, Ritual Monsters are placed in the Extra Deck
+		if ((type & TYPE_RITUAL) != 0U && (type & TYPE_MONSTER) != 0U && (duelFlags & DUEL_EXTRA_DECK_RITUAL) != 0U)
+			return true;
+
+		return false;
+	};
+	CodeVector m;
+	CodeVector e;
+	CodeVector s;
+	uint32_t err = 0U;
+	for(const auto code : main)
+	{
+		const auto i = Find(code);
+		if(i == cards->size())
+		{
+			err = code;
+			continue;
+		}
+		const auto type = (*cards)[i].type;
+		if((type & TYPE_TOKEN) != 0U)
+			continue;
+		if(IsExtraDeckCardType(type))
+			e.push_back(code);
+		else
+			m.push_back(code);
+	}
+	for(const auto code : side)
+	{
+		const auto i = Find(code);
+		if(i == cards->size())
+		{
+			err = code;
+			continue;
+		}
+		if(((*cards)[i].type & TYPE_TOKEN) != 0U)
+			continue;
+		s.push_back(code);
+	}
+	return {std::move(m), std::move(e), std::move(s), err};
+}
+
+DeckValidator::Result DeckValidator::Check(const Deck& deck, const HostInfo& hostInfo) const noexcept
+{
+	const std::size_t unknown = cards->size();
+	// Check if the deck had any error while loading.
+	if(const auto error = deck.Error(); error != 0U)
+		return {Problem::CARD_UNKNOWN, error};
+	// Look up every card once, keeping the order of the piles.
+	// NOTE: The scratch buffer fits the piles of any regular deck, only
+	// bigger ones need to allocate.
+	const std::size_t mainSize = deck.Main().size();
+	const std::size_t extraSize = deck.Extra().size();
+	const std::size_t sideSize = deck.Side().size();
+	std::array<std::byte, 4096U> buffer;
+	std::pmr::monotonic_buffer_resource mr(buffer.data(), buffer.size());
+	std::pmr::vector<uint32_t> indices(&mr);
+	indices.reserve(mainSize + extraSize + sideSize);
+	const uint32_t* unknownCode = nullptr;
+	for(const auto* pile : {&deck.Main(), &deck.Extra(), &deck.Side()})
+	{
+		for(const auto& code : *pile)
+		{
+			const auto i = Find(code);
+			if(i == unknown && unknownCode == nullptr)
+				unknownCode = &code;
+			indices.push_back(static_cast<uint32_t>(i));
+		}
+	}
+	// Get the total amount of skill cards in the main deck as they should not
+	// be counted for the total main deck size.
+	std::size_t skillsCount = 0U;
+	for(std::size_t n = 0U; n < mainSize; n++)
+		if(const auto i = indices[n]; i != unknown)
+			skillsCount += ((*cards)[i].type & TYPE_SKILL) != 0U;
+	// Check if the deck obeys the size limits.
+	auto OutOfBound = [](const DeckLimits::Boundary& lim, std::size_t count) constexpr -> bool
+	{
+		return count < lim.min || count > lim.max;
+	};
+	const auto& lim = hostInfo.limits;
+	if(const auto count = mainSize - skillsCount; OutOfBound(lim.main, count))
+		return {Problem::DECK_BAD_MAIN_COUNT, static_cast<uint32_t>(count)};
+	if(OutOfBound(lim.extra, extraSize))
+		return {Problem::DECK_BAD_EXTRA_COUNT, static_cast<uint32_t>(extraSize)};
+	if(OutOfBound(lim.side, sideSize))
+		return {Problem::DECK_BAD_SIDE_COUNT, static_cast<uint32_t>(sideSize)};
+	// If only the deck sizes have to be checked, stop here.
+	if(hostInfo.dontCheckDeckContent != 0U)
+		return {Problem::NONE, 0U};
+	// Check that there is no more than 1 skill on the deck.
+	if(skillsCount > 1U)
+		return {Problem::DECK_TOO_MANY_SKILLS, 0U};
+	// Check that there is only 1 Legend amongst both Main and Extra deck. We
+	// use unaliased card codes to accomplish this as aliased codes could be
+	// wrongly counted for Legend count, when they are not Legend.
+	uint32_t currentLegends = 0U;
+	for(std::size_t n = 0U; n < mainSize + extraSize; n++)
+	{
+		const auto i = indices[n];
+		if(i == unknown || ((*cards)[i].scope & SCOPE_LEGEND) == 0U)
+			continue;
+		const auto cardType = (*cards)[i].type & (TYPE_MONSTER | TYPE_SPELL | TYPE_TRAP);
+		if((cardType & currentLegends) != 0U)
+			return {Problem::DECK_TOO_MANY_LEGENDS, 0U};
+		currentLegends |= cardType;
+	}
+	// NOTE: Decks made by Load never have unknown cards.
+	if(unknownCode != nullptr)
+		return {Problem::CARD_UNKNOWN, *unknownCode};
+	// Check per-code properties. The indices of every card are sorted, which
+	// sorts them by code as well, and then each distinct card is counted.
+	std::sort(indices.begin(), indices.end());
+	using Count = std::pair<uint32_t, uint32_t>;
+	std::pmr::vector<Count> counts(&mr); // Card index and copies.
+	std::pmr::vector<Count> totals(&mr); // Aliased card code and copies.
+	counts.reserve(indices.size());
+	totals.reserve(indices.size());
+	for(const auto i : indices)
+	{
+		if(!counts.empty() && counts.back().first == i)
+			counts.back().second++;
+		else
+			counts.emplace_back(i, 1U);
+	}
+	// Check for forbidden types before aliasing.
+	const auto forb = static_cast<uint32_t>(hostInfo.forb);
+	for(const auto& [i, count] : counts)
+	{
+		const auto& card = (*cards)[i];
+		if((card.type & forb) != 0U)
+			return {Problem::CARD_FORBIDDEN_TYPE, 0U};
+		totals.emplace_back((card.alias != 0U) ? card.alias : card.code, count);
+	}
+	// Sum the copies of the cards that are aliased to the same code.
+	std::sort(totals.begin(), totals.end());
+	std::size_t distinct = 0U;
+	for(const auto& t : totals)
+	{
+		if(distinct != 0U && totals[distinct - 1U].first == t.first)
+			totals[distinct - 1U].second += t.second;
+		else
+			totals[distinct++] = t;
+	}
+	totals.resize(distinct);
+	auto GetTotalCount = [&](const CardSummary& card) -> uint32_t
+	{
+		const uint32_t code = (card.alias != 0U) ? card.alias : card.code;
+		return std::lower_bound(totals.cbegin(), totals.cend(), Count{code, 0U})->second;
+	};
+	const uint8_t allowed = hostInfo.allowed;
+	for(const auto& [i, count] : counts)
+	{
+		const auto& card = (*cards)[i];
+		const uint32_t totalCount = GetTotalCount(card);
+		if(totalCount > 3U)
+			return {Problem::CARD_MORE_THAN_3, card.code};
+		if(CheckUnofficial(card.scope, allowed))
+			return {Problem::CARD_UNOFFICIAL, card.code};
+		if(CheckPrelease(card.scope, allowed))
+			return {Problem::CARD_UNOFFICIAL, card.code};
+		if(CheckOCG(card.scope, allowed))
+			return {Problem::CARD_TCG_ONLY, card.code};
+		if(CheckTCG(card.scope, allowed))
+			return {Problem::CARD_OCG_ONLY, card.code};
+		if(static_cast<int32_t>(totalCount) > limits[i])
+			return {Problem::CARD_BANLISTED, card.code};
+	}
+	return {Problem::NONE, 0U};
+}
+
+DeckValidator::Result DeckValidator::CachedCheck(const Deck& deck, const HostInfo& hostInfo) const noexcept
+{
+	const auto key = KeyOf(deck, hostInfo);
+	auto& shard = cache[key.first % CACHE_SHARD_COUNT];
+	auto& entry = shard.entries[(key.first / CACHE_SHARD_COUNT) % shard.entries.size()];
+	{
+		std::scoped_lock lock(shard.m);
+		if(entry.key == key)
+		{
+			Metrics::Add(Metrics::Counter::DECK_CHECK_CACHE_HITS);
+			return entry.result;
+		}
+	}
+	Metrics::Add(Metrics::Counter::DECK_CHECK_CACHE_MISSES);
+	const auto result = Check(deck, hostInfo);
+	std::scoped_lock lock(shard.m);
+	entry = {key, result};
+	return result;
+}
+
+DeckValidator::CacheKey DeckValidator::KeyOf(const Deck& deck, const HostInfo& hostInfo) const noexcept
+{
+	// Each card is hashed along with its pile and the hashes are added up,
+	// so the order of the cards doesn't matter but their amount does.
+	const uint64_t seed2 = Mix(seed);
+	uint64_t h1 = 0U;
+	uint64_t h2 = 0U;
+	uint64_t pile = 0U;
+	for(const auto* codes : {&deck.Main(), &deck.Extra(), &deck.Side()})
+	{
+		pile++;
+		for(const auto code : *codes)
+		{
+			const uint64_t x = (pile << 32U) | code;
+			h1 += Mix(x ^ seed);
+			h2 += Mix(x ^ seed2);
+		}
+	}
+	const auto& lim = hostInfo.limits;
+	const uint64_t options[] =
+	{
+		static_cast<uint64_t>(lim.main.min) | (static_cast<uint64_t>(lim.main.max) << 16U) |
+		(static_cast<uint64_t>(lim.extra.min) << 32U) | (static_cast<uint64_t>(lim.extra.max) << 48U),
+		static_cast<uint64_t>(lim.side.min) | (static_cast<uint64_t>(lim.side.max) << 16U) |
+		(static_cast<uint64_t>(hostInfo.allowed) << 32U) | (static_cast<uint64_t>(hostInfo.dontCheckDeckContent) << 40U),
+		static_cast<uint32_t>(hostInfo.forb) | (static_cast<uint64_t>(deck.Error()) << 32U),
+	};
+	for(const auto o : options)
+	{
+		h1 = Mix(h1 ^ o ^ seed);
+		h2 = Mix(h2 ^ o ^ seed2);
+	}
+	// NOTE: Never zero, which is the key of the slots never used.
+	return {h1, h2 | 1U};
+}
+
+std::size_t DeckValidator::Find(uint32_t code) const noexcept
+{
+	const std::size_t mask = slots.size() - 1U;
+	for(auto slot = Hash(code, shift);; slot = (slot + 1U) & mask)
+	{
+		const uint32_t i = slots[slot];
+		if(i == 0U)
+			return cards->size();
+		if((*cards)[i - 1U].code == code)
+			return i - 1U;
+	}
+}
+
+} // namespace YGOPro
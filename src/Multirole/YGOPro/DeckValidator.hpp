@@ -0,0 +1,107 @@
+#ifndef YGOPRO_DECKVALIDATOR_HPP
+#define YGOPRO_DECKVALIDATOR_HPP
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility> // std::pair
+#include <vector>
+
+#include "CardDatabase.hpp"
+#include "Deck.hpp"
+
+namespace YGOPro
+{
+
+class Banlist;
+struct HostInfo;
+
+// Loads and checks decks against a snapshot of a card database and a banlist.
+// Everything needed is read up front into flat tables sorted by card code,
+// the banlist limit of each card already resolved through its alias, and
+// indexed by an open addressing hash table, so checking a deck only looks up
+// each card once, sorts them and goes through them once, without taking any
+// lock nor allocating memory for regular sized decks.
+class DeckValidator final
+{
+public:
+	using CardTable = std::vector<CardSummary>;
+
+	// NOTE: Same values as the deck errors sent to clients.
+	enum class Problem : uint8_t
+	{
+		NONE                  = 0x0,
+		CARD_BANLISTED        = 0x1,
+		CARD_OCG_ONLY         = 0x2,
+		CARD_TCG_ONLY         = 0x3,
+		CARD_UNKNOWN          = 0x4,
+		CARD_MORE_THAN_3      = 0x5,
+		DECK_BAD_MAIN_COUNT   = 0x6,
+		DECK_BAD_EXTRA_COUNT  = 0x7,
+		DECK_BAD_SIDE_COUNT   = 0x8,
+		CARD_FORBIDDEN_TYPE   = 0x9,
+		CARD_UNOFFICIAL       = 0xA,
+		DECK_TOO_MANY_LEGENDS = 0xC,
+		DECK_TOO_MANY_SKILLS  = 0xD,
+	};
+
+	struct Result
+	{
+		Problem problem;
+		uint32_t value; // Card code, or pile size for DECK_BAD_*_COUNT.
+	};
+
+	// NOTE: `banlist` is only read during construction, nullptr means
+	// that no banlist is used.
+	DeckValidator(std::shared_ptr<const CardTable> cards, const Banlist* banlist);
+
+	// Sorts the cards into main, extra and side deck piles, skipping tokens
+	// and setting the deck error to the last unknown card code found.
+	Deck Load(const CodeVector& main, const CodeVector& side, uint64_t duelFlags) const;
+
+	// Finds the first problem the deck has on a room with the given options.
+	Result Check(const Deck& deck, const HostInfo& hostInfo) const noexcept;
+
+	// Same as Check, but remembers the results of recently checked decks,
+	// as the same decks tend to be submitted over and over. Validators are
+	// replaced whenever the databases or banlists are reloaded, and so are
+	// the results they remembered. Thread-safe.
+	Result CachedCheck(const Deck& deck, const HostInfo& hostInfo) const noexcept;
+private:
+	// NOTE: 128-bit hash of the deck contents (regardless of their order)
+	// and of the room options involved in checking it. The hash is keyed by
+	// a random seed, so clients can't forge decks that collide with another.
+	using CacheKey = std::pair<uint64_t, uint64_t>;
+
+	struct CachedResult
+	{
+		CacheKey key;
+		Result result;
+	};
+
+	// Each shard is direct mapped, a result simply replaces whatever was on
+	// the slot of its key, which bounds the cache without bookkeeping.
+	struct CacheShard
+	{
+		std::mutex m;
+		std::array<CachedResult, 256U> entries{};
+	};
+
+	static constexpr std::size_t CACHE_SHARD_COUNT = 16U;
+
+	const std::shared_ptr<const CardTable> cards;
+	std::vector<int32_t> limits; // Same indices as `cards`.
+	std::vector<uint32_t> slots; // Index on the tables + 1, 0 if empty.
+	uint32_t shift;
+	const uint64_t seed;
+	mutable std::array<CacheShard, CACHE_SHARD_COUNT> cache;
+
+	CacheKey KeyOf(const Deck& deck, const HostInfo& hostInfo) const noexcept;
+
+	// Returns the index of the card on the tables, or `cards->size()`.
+	std::size_t Find(uint32_t code) const noexcept;
+};
+
+} // namespace YGOPro
+
+#endif // YGOPRO_DECKVALIDATOR_HPP
@@ -0,0 +1,43 @@
+#include "QueryCache.hpp"
+
+#include <algorithm> // std::equal
+
+#include "Constants.hpp"
+
+namespace YGOPro
+{
+
+QueryCache::QueryCache(std::pmr::memory_resource* mr) noexcept :
+	entries(mr)
+{}
+
+bool QueryCache::IsRedundant(Audience a, uint8_t con, uint32_t loc, const std::pmr::vector<uint8_t>& qb) noexcept
+{
+	auto& last = entries[{a, con, loc}];
+	if(std::equal(last.cbegin(), last.cend(), qb.cbegin(), qb.cend()))
+		return true;
+	last.assign(qb.cbegin(), qb.cend());
+	return false;
+}
+
+void QueryCache::Invalidate(uint8_t con, uint32_t loc) noexcept
+{
+	entries.erase({Audience::AUDIENCE_OWNER, con, loc});
+	entries.erase({Audience::AUDIENCE_PUBLIC, con, loc});
+}
+
+void QueryCache::OnMsg(const CoreUtils::Msg& msg) noexcept
+{
+	if(CoreUtils::DoesMessageKeepCards(CoreUtils::GetMessageType(msg)))
+		return;
+	// NOTE: Overlay units are sent along their location's cards, so which
+	// location changed is not known without looking further.
+	if(const auto card = CoreUtils::GetMessageChangedCard(msg); card && (card->loc & LOCATION_OVERLAY) == 0U)
+	{
+		Invalidate(card->con, card->loc);
+		return;
+	}
+	entries.clear();
+}
+
+} // namespace YGOPro
@@ -0,0 +1,49 @@
+#ifndef YGOPRO_QUERYCACHE_HPP
+#define YGOPRO_QUERYCACHE_HPP
+#include <cstdint>
+#include <map>
+#include <memory_resource>
+#include <tuple>
+#include <vector>
+
+#include "CoreUtils.hpp"
+
+namespace YGOPro
+{
+
+// Remembers the last location query buffer sent to each audience of a duel,
+// so a refresh that would send clients exactly what they already have can be
+// skipped. The opponent and the spectators always receive the same stripped
+// buffers, so they are treated as a single audience.
+class QueryCache final
+{
+public:
+	enum class Audience : uint8_t
+	{
+		AUDIENCE_OWNER,
+		AUDIENCE_PUBLIC,
+	};
+
+	explicit QueryCache(std::pmr::memory_resource* mr) noexcept;
+
+	// Tells if the buffer is the same one last sent to the audience for the
+	// location, otherwise remembers it as the last one sent.
+	bool IsRedundant(Audience a, uint8_t con, uint32_t loc, const std::pmr::vector<uint8_t>& qb) noexcept;
+
+	// Forgets the location, to be called when a single card of it is updated.
+	void Invalidate(uint8_t con, uint32_t loc) noexcept;
+
+	// Called for every message distributed to clients. Everything is
+	// forgotten unless the message is known to leave the cards as they were
+	// on the clients (or all of them but one, whose location is forgotten),
+	// as otherwise what they have might no longer match the last buffer sent
+	// even if a new query is identical to it.
+	void OnMsg(const CoreUtils::Msg& msg) noexcept;
+private:
+	using Key = std::tuple<Audience, uint8_t, uint32_t>;
+	std::pmr::map<Key, std::pmr::vector<uint8_t>> entries;
+};
+
+} // namespace YGOPro
+
+#endif // YGOPRO_QUERYCACHE_HPP
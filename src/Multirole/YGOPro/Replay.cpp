@@ -4,7 +4,8 @@
 #include <cstring>
 
 #include "Config.hpp"
-#include "Constants.hpp"
+#include "CoreUtils.hpp"
+#include "ReplayHeader.hpp"
 #include "StringUtils.hpp"
 #include "LZMA/LzmaEnc.h"
 #include "LZMA/Alloc.h" // g_Alloc
@@ -22,49 +23,6 @@ constexpr auto ENCODED_SERVER_VERSION = [](const auto& v) constexpr -> uint32_t
 
 #include "../../Write.inl"
 
-enum ReplayTypes
-{
-	REPLAY_YRP1 = 0x31707279,
-	REPLAY_YRPX = 0x58707279
-};
-
-enum ReplayFlags
-{
-	REPLAY_COMPRESSED      = 0x1,
-	REPLAY_TAG             = 0x2,
-	REPLAY_DECODED         = 0x4,
-	REPLAY_SINGLE_MODE     = 0x8,
-	REPLAY_LUA64           = 0x10,
-	REPLAY_NEWREPLAY       = 0x20,
-	REPLAY_HAND_TEST       = 0x40,
-	REPLAY_DIRECT_SEED     = 0x80,
-	REPLAY_64BIT_DUELFLAG  = 0x100,
-	REPLAY_EXTENDED_HEADER = 0x200,
-};
-
-struct ReplayHeader
-{
-	uint32_t type; // See ReplayTypes.
-	uint32_t version; // Unused atm, should be set to YGOPro::ClientVersion.
-	uint32_t flags; // See ReplayFlags.
-	uint32_t timestamp; // Unix timestamp.
-	uint32_t size; // Uncompressed size of whatever is after this header.
-	uint32_t hash; // Unused.
-	uint8_t props[8U]; // Used for LZMA compression (check their apis).
-};
-
-constexpr uint32_t HEADER_FLAGS = REPLAY_LUA64 | REPLAY_64BIT_DUELFLAG |
-                                  REPLAY_NEWREPLAY | REPLAY_EXTENDED_HEADER;
-
-struct ExtendedReplayHeader
-{
-	static constexpr uint64_t CURRENT_VERSION = 1U;
-
-	ReplayHeader base;
-	uint64_t version; // Version of this extended header.
-	uint64_t seed[4U]; // New 256bit seed.
-};
-
 // ***** YRPX Binary format *****
 // ReplayHeader
 // team0Count [uint32_t]
@@ -103,7 +61,8 @@ Replay::Replay(
 	uint32_t unixTimestamp,
 	const std::array<uint64_t, 4U>& seed,
 	const HostInfo& info,
-	const CodeVector& extraCards) noexcept
+	const CodeVector& extraCards,
+	std::pmr::memory_resource* mr) noexcept
 	:
 	unixTimestamp(unixTimestamp),
 	seed(seed),
@@ -111,7 +70,9 @@ Replay::Replay(
 	startingDrawCount(info.startingDrawCount),
 	drawCountPerTurn(info.drawCountPerTurn),
 	duelFlags(HostInfo::OrDuelFlags(info.duelFlagsHigh, info.duelFlagsLow)),
-	extraCards(extraCards)
+	extraCards(extraCards),
+	messages(mr),
+	responses(mr)
 {}
 
 const std::vector<uint8_t>& Replay::Bytes() const noexcept
@@ -119,56 +80,27 @@ const std::vector<uint8_t>& Replay::Bytes() const noexcept
 	return bytes;
 }
 
+const Replay::MsgList& Replay::Messages() const noexcept
+{
+	return messages;
+}
+
 void Replay::AddDuelist(uint8_t team, uint8_t pos, Duelist&& duelist) noexcept
 {
 	duelists[team].insert_or_assign(pos, duelist);
 }
 
-void Replay::RecordMsg(const std::vector<uint8_t>& msg) noexcept
+void Replay::RecordMsg(const std::pmr::vector<uint8_t>& msg) noexcept
 {
 	// Filter out some useless messages.
-	switch(msg[0U])
-	{
-		case MSG_HINT:
-		{
-			switch(msg[1U])
-			{
-				// Do not record player specific hints.
-				case 1U: case 2U:
-				case 3U: case 5U:
-					return;
-			}
-			break;
-		}
-		case MSG_SELECT_BATTLECMD:
-		case MSG_SELECT_IDLECMD:
-		case MSG_SELECT_EFFECTYN:
-		case MSG_SELECT_YESNO:
-		case MSG_SELECT_OPTION:
-		case MSG_SELECT_CHAIN:
-		case MSG_SELECT_PLACE:
-		case MSG_SELECT_DISFIELD:
-		case MSG_SELECT_POSITION:
-		case MSG_SELECT_COUNTER:
-		case MSG_SELECT_SUM:
-		case MSG_SORT_CARD:
-		case MSG_SORT_CHAIN:
-		case MSG_ROCK_PAPER_SCISSORS:
-		case MSG_ANNOUNCE_RACE:
-		case MSG_ANNOUNCE_ATTRIB:
-		case MSG_ANNOUNCE_CARD:
-		case MSG_ANNOUNCE_NUMBER:
-		case MSG_SELECT_CARD:
-		case MSG_SELECT_TRIBUTE:
-		case MSG_SELECT_UNSELECT_CARD:
-			return;
-	}
-	messages.emplace_back(msg);
+	if(!CoreUtils::IsMessageRecorded(msg))
+		return;
+	messages.emplace_back(msg.cbegin(), msg.cend());
 }
 
 void Replay::RecordResponse(const std::vector<uint8_t>& response) noexcept
 {
-	responses.emplace_back(response);
+	responses.emplace_back(response.cbegin(), response.cend());
 }
 
 void Replay::PopBackResponse() noexcept
@@ -228,16 +160,17 @@ void Replay::Serialize() noexcept
 			Write(ptr, static_cast<uint32_t>(duelists[team].size()));
 			for(const auto& d : duelists[team])
 			{
-				const auto str16 = UTF8ToUTF16(d.second.name);
-				std::memcpy(ptr, str16.data(), UTF16ByteCount(str16));
-				ptr += 40U; // NOTE: Assuming all bytes were initialized to 0
+				uint16_t name[20U]{};
+				UTF8ToUTF16Field(d.second.name, name);
+				std::memcpy(ptr, name, sizeof(name));
+				ptr += sizeof(name);
 			}
 		}
 	};
 	// YRP replay is appended as a CORE message onto the YRPX messages list,
 	// for that reason, we serialize it first and as last step we serialize
 	// the whole YRPX past-the-header data.
-	[&](std::vector<uint8_t>& vec)
+	[&](std::pmr::vector<uint8_t>& vec)
 	{
 		vec.resize(1U + sizeof(ExtendedReplayHeader) + YRPPastHeaderSize());
 		uint8_t* ptr = vec.data();
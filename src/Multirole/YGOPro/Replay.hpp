@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <list>
 #include <map>
+#include <memory_resource>
 #include <string>
 #include <vector>
 
@@ -23,17 +24,23 @@ public:
 		CodeVector extra;
 	};
 
+	using MsgList = std::pmr::list<std::pmr::vector<uint8_t>>;
+
+	// NOTE: Recorded messages and responses are allocated using the given
+	// memory resource, so their size can be accounted for.
 	Replay(
 		uint32_t unixTimestamp,
 		const std::array<uint64_t, 4U>& seed,
 		const HostInfo& info,
-		const CodeVector& extraCards) noexcept;
+		const CodeVector& extraCards,
+		std::pmr::memory_resource* mr = std::pmr::get_default_resource()) noexcept;
 
 	const std::vector<uint8_t>& Bytes() const noexcept;
+	const MsgList& Messages() const noexcept;
 
 	void AddDuelist(uint8_t team, uint8_t pos, Duelist&& duelist) noexcept;
 
-	void RecordMsg(const std::vector<uint8_t>& msg) noexcept;
+	void RecordMsg(const std::pmr::vector<uint8_t>& msg) noexcept;
 	void RecordResponse(const std::vector<uint8_t>& response) noexcept;
 
 	void PopBackResponse() noexcept;
@@ -49,8 +56,8 @@ private:
 	const CodeVector extraCards;
 
 	std::array<std::map<uint8_t, Duelist>, 2U> duelists;
-	std::list<std::vector<uint8_t>> messages;
-	std::list<std::vector<uint8_t>> responses;
+	MsgList messages;
+	MsgList responses;
 
 	std::vector<uint8_t> bytes;
 };
@@ -0,0 +1,53 @@
+#ifndef YGOPRO_REPLAYHEADER_HPP
+#define YGOPRO_REPLAYHEADER_HPP
+#include <cstdint>
+
+namespace YGOPro
+{
+
+enum ReplayTypes
+{
+	REPLAY_YRP1 = 0x31707279,
+	REPLAY_YRPX = 0x58707279
+};
+
+enum ReplayFlags
+{
+	REPLAY_COMPRESSED      = 0x1,
+	REPLAY_TAG             = 0x2,
+	REPLAY_DECODED         = 0x4,
+	REPLAY_SINGLE_MODE     = 0x8,
+	REPLAY_LUA64           = 0x10,
+	REPLAY_NEWREPLAY       = 0x20,
+	REPLAY_HAND_TEST       = 0x40,
+	REPLAY_DIRECT_SEED     = 0x80,
+	REPLAY_64BIT_DUELFLAG  = 0x100,
+	REPLAY_EXTENDED_HEADER = 0x200,
+};
+
+struct ReplayHeader
+{
+	uint32_t type; // See ReplayTypes.
+	uint32_t version; // Unused atm, should be set to YGOPro::ClientVersion.
+	uint32_t flags; // See ReplayFlags.
+	uint32_t timestamp; // Unix timestamp.
+	uint32_t size; // Uncompressed size of whatever is after this header.
+	uint32_t hash; // Unused.
+	uint8_t props[8U]; // Used for LZMA compression (check their apis).
+};
+
+constexpr uint32_t HEADER_FLAGS = REPLAY_LUA64 | REPLAY_64BIT_DUELFLAG |
+                                  REPLAY_NEWREPLAY | REPLAY_EXTENDED_HEADER;
+
+struct ExtendedReplayHeader
+{
+	static constexpr uint64_t CURRENT_VERSION = 1U;
+
+	ReplayHeader base;
+	uint64_t version; // Version of this extended header.
+	uint64_t seed[4U]; // New 256bit seed.
+};
+
+} // namespace YGOPro
+
+#endif // YGOPRO_REPLAYHEADER_HPP
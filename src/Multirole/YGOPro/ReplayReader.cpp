@@ -0,0 +1,220 @@
+#include "ReplayReader.hpp"
+
+#include <cstring>
+#include <stdexcept> // std::runtime_error
+
+#include <lzma.h>
+
+#include "ReplayHeader.hpp"
+#include "StringUtils.hpp"
+
+namespace YGOPro
+{
+
+namespace
+{
+
+#include "../../Read.inl"
+
+// NOLINTNEXTLINE: Message type, Called OLD_REPLAY_FORMAT in common.h.
+constexpr uint8_t MSG_OLD_REPLAY_FORMAT = 231U;
+
+constexpr std::size_t NAME_BYTE_COUNT = 40U;
+
+// Size of the LZMA properties written by LzmaEncode.
+constexpr std::size_t LZMA_PROPS_SIZE = 5U;
+
+// Bounds checked version of Read, throws if reading would go past ptrMax.
+template<typename T>
+inline T SafeRead(const uint8_t*& ptr, const uint8_t* const ptrMax)
+{
+	if(static_cast<std::size_t>(ptrMax - ptr) < sizeof(T))
+		throw std::runtime_error("Replay is truncated");
+	return Read<T>(ptr);
+}
+
+inline void SafeSkip(const uint8_t*& ptr, const uint8_t* const ptrMax, std::size_t count)
+{
+	if(static_cast<std::size_t>(ptrMax - ptr) < count)
+		throw std::runtime_error("Replay is truncated");
+	ptr += count;
+}
+
+inline std::vector<uint8_t> Decompress(const ExtendedReplayHeader& header, const uint8_t* data, std::size_t size)
+{
+	// NOTE: Replay::Serialize uses the raw encoder from the LZMA SDK, which
+	// does not write the .lzma header nor an end marker. We rebuild that
+	// header from the properties and uncompressed size stored in the replay
+	// header so liblzma's decoder knows when to stop.
+	std::vector<uint8_t> input(LZMA_PROPS_SIZE + sizeof(uint64_t) + size);
+	std::memcpy(input.data(), header.base.props, LZMA_PROPS_SIZE);
+	const uint64_t outSize = header.base.size;
+	std::memcpy(input.data() + LZMA_PROPS_SIZE, &outSize, sizeof(uint64_t));
+	std::memcpy(input.data() + LZMA_PROPS_SIZE + sizeof(uint64_t), data, size);
+	std::vector<uint8_t> output(header.base.size);
+	lzma_stream strm = LZMA_STREAM_INIT;
+	if(lzma_alone_decoder(&strm, UINT64_MAX) != LZMA_OK)
+		throw std::runtime_error("Could not initialize LZMA decoder");
+	strm.next_in = input.data();
+	strm.avail_in = input.size();
+	strm.next_out = output.data();
+	strm.avail_out = output.size();
+	const lzma_ret ret = lzma_code(&strm, LZMA_FINISH);
+	const std::size_t written = output.size() - strm.avail_out;
+	lzma_end(&strm);
+	if((ret != LZMA_OK && ret != LZMA_STREAM_END) || written != output.size())
+		throw std::runtime_error("Could not decompress replay");
+	return output;
+}
+
+} // namespace
+
+ReplayReader::ReplayReader(const std::vector<uint8_t>& bytes)
+{
+	if(bytes.size() < sizeof(ExtendedReplayHeader))
+		throw std::runtime_error("Replay is too small");
+	ExtendedReplayHeader header{};
+	std::memcpy(&header, bytes.data(), sizeof(ExtendedReplayHeader));
+	if(header.base.type != REPLAY_YRPX)
+		throw std::runtime_error("Replay is not a YRPX replay");
+	if((header.base.flags & REPLAY_EXTENDED_HEADER) == 0U)
+		throw std::runtime_error("Replay does not have an extended header");
+	timestamp = header.base.timestamp;
+	const uint8_t* const data = bytes.data() + sizeof(ExtendedReplayHeader);
+	const std::size_t dataSize = bytes.size() - sizeof(ExtendedReplayHeader);
+	const auto pthData = [&]() -> std::vector<uint8_t>
+	{
+		if(header.base.flags & REPLAY_COMPRESSED)
+			return Decompress(header, data, dataSize);
+		return {data, data + dataSize};
+	}();
+	const uint8_t* ptr = pthData.data();
+	const uint8_t* const ptrMax = ptr + pthData.size();
+	// Skip duelists names, they are read from the YRP section instead.
+	for(int team = 0; team < 2; team++)
+		SafeSkip(ptr, ptrMax, SafeRead<uint32_t>(ptr, ptrMax) * NAME_BYTE_COUNT);
+	duelFlags = SafeRead<uint64_t>(ptr, ptrMax);
+	bool foundYRP = false;
+	while(ptr != ptrMax)
+	{
+		const auto msgType = SafeRead<uint8_t>(ptr, ptrMax);
+		const auto length = SafeRead<uint32_t>(ptr, ptrMax);
+		const uint8_t* const body = ptr;
+		SafeSkip(ptr, ptrMax, length);
+		if(msgType == MSG_OLD_REPLAY_FORMAT)
+		{
+			ParseYRP(body, ptr);
+			foundYRP = true;
+			continue;
+		}
+		auto& msg = messages.emplace_back(1U + length);
+		msg[0U] = msgType;
+		std::memcpy(msg.data() + 1U, body, length);
+	}
+	if(!foundYRP)
+		throw std::runtime_error("Replay does not contain a YRP section");
+}
+
+uint32_t ReplayReader::Timestamp() const noexcept
+{
+	return timestamp;
+}
+
+const std::array<uint64_t, 4U>& ReplayReader::Seed() const noexcept
+{
+	return seed;
+}
+
+uint32_t ReplayReader::StartingLP() const noexcept
+{
+	return startingLP;
+}
+
+uint32_t ReplayReader::StartingDrawCount() const noexcept
+{
+	return startingDrawCount;
+}
+
+uint32_t ReplayReader::DrawCountPerTurn() const noexcept
+{
+	return drawCountPerTurn;
+}
+
+uint64_t ReplayReader::DuelFlags() const noexcept
+{
+	return duelFlags;
+}
+
+const CodeVector& ReplayReader::ExtraCards() const noexcept
+{
+	return extraCards;
+}
+
+const std::array<std::map<uint8_t, ReplayReader::Duelist>, 2U>& ReplayReader::Duelists() const noexcept
+{
+	return duelists;
+}
+
+const std::vector<std::vector<uint8_t>>& ReplayReader::Messages() const noexcept
+{
+	return messages;
+}
+
+const std::vector<std::vector<uint8_t>>& ReplayReader::Responses() const noexcept
+{
+	return responses;
+}
+
+// private
+
+void ReplayReader::ParseYRP(const uint8_t* ptr, const uint8_t* const ptrMax)
+{
+	const auto header = SafeRead<ExtendedReplayHeader>(ptr, ptrMax);
+	if(header.base.type != REPLAY_YRP1 || (header.base.flags & REPLAY_COMPRESSED))
+		throw std::runtime_error("Embedded YRP replay is not supported");
+	std::memcpy(seed.data(), header.seed, sizeof(header.seed));
+	for(auto& m : duelists)
+	{
+		const auto count = SafeRead<uint32_t>(ptr, ptrMax);
+		for(uint32_t i = 0U; i < count; i++)
+		{
+			const uint8_t* const name = ptr;
+			SafeSkip(ptr, ptrMax, NAME_BYTE_COUNT);
+			m[static_cast<uint8_t>(i)].name =
+				UTF16ToUTF8(BufferToUTF16(name, NAME_BYTE_COUNT));
+		}
+	}
+	startingLP = SafeRead<uint32_t>(ptr, ptrMax);
+	startingDrawCount = SafeRead<uint32_t>(ptr, ptrMax);
+	drawCountPerTurn = SafeRead<uint32_t>(ptr, ptrMax);
+	// NOTE: Same flags as the ones in the YRPX section, read for validation.
+	if(SafeRead<uint64_t>(ptr, ptrMax) != duelFlags)
+		throw std::runtime_error("Replay duel flags mismatch");
+	auto ReadCodeVector = [&](CodeVector& vec)
+	{
+		const auto count = SafeRead<uint32_t>(ptr, ptrMax);
+		if(static_cast<std::size_t>(ptrMax - ptr) / sizeof(uint32_t) < count)
+			throw std::runtime_error("Replay is truncated");
+		vec.reserve(count);
+		for(uint32_t i = 0U; i < count; i++)
+			vec.push_back(Read<uint32_t>(ptr));
+	};
+	for(auto& m : duelists)
+	{
+		for(auto& kv : m)
+		{
+			ReadCodeVector(kv.second.main);
+			ReadCodeVector(kv.second.extra);
+		}
+	}
+	ReadCodeVector(extraCards);
+	while(ptr != ptrMax)
+	{
+		const auto length = SafeRead<uint8_t>(ptr, ptrMax);
+		const uint8_t* const body = ptr;
+		SafeSkip(ptr, ptrMax, length);
+		responses.emplace_back(body, ptr);
+	}
+}
+
+} // namespace YGOPro
@@ -0,0 +1,57 @@
+#ifndef YGOPRO_REPLAYREADER_HPP
+#define YGOPRO_REPLAYREADER_HPP
+#include <array>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "Replay.hpp"
+
+namespace YGOPro
+{
+
+// Parses replays written by YGOPro::Replay (YRPX with an embedded YRP),
+// exposing everything that is needed to re-run the duel deterministically
+// as well as the messages that were recorded when the duel was played.
+class ReplayReader final
+{
+public:
+	using Duelist = Replay::Duelist;
+
+	// Throws std::runtime_error if the bytes are not a valid replay.
+	ReplayReader(const std::vector<uint8_t>& bytes);
+
+	uint32_t Timestamp() const noexcept;
+	const std::array<uint64_t, 4U>& Seed() const noexcept;
+	uint32_t StartingLP() const noexcept;
+	uint32_t StartingDrawCount() const noexcept;
+	uint32_t DrawCountPerTurn() const noexcept;
+	uint64_t DuelFlags() const noexcept;
+	const CodeVector& ExtraCards() const noexcept;
+	const std::array<std::map<uint8_t, Duelist>, 2U>& Duelists() const noexcept;
+
+	// Core messages as stored in the YRPX section, in the same form they
+	// were passed to Replay::RecordMsg (message type included), excluding
+	// the message used to hold the YRP replay.
+	const std::vector<std::vector<uint8_t>>& Messages() const noexcept;
+
+	// Player responses as stored in the YRP section, in order.
+	const std::vector<std::vector<uint8_t>>& Responses() const noexcept;
+private:
+	uint32_t timestamp{};
+	std::array<uint64_t, 4U> seed{};
+	uint32_t startingLP{};
+	uint32_t startingDrawCount{};
+	uint32_t drawCountPerTurn{};
+	uint64_t duelFlags{};
+	CodeVector extraCards;
+	std::array<std::map<uint8_t, Duelist>, 2U> duelists;
+	std::vector<std::vector<uint8_t>> messages;
+	std::vector<std::vector<uint8_t>> responses;
+
+	void ParseYRP(const uint8_t* ptr, const uint8_t* const ptrMax);
+};
+
+} // namespace YGOPro
+
+#endif // YGOPRO_REPLAYREADER_HPP
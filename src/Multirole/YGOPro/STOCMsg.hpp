@@ -238,6 +238,12 @@ public:
 		return length;
 	}
 
+	// Bytes allocated on the heap to hold the message, 0 if none.
+	std::size_t HeapSize() const noexcept
+	{
+		return IsStackArray(length) ? 0U : length;
+	}
+
 	const uint8_t* Data() const noexcept
 	{
 		if(IsStackArray(length))
@@ -246,6 +252,11 @@ public:
 			return refCntA.get();
 	}
 
+	MsgType Type() const noexcept
+	{
+		return static_cast<MsgType>(Data()[sizeof(LengthType)]);
+	}
+
 private:
 	// Reference counted dynamic array.
 	using RefCntArray = std::shared_ptr<uint8_t[]>;
@@ -1,59 +1,260 @@
 #include "StringUtils.hpp"
 
-#include <codecvt>
-#include <cstdint>
-#include <cstring>
-#include <locale>
+#include <array>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define YGOPRO_STRINGUTILS_SSE2
+#include <emmintrin.h>
+#endif // defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
 
 namespace YGOPro
 {
 
-std::u16string BufferToUTF16(const void* data, std::size_t maxByteCount) noexcept
+namespace
+{
+
+// NOTE: Strings up to this many code units (i.e: names and chat messages)
+// are transcoded on the stack first, so that the result is allocated once
+// with its exact size, if at all.
+constexpr std::size_t STACK_UNITS = 512U;
+
+} // namespace
+
+std::size_t BufferToUTF16(const void* data, std::size_t maxByteCount, char16_t* out) noexcept
 {
-	std::u16string str{};
-	if(maxByteCount == 0U)
-		return str;
 	const auto* p = reinterpret_cast<const uint8_t*>(data);
-	str.reserve((maxByteCount / 2U) + 1U);
-	for(const auto* tg = p + maxByteCount; p <= tg; p += sizeof(char16_t))
+	const std::size_t maxCount = maxByteCount / sizeof(char16_t);
+	std::size_t count = 0U;
+	for(; count < maxCount; count++, p += sizeof(char16_t))
 	{
-		char16_t toAppend{};
-		std::memcpy(&toAppend, p, sizeof(toAppend));
-		if(!toAppend || toAppend == L'\n' || toAppend == L'\r')
+		char16_t c{};
+		std::memcpy(&c, p, sizeof(c));
+		if(!c || c == u'\n' || c == u'\r')
 			break;
-		str.append(1U, toAppend);
+		out[count] = c;
 	}
+	return count;
+}
+
+std::u16string BufferToUTF16(const void* data, std::size_t maxByteCount) noexcept
+{
+	std::u16string str(maxByteCount / sizeof(char16_t), u'\0');
+	str.resize(BufferToUTF16(data, maxByteCount, str.data()));
 	return str;
 }
 
+namespace
+{
+
+template<bool Vectorized>
+std::size_t UTF16ToUTF8Impl(std::u16string_view str, char* out, std::size_t capacity) noexcept
+{
+	const char16_t* p = str.data();
+	const char16_t* const pEnd = p + str.size();
+	char* o = out;
+	char* const oEnd = out + capacity;
+	while(p != pEnd)
+	{
+#ifdef YGOPRO_STRINGUTILS_SSE2
+		// NOTE: ASCII runs are narrowed 8 code units at a time.
+		const __m128i nonAscii = _mm_set1_epi16(static_cast<short>(0xFF80));
+		while(Vectorized && pEnd - p >= 8 && oEnd - o >= 8)
+		{
+			const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			const __m128i high = _mm_and_si128(v, nonAscii);
+			if(_mm_movemask_epi8(_mm_cmpeq_epi16(high, _mm_setzero_si128())) != 0xFFFF)
+				break;
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(o), _mm_packus_epi16(v, v));
+			p += 8;
+			o += 8;
+		}
+		if(p == pEnd)
+			break;
+#endif // YGOPRO_STRINGUTILS_SSE2
+		uint32_t cp = *p;
+		std::ptrdiff_t units = 1;
+		std::ptrdiff_t bytes;
+		if(cp < 0x80U)
+			bytes = 1;
+		else if(cp < 0x800U)
+			bytes = 2;
+		else if((cp & 0xF800U) != 0xD800U)
+			bytes = 3;
+		else
+		{
+			if(pEnd - p < 2 && cp <= 0xDBFFU)
+				break;
+			if(cp > 0xDBFFU || (p[1] & 0xFC00U) != 0xDC00U)
+				return TRANSCODE_ERROR;
+			cp = 0x10000U + ((cp - 0xD800U) << 10U) + (p[1] - 0xDC00U);
+			units = 2;
+			bytes = 4;
+		}
+		if(oEnd - o < bytes)
+			break;
+		switch(bytes)
+		{
+		case 1:
+			*o++ = static_cast<char>(cp);
+			break;
+		case 2:
+			*o++ = static_cast<char>(0xC0U | (cp >> 6U));
+			*o++ = static_cast<char>(0x80U | (cp & 0x3FU));
+			break;
+		case 3:
+			*o++ = static_cast<char>(0xE0U | (cp >> 12U));
+			*o++ = static_cast<char>(0x80U | ((cp >> 6U) & 0x3FU));
+			*o++ = static_cast<char>(0x80U | (cp & 0x3FU));
+			break;
+		default:
+			*o++ = static_cast<char>(0xF0U | (cp >> 18U));
+			*o++ = static_cast<char>(0x80U | ((cp >> 12U) & 0x3FU));
+			*o++ = static_cast<char>(0x80U | ((cp >> 6U) & 0x3FU));
+			*o++ = static_cast<char>(0x80U | (cp & 0x3FU));
+			break;
+		}
+		p += units;
+	}
+	return static_cast<std::size_t>(o - out);
+}
+
+template<bool Vectorized>
+std::size_t UTF8ToUTF16Impl(std::string_view str, char16_t* out, std::size_t capacity) noexcept
+{
+	const auto* p = reinterpret_cast<const uint8_t*>(str.data());
+	const uint8_t* const pEnd = p + str.size();
+	char16_t* o = out;
+	char16_t* const oEnd = out + capacity;
+	while(p != pEnd)
+	{
+#ifdef YGOPRO_STRINGUTILS_SSE2
+		// NOTE: ASCII runs are widened 16 bytes at a time.
+		while(Vectorized && pEnd - p >= 16 && oEnd - o >= 16)
+		{
+			const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			if(_mm_movemask_epi8(v) != 0)
+				break;
+			const __m128i zero = _mm_setzero_si128();
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(o), _mm_unpacklo_epi8(v, zero));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(o + 8), _mm_unpackhi_epi8(v, zero));
+			p += 16;
+			o += 16;
+		}
+		if(p == pEnd)
+			break;
+#endif // YGOPRO_STRINGUTILS_SSE2
+		uint32_t cp = *p;
+		std::ptrdiff_t bytes;
+		if(cp < 0x80U)
+			bytes = 1;
+		else if(cp < 0xC2U) // Continuation byte or overlong 2 byte sequence.
+			return TRANSCODE_ERROR;
+		else if(cp < 0xE0U)
+		{
+			bytes = 2;
+			cp &= 0x1FU;
+		}
+		else if(cp < 0xF0U)
+		{
+			bytes = 3;
+			cp &= 0x0FU;
+		}
+		else if(cp < 0xF5U)
+		{
+			bytes = 4;
+			cp &= 0x07U;
+		}
+		else
+			return TRANSCODE_ERROR;
+		if(pEnd - p < bytes)
+			break;
+		for(std::ptrdiff_t i = 1; i < bytes; i++)
+		{
+			if((p[i] & 0xC0U) != 0x80U)
+				return TRANSCODE_ERROR;
+			cp = (cp << 6U) | (p[i] & 0x3FU);
+		}
+		// NOTE: Rejects overlong sequences, surrogates and code points past
+		// the last one representable as UTF-16.
+		if((bytes == 3 && cp < 0x800U) ||
+		   (bytes == 4 && (cp < 0x10000U || cp > 0x10FFFFU)) ||
+		   (cp & 0xFFFFF800U) == 0xD800U)
+			return TRANSCODE_ERROR;
+		if(cp < 0x10000U)
+		{
+			if(o == oEnd)
+				break;
+			*o++ = static_cast<char16_t>(cp);
+		}
+		else
+		{
+			if(oEnd - o < 2)
+				break;
+			cp -= 0x10000U;
+			*o++ = static_cast<char16_t>(0xD800U | (cp >> 10U));
+			*o++ = static_cast<char16_t>(0xDC00U | (cp & 0x3FFU));
+		}
+		p += bytes;
+	}
+	return static_cast<std::size_t>(o - out);
+}
+
+} // namespace
 
-constexpr const char* ERROR_STR = "Invalid String";
+std::size_t UTF16ToUTF8(std::u16string_view str, char* out, std::size_t capacity) noexcept
+{
+	return UTF16ToUTF8Impl<true>(str, out, capacity);
+}
 
-#if defined(_MSC_VER) && _MSC_VER >= 1900 && _MSC_VER < 1920
-using Wsc = std::wstring_convert<std::codecvt_utf8_utf16<int16_t>, int16_t>;
-#else
-using Wsc = std::wstring_convert<std::codecvt_utf8_utf16<char16_t>, char16_t>;
-#endif // defined(_MSC_VER) && _MSC_VER >= 1900 && _MSC_VER < 1920
+std::size_t UTF8ToUTF16(std::string_view str, char16_t* out, std::size_t capacity) noexcept
+{
+	return UTF8ToUTF16Impl<true>(str, out, capacity);
+}
 
-using WscElem = Wsc::wide_string::value_type;
+std::size_t UTF16ToUTF8Scalar(std::u16string_view str, char* out, std::size_t capacity) noexcept
+{
+	return UTF16ToUTF8Impl<false>(str, out, capacity);
+}
 
-inline Wsc MakeWsc() noexcept
+std::size_t UTF8ToUTF16Scalar(std::string_view str, char16_t* out, std::size_t capacity) noexcept
 {
-	return Wsc{ERROR_STR};
+	return UTF8ToUTF16Impl<false>(str, out, capacity);
 }
 
 std::string UTF16ToUTF8(std::u16string_view str) noexcept
 {
-	const auto* p = reinterpret_cast<const WscElem*>(str.data());
-	return MakeWsc().to_bytes(p, p + str.size());
+	if(str.size() <= STACK_UNITS)
+	{
+		std::array<char, STACK_UNITS * 3U> buffer;
+		const auto count = UTF16ToUTF8(str, buffer.data(), buffer.size());
+		if(count == TRANSCODE_ERROR)
+			return std::string(INVALID_STRING);
+		return std::string(buffer.data(), count);
+	}
+	std::string out(str.size() * 3U, '\0');
+	const auto count = UTF16ToUTF8(str, out.data(), out.size());
+	if(count == TRANSCODE_ERROR)
+		return std::string(INVALID_STRING);
+	out.resize(count);
+	return out;
 }
 
 std::u16string UTF8ToUTF16(std::string_view str) noexcept
 {
-	if constexpr(std::is_same_v<char16_t, WscElem>)
-		return MakeWsc().from_bytes(str.data());
-	const auto r = MakeWsc().from_bytes(str.data(), str.data() + str.size());
-	return std::u16string(reinterpret_cast<const char16_t*>(r.data()), r.length());
+	if(str.size() <= STACK_UNITS)
+	{
+		std::array<char16_t, STACK_UNITS> buffer;
+		const auto count = UTF8ToUTF16(str, buffer.data(), buffer.size());
+		if(count == TRANSCODE_ERROR)
+			return UTF8ToUTF16(INVALID_STRING);
+		return std::u16string(buffer.data(), count);
+	}
+	std::u16string out(str.size(), u'\0');
+	const auto count = UTF8ToUTF16(str, out.data(), out.size());
+	if(count == TRANSCODE_ERROR)
+		return UTF8ToUTF16(INVALID_STRING);
+	out.resize(count);
+	return out;
 }
 
 } // namespace YGOPro
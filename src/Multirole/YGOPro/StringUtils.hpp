@@ -1,20 +1,61 @@
 #ifndef STRINGUTILS_HPP
 #define STRINGUTILS_HPP
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <string_view>
 
 namespace YGOPro
 {
 
-constexpr std::size_t UTF16ByteCount(std::u16string_view str) noexcept
-{
-	return (str.size() + 1U) * sizeof(char16_t);
-}
+// Replaces malformed strings.
+constexpr std::string_view INVALID_STRING = "Invalid String";
 
+// Returned by the transcoders below when the input is not well-formed.
+constexpr std::size_t TRANSCODE_ERROR = static_cast<std::size_t>(-1);
+
+// Reads code units until a null terminator, a line break or `maxByteCount`
+// bytes are read. `out` must have room for `maxByteCount / 2` code units,
+// the amount of code units written is returned.
+std::size_t BufferToUTF16(const void* data, std::size_t maxByteCount, char16_t* out) noexcept;
 std::u16string BufferToUTF16(const void* data, std::size_t maxByteCount) noexcept;
 
+// Transcode as much of `str` as fits onto `out`, which has room for
+// `capacity` code units, without splitting code points. Return how many
+// code units were written, or TRANSCODE_ERROR if what was read from `str`
+// is not well-formed (lone surrogates, overlong or truncated sequences and
+// so on), in which case the contents of `out` are unspecified.
+// NOTE: The whole string always fits if `capacity` is at least `str.size()`
+// when transcoding to UTF-16 and `str.size() * 3` when transcoding to UTF-8.
+// A sequence left incomplete by the end of `str` is dropped instead, as
+// strings read from fixed size buffers may have been cut short there.
+std::size_t UTF16ToUTF8(std::u16string_view str, char* out, std::size_t capacity) noexcept;
+std::size_t UTF8ToUTF16(std::string_view str, char16_t* out, std::size_t capacity) noexcept;
+
+// Same as above but going through every code unit one at a time, even where
+// the ones above handle several at once, so both can be checked against each
+// other.
+std::size_t UTF16ToUTF8Scalar(std::u16string_view str, char* out, std::size_t capacity) noexcept;
+std::size_t UTF8ToUTF16Scalar(std::string_view str, char16_t* out, std::size_t capacity) noexcept;
+
+// NOTE: Malformed strings are replaced by INVALID_STRING.
 std::string UTF16ToUTF8(std::u16string_view str) noexcept;
 std::u16string UTF8ToUTF16(std::string_view str) noexcept;
 
+// Writes the string onto a fixed size field (e.g: of a message) as null
+// terminated UTF-16, cutting it short if it doesn't fit.
+template<std::size_t N>
+void UTF8ToUTF16Field(std::string_view str, uint16_t (&field)[N]) noexcept
+{
+	static_assert(N > 1U);
+	char16_t str16[N];
+	auto count = UTF8ToUTF16(str, str16, N - 1U);
+	if(count == TRANSCODE_ERROR)
+		count = UTF8ToUTF16(INVALID_STRING, str16, N - 1U);
+	str16[count] = u'\0';
+	std::memcpy(&field[0U], str16, (count + 1U) * sizeof(char16_t));
+}
+
 } // namespace YGOPro
 
 #endif // STRINGUTILS_HPP
@@ -6,6 +6,7 @@
 #include <cstdlib> // Exit flags
 #include <fstream> // std::ifstream
 #include <optional> // std::optional
+#include <string_view>
 
 #include <boost/json/src.hpp>
 #include <fmt/format.h>
@@ -14,23 +15,29 @@
 
 #include "Instance.hpp"
 #include "I18N.hpp"
+#include "ReplayVerifier.hpp"
 
 namespace
 {
 
+inline boost::json::value LoadConfig()
+{
+	std::ifstream f("config.json");
+	boost::json::monotonic_resource mr;
+	boost::json::stream_parser p(&mr);
+	for(std::string l; std::getline(f, l);)
+		p.write(l);
+	p.finish();
+	return p.release();
+}
+
 inline int CreateAndRunServerInstance() noexcept
 {
 	using namespace Ignis::Multirole;
 	std::optional<Instance> server;
 	try
 	{
-		std::ifstream f("config.json");
-		boost::json::monotonic_resource mr;
-		boost::json::stream_parser p(&mr);
-		for(std::string l; std::getline(f, l);)
-			p.write(l);
-		p.finish();
-		server.emplace(p.release());
+		server.emplace(LoadConfig());
 	}
 	catch(const std::exception& e)
 	{
@@ -40,14 +47,31 @@ inline int CreateAndRunServerInstance() noexcept
 	return server->Run();
 }
 
+inline int CreateAndRunReplayVerifier(const char* dir) noexcept
+{
+	using namespace Ignis::Multirole;
+	std::optional<ReplayVerifier> verifier;
+	try
+	{
+		verifier.emplace(LoadConfig());
+	}
+	catch(const std::exception& e)
+	{
+		fmt::print(I18N::MAIN_VERIFIER_INIT_FAILURE, e.what());
+		return EXIT_FAILURE;
+	}
+	return verifier->Run(dir);
+}
+
 } // namespace
 
-int main()
+int main(int argc, char* argv[])
 {
 	git_libgit2_init();
 	sqlite3_config(SQLITE_CONFIG_MULTITHREAD);
 	sqlite3_initialize();
-	int exitFlag = CreateAndRunServerInstance();
+	int exitFlag = (argc > 2 && std::string_view(argv[1]) == "--verify-replays") ?
+		CreateAndRunReplayVerifier(argv[2]) : CreateAndRunServerInstance();
 	sqlite3_shutdown();
 	git_libgit2_shutdown();
 	return exitFlag;
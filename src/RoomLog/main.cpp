@@ -0,0 +1,171 @@
+/**
+ *  Project Ignis: Multirole
+ *  Licensed under AGPL
+ *  Refer to the COPYING file included.
+ */
+#include <algorithm> // std::sort
+#include <chrono>
+#include <cstdint>
+#include <cstdio> // std::fwrite
+#include <cstdlib> // Exit flags, std::strtoull
+#include <filesystem>
+#include <fstream>
+#include <iterator> // std::istreambuf_iterator, std::back_inserter
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "../Multirole/I18N.hpp"
+#include "../Multirole/Service/LogHandler/RoomLogFormat.hpp"
+#include "../Multirole/Service/LogHandler/Timestamp.hpp"
+
+namespace
+{
+
+using namespace Ignis::Multirole;
+using namespace Ignis::Multirole::LogHandlerDetail;
+
+struct Filter
+{
+	std::optional<uint32_t> roomId;
+	std::string_view text;
+	uint64_t since{0U}; // Milliseconds since epoch.
+	uint64_t until{UINT64_MAX};
+
+	bool Matches(const RoomLogRecord& r) const noexcept
+	{
+		return (!roomId || *roomId == r.roomId) &&
+		       r.timestamp >= since && r.timestamp < until &&
+		       (text.empty() || r.text.find(text) != std::string_view::npos);
+	}
+};
+
+// Segments of a directory sorted by the time they were started and then by
+// their sequence number, which is the name they were given.
+std::vector<std::filesystem::path> ListSegments(const std::filesystem::path& path)
+{
+	if(!std::filesystem::is_directory(path))
+		return {path};
+	std::vector<std::tuple<uint64_t, uint64_t, std::filesystem::path>> found;
+	for(const auto& entry : std::filesystem::directory_iterator(path))
+	{
+		if(!entry.is_regular_file() || entry.path().extension() != ROOM_LOG_EXTENSION)
+			continue;
+		// NOTE: Segments written before sequence numbers were added have
+		// none, which is the same as being the first of their millisecond.
+		const auto stem = entry.path().stem().string();
+		char* end = nullptr;
+		const uint64_t ts = std::strtoull(stem.data(), &end, 10);
+		const uint64_t seq = (*end == '-') ? std::strtoull(end + 1, nullptr, 10) : 0U;
+		found.emplace_back(ts, seq, entry.path());
+	}
+	std::sort(found.begin(), found.end());
+	std::vector<std::filesystem::path> segments;
+	for(auto& [ts, seq, p] : found)
+		segments.emplace_back(std::move(p));
+	return segments;
+}
+
+// Renders the matching records of a segment the same way room logs used to
+// be written, tagged with their room.
+bool Render(const std::filesystem::path& path, const Filter& filter)
+{
+	std::ifstream file(path, std::ifstream::binary);
+	if(!file.is_open())
+	{
+		fmt::print(stderr, I18N::ROOM_LOG_CANNOT_READ, path.string());
+		return false;
+	}
+	const std::string contents{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+	std::string_view data(contents);
+	if(!ReadRoomLogSegmentHeader(data))
+	{
+		fmt::print(stderr, I18N::ROOM_LOG_NOT_A_SEGMENT, path.string());
+		return false;
+	}
+	fmt::memory_buffer out;
+	auto Write = [&]()
+	{
+		std::fwrite(out.data(), 1U, out.size(), stdout);
+		out.clear();
+	};
+	RoomLogRecord record{};
+	while(ReadRoomLogRecord(data, record))
+	{
+		if(!filter.Matches(record))
+			continue;
+		FmtTimestamp(out, Timestamp(std::chrono::milliseconds(record.timestamp)));
+		fmt::format_to(std::back_inserter(out), I18N::ROOM_LOG_RECORD_ROOM, record.roomId);
+		out.append(record.text.data(), record.text.data() + record.text.size());
+		out.push_back('\n');
+		if(out.size() >= 64U * 1024U)
+			Write();
+	}
+	Write();
+	// NOTE: The last record might have been cut short if the server stopped
+	// abruptly while writing it.
+	if(!data.empty())
+	{
+		fmt::print(stderr, I18N::ROOM_LOG_TRUNCATED, path.string());
+		return false;
+	}
+	return true;
+}
+
+int Run(int argc, char* argv[])
+{
+	Filter filter;
+	for(int i = 2; i < argc; i += 2)
+	{
+		const std::string_view opt(argv[i]);
+		if(i + 1 >= argc)
+		{
+			fmt::print(stderr, I18N::ROOM_LOG_INVALID_ARGUMENT, opt);
+			return EXIT_FAILURE;
+		}
+		const char* const value = argv[i + 1];
+		if(opt == "--room")
+			filter.roomId = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+		else if(opt == "--grep")
+			filter.text = value;
+		else if(opt == "--since")
+			filter.since = std::strtoull(value, nullptr, 10) * 1000U;
+		else if(opt == "--until")
+			filter.until = std::strtoull(value, nullptr, 10) * 1000U;
+		else
+		{
+			fmt::print(stderr, I18N::ROOM_LOG_INVALID_ARGUMENT, opt);
+			return EXIT_FAILURE;
+		}
+	}
+	std::vector<std::filesystem::path> segments;
+	try
+	{
+		segments = ListSegments(argv[1]);
+	}
+	catch(const std::exception& e)
+	{
+		fmt::print(stderr, I18N::ROOM_LOG_CANNOT_READ, e.what());
+		return EXIT_FAILURE;
+	}
+	bool ok = true;
+	for(const auto& segment : segments)
+		ok = Render(segment, filter) && ok;
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+	if(argc < 2)
+	{
+		fmt::print(Ignis::Multirole::I18N::ROOM_LOG_USAGE, argv[0]);
+		return EXIT_FAILURE;
+	}
+	return Run(argc, argv);
+}